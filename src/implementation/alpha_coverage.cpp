@@ -0,0 +1,180 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module;
+
+#if defined(__AVX2__)
+#define UIMG_COVERAGE_AVX2
+#include <immintrin.h>
+#endif
+
+module pragma.image;
+
+import :buffer;
+
+// Alpha coverage is evaluated on a histogram of the alpha values, so the binary search for the alpha scale
+// doesn't have to touch the image data again.
+namespace alpha_coverage {
+	// LDR alpha values map to bins directly, HDR and float values are quantized
+	static constexpr uint32_t NUM_LDR_BINS = 256;
+	static constexpr uint32_t NUM_BINS = 4096;
+
+	struct Histogram {
+		std::vector<uint64_t> bins;
+		uint64_t numPixels = 0;
+		float GetBinValue(uint32_t bin) const { return bin / static_cast<float>(bins.size() - 1); }
+	};
+
+	static std::optional<Histogram> build_histogram(const void *data, uint32_t width, uint32_t height, pragma::image::Format format)
+	{
+		using namespace pragma::image;
+		if(ImageBuffer::GetChannelCount(format) != 4)
+			return {};
+		Histogram histogram {};
+		histogram.numPixels = static_cast<uint64_t>(width) * height;
+		auto n = histogram.numPixels;
+		switch(ImageBuffer::GetChannelSize(format)) {
+		case 1:
+			{
+				// Consecutive pixels often share the same alpha value, incrementing the same counter back to back stalls on the
+				// previous store, so the pixels are distributed across four interleaved sub-histograms
+				std::vector<uint32_t> counts(NUM_LDR_BINS * 4, 0);
+				auto *alpha = static_cast<const uint8_t *>(data) + 3;
+				uint64_t i = 0;
+				for(; i + 4 <= n; i += 4) {
+					++counts[alpha[i * 4] * 4];
+					++counts[alpha[(i + 1) * 4] * 4 + 1];
+					++counts[alpha[(i + 2) * 4] * 4 + 2];
+					++counts[alpha[(i + 3) * 4] * 4 + 3];
+				}
+				for(; i < n; ++i)
+					++counts[alpha[i * 4] * 4];
+				histogram.bins.resize(NUM_LDR_BINS);
+				for(uint32_t b = 0; b < NUM_LDR_BINS; ++b)
+					histogram.bins[b] = static_cast<uint64_t>(counts[b * 4]) + counts[b * 4 + 1] + counts[b * 4 + 2] + counts[b * 4 + 3];
+				break;
+			}
+		case 2:
+		case 4:
+			{
+				histogram.bins.resize(NUM_BINS, 0);
+				auto isHalf = (ImageBuffer::GetChannelSize(format) == 2);
+				auto toBin = [](float a) { return static_cast<uint32_t>(pragma::math::clamp(a, 0.f, 1.f) * (NUM_BINS - 1) + 0.5f); };
+				uint64_t i = 0;
+#ifdef UIMG_COVERAGE_AVX2
+				// Eight alpha values are gathered, converted and quantized at once
+				alignas(32) std::array<int32_t, 8> bins;
+				auto vScale = _mm256_set1_ps(static_cast<float>(NUM_BINS - 1));
+				auto vHalf = _mm256_set1_ps(0.5f);
+				auto vZero = _mm256_setzero_ps();
+				auto vOne = _mm256_set1_ps(1.f);
+				for(; i + 8 <= n; i += 8) {
+					__m256 a;
+					if(isHalf) {
+#ifdef __F16C__
+						auto *values = static_cast<const uint16_t *>(data) + i * 4 + 3;
+						a = _mm256_cvtph_ps(_mm_setr_epi16(values[0], values[4], values[8], values[12], values[16], values[20], values[24], values[28]));
+#else
+						auto *values = static_cast<const uint16_t *>(data) + i * 4 + 3;
+						a = _mm256_setr_ps(pragma::math::float16_to_float32_glm(values[0]), pragma::math::float16_to_float32_glm(values[4]), pragma::math::float16_to_float32_glm(values[8]), pragma::math::float16_to_float32_glm(values[12]),
+						  pragma::math::float16_to_float32_glm(values[16]), pragma::math::float16_to_float32_glm(values[20]), pragma::math::float16_to_float32_glm(values[24]), pragma::math::float16_to_float32_glm(values[28]));
+#endif
+					}
+					else
+						a = _mm256_i32gather_ps(static_cast<const float *>(data) + i * 4 + 3, _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28), 4);
+					a = _mm256_min_ps(_mm256_max_ps(a, vZero), vOne);
+					_mm256_store_si256(reinterpret_cast<__m256i *>(bins.data()), _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(a, vScale), vHalf)));
+					for(auto bin : bins)
+						++histogram.bins[bin];
+				}
+#endif
+				for(; i < n; ++i) {
+					float a;
+					if(isHalf)
+						a = pragma::math::float16_to_float32_glm(static_cast<const uint16_t *>(data)[i * 4 + 3]);
+					else
+						a = static_cast<const float *>(data)[i * 4 + 3];
+					++histogram.bins[toBin(a)];
+				}
+				break;
+			}
+		default:
+			return {};
+		}
+		return histogram;
+	}
+
+	static float calculate_coverage(const Histogram &histogram, float alphaCutoff, float alphaScale)
+	{
+		if(histogram.numPixels == 0)
+			return 0.f;
+		uint64_t numCovered = 0;
+		for(uint32_t b = 0; b < histogram.bins.size(); ++b) {
+			if(histogram.GetBinValue(b) * alphaScale > alphaCutoff)
+				numCovered += histogram.bins[b];
+		}
+		return numCovered / static_cast<float>(histogram.numPixels);
+	}
+};
+
+float pragma::image::calculate_alpha_coverage(const void *data, uint32_t width, uint32_t height, Format format, float alphaCutoff, float alphaScale)
+{
+	auto histogram = alpha_coverage::build_histogram(data, width, height, format);
+	if(!histogram)
+		return 0.f;
+	return alpha_coverage::calculate_coverage(*histogram, alphaCutoff, alphaScale);
+}
+
+bool pragma::image::scale_alpha_to_coverage(void *data, uint32_t width, uint32_t height, Format format, float coverage, float alphaCutoff)
+{
+	auto histogram = alpha_coverage::build_histogram(data, width, height, format);
+	if(!histogram)
+		return false;
+	// Coverage only ever grows with the scale, so the smallest scale that reaches the desired coverage can be found with a binary search
+	constexpr uint32_t numIterations = 10;
+	constexpr float maxAlphaScale = 4.f;
+	auto minScale = 0.f;
+	auto maxScale = maxAlphaScale;
+	auto scale = 1.f;
+	for(uint32_t i = 0; i < numIterations; ++i) {
+		auto curCoverage = alpha_coverage::calculate_coverage(*histogram, alphaCutoff, scale);
+		if(curCoverage < coverage)
+			minScale = scale;
+		else if(curCoverage > coverage)
+			maxScale = scale;
+		else
+			break;
+		scale = (minScale + maxScale) * 0.5f;
+	}
+	if(scale == 1.f)
+		return true;
+
+	auto n = static_cast<size_t>(width) * height;
+	switch(ImageBuffer::GetChannelSize(format)) {
+	case 1:
+		{
+			auto *alpha = static_cast<uint8_t *>(data) + 3;
+			std::array<uint8_t, 256> scaled;
+			for(uint32_t v = 0; v < scaled.size(); ++v)
+				scaled[v] = static_cast<uint8_t>(pragma::math::clamp(v * scale + 0.5f, 0.f, 255.f));
+			for(size_t i = 0; i < n; ++i)
+				alpha[i * 4] = scaled[alpha[i * 4]];
+			break;
+		}
+	case 2:
+		{
+			auto *alpha = static_cast<uint16_t *>(data) + 3;
+			for(size_t i = 0; i < n; ++i)
+				alpha[i * 4] = pragma::math::float32_to_float16_glm(pragma::math::clamp(pragma::math::float16_to_float32_glm(alpha[i * 4]) * scale, 0.f, 1.f));
+			break;
+		}
+	default:
+		{
+			auto *alpha = static_cast<float *>(data) + 3;
+			for(size_t i = 0; i < n; ++i)
+				alpha[i * 4] = pragma::math::clamp(alpha[i * 4] * scale, 0.f, 1.f);
+			break;
+		}
+	}
+	return true;
+}
@@ -9,6 +9,8 @@ module;
 module pragma.image;
 
 import :buffer;
+import :core;
+import :thread_pool;
 
 std::shared_ptr<pragma::image::ImageBuffer> pragma::image::ImageBuffer::Create(const void *data, uint32_t width, uint32_t height, Format format) { return Create(const_cast<void *>(data), width, height, format, false); }
 std::shared_ptr<pragma::image::ImageBuffer> pragma::image::ImageBuffer::CreateWithCustomDeleter(void *data, uint32_t width, uint32_t height, Format format, const std::function<void(void *)> &customDeleter)
@@ -723,82 +725,563 @@ void pragma::image::ImageBuffer::Write(Offset offset, Size size, const void *inD
 	auto *dstPtr = static_cast<uint8_t *>(m_data.get()) + offset;
 	memcpy(dstPtr, inData, size);
 }
-void pragma::image::ImageBuffer::Resize(Size width, Size height, EdgeAddressMode addressMode, Filter filter, ColorSpace colorSpace)
+namespace {
+	struct StbResizeParams {
+		stbir_datatype datatype;
+		stbir_edge edge;
+		stbir_filter filter;
+		stbir_colorspace colorSpace;
+		int32_t numChannels;
+		int32_t alphaChannel;
+		size_t pixelSize;
+	};
+};
+static std::optional<StbResizeParams> get_stb_resize_params(pragma::image::Format format, pragma::image::EdgeAddressMode addressMode, pragma::image::Filter filter, pragma::image::ColorSpace colorSpace)
 {
-	if(width == m_width && height == m_height)
-		return;
-	auto imgResized = Create(width, height, GetFormat());
-	stbir_datatype stformat;
-	if(IsLDRFormat())
-		stformat = STBIR_TYPE_UINT8;
-	else if(IsHDRFormat())
-		stformat = STBIR_TYPE_UINT16;
-	else if(IsFloatFormat())
-		stformat = STBIR_TYPE_FLOAT;
-	else
-		return;
+	using namespace pragma::image;
+	StbResizeParams params {};
+	switch(ImageBuffer::GetChannelSize(format)) {
+	case 1:
+		params.datatype = STBIR_TYPE_UINT8;
+		break;
+	case 2:
+		params.datatype = STBIR_TYPE_UINT16;
+		break;
+	case 4:
+		params.datatype = STBIR_TYPE_FLOAT;
+		break;
+	default:
+		return {};
+	}
 
-	stbir_edge stedge;
 	switch(addressMode) {
 	case EdgeAddressMode::Clamp:
-		stedge = STBIR_EDGE_CLAMP;
+		params.edge = STBIR_EDGE_CLAMP;
 		break;
 	case EdgeAddressMode::Reflect:
-		stedge = STBIR_EDGE_REFLECT;
+		params.edge = STBIR_EDGE_REFLECT;
 		break;
 	case EdgeAddressMode::Wrap:
-		stedge = STBIR_EDGE_WRAP;
+		params.edge = STBIR_EDGE_WRAP;
 		break;
 	case EdgeAddressMode::Zero:
-		stedge = STBIR_EDGE_ZERO;
+		params.edge = STBIR_EDGE_ZERO;
 		break;
 	}
 	static_assert(pragma::math::to_integral(EdgeAddressMode::Count) == 4);
 
-	stbir_filter stfilter;
 	switch(filter) {
 	case Filter::Default:
-		stfilter = STBIR_FILTER_DEFAULT;
+		params.filter = STBIR_FILTER_DEFAULT;
 		break;
 	case Filter::Box:
-		stfilter = STBIR_FILTER_BOX;
+		params.filter = STBIR_FILTER_BOX;
 		break;
 	case Filter::Triangle:
-		stfilter = STBIR_FILTER_TRIANGLE;
+		params.filter = STBIR_FILTER_TRIANGLE;
 		break;
 	case Filter::CubicBSpline:
-		stfilter = STBIR_FILTER_CUBICBSPLINE;
+		params.filter = STBIR_FILTER_CUBICBSPLINE;
 		break;
 	case Filter::CatmullRom:
-		stfilter = STBIR_FILTER_CATMULLROM;
+		params.filter = STBIR_FILTER_CATMULLROM;
 		break;
 	case Filter::Mitchell:
-		stfilter = STBIR_FILTER_MITCHELL;
+		params.filter = STBIR_FILTER_MITCHELL;
 		break;
 	}
 	static_assert(pragma::math::to_integral(Filter::Count) == 6);
 
-	stbir_colorspace stColorspace;
 	switch(colorSpace) {
 	case ColorSpace::Auto:
-		stColorspace = !IsLDRFormat() ? STBIR_COLORSPACE_LINEAR : STBIR_COLORSPACE_SRGB;
+		params.colorSpace = (params.datatype != STBIR_TYPE_UINT8) ? STBIR_COLORSPACE_LINEAR : STBIR_COLORSPACE_SRGB;
 		break;
 	case ColorSpace::Linear:
-		stColorspace = STBIR_COLORSPACE_LINEAR;
+		params.colorSpace = STBIR_COLORSPACE_LINEAR;
 		break;
 	case ColorSpace::SRGB:
-		stColorspace = STBIR_COLORSPACE_SRGB;
+		params.colorSpace = STBIR_COLORSPACE_SRGB;
 		break;
 	}
 	static_assert(pragma::math::to_integral(ColorSpace::Count) == 3);
 
-	auto res = stbir_resize(static_cast<uint8_t *>(GetData()), GetWidth(), GetHeight(), 0 /* stride */, static_cast<uint8_t *>(imgResized->GetData()), imgResized->GetWidth(), imgResized->GetHeight(), 0 /* stride */, stformat, GetChannelCount(),
-	  HasAlphaChannel() ? pragma::math::to_integral(Channel::Alpha) : STBIR_ALPHA_CHANNEL_NONE, 0 /* flags */, stedge, stedge, stfilter, stfilter, stColorspace, nullptr);
-	if(res == 0)
+	params.numChannels = ImageBuffer::GetChannelCount(format);
+	params.alphaChannel = (params.numChannels > pragma::math::to_integral(Channel::Alpha)) ? pragma::math::to_integral(Channel::Alpha) : STBIR_ALPHA_CHANNEL_NONE;
+	params.pixelSize = ImageBuffer::GetPixelSize(format);
+	return params;
+}
+
+// Resizes an image in independent bands of output rows by driving the internals of stb_image_resize directly.
+// The filter coefficients are calculated once for the entire image and shared by all bands, so the result is
+// bit-identical to a single stbir_resize call.
+class pragma::image::ResizePlan::Resizer {
+  public:
+	bool Initialize(const StbResizeParams &params, uint32_t srcW, uint32_t srcH, uint32_t dstW, uint32_t dstH);
+	// Size of the scratch memory required by ResizeRows (per concurrent call)
+	size_t GetScratchSize() const;
+	void ResizeRows(const void *src, void *dst, uint32_t yStart, uint32_t yEnd, void *scratch) const;
+  private:
+	static void ResizeRowsUpsample(stbir__info &info, int32_t yStart, int32_t yEnd);
+	static void ResizeRowsDownsample(stbir__info &info, int32_t yStart, int32_t yEnd);
+	static void EmptyRingBuffer(stbir__info &info, int32_t firstNecessaryScanline, int32_t yStart, int32_t yEnd);
+	stbir__info m_info {};
+	std::unique_ptr<uint8_t[]> m_coefficients = nullptr;
+};
+
+// Mirrors stbir__resize_allocated, except that the scratch buffers are assigned per band
+bool pragma::image::ResizePlan::Resizer::Initialize(const StbResizeParams &params, uint32_t srcW, uint32_t srcH, uint32_t dstW, uint32_t dstH)
+{
+	auto &info = m_info;
+	stbir__setup(&info, srcW, srcH, dstW, dstH, params.numChannels);
+	stbir__calculate_transform(&info, 0.f, 0.f, 1.f, 1.f, nullptr);
+	stbir__choose_filter(&info, params.filter, params.filter);
+	stbir__calculate_memory(&info);
+	if(info.channels <= 0 || info.channels > STBIR_MAX_CHANNELS || params.alphaChannel >= info.channels)
+		return false;
+
+	stbir_uint32 flags = 0;
+	if(params.alphaChannel < 0)
+		flags |= STBIR_FLAG_ALPHA_USES_COLORSPACE | STBIR_FLAG_ALPHA_PREMULTIPLIED;
+	info.input_stride_bytes = static_cast<int>(srcW * params.pixelSize);
+	info.output_stride_bytes = static_cast<int>(dstW * params.pixelSize);
+	info.alpha_channel = params.alphaChannel;
+	info.flags = flags;
+	info.type = params.datatype;
+	info.edge_horizontal = params.edge;
+	info.edge_vertical = params.edge;
+	info.colorspace = params.colorSpace;
+
+	info.horizontal_coefficient_width = stbir__get_coefficient_width(info.horizontal_filter, info.horizontal_scale);
+	info.vertical_coefficient_width = stbir__get_coefficient_width(info.vertical_filter, info.vertical_scale);
+	info.horizontal_filter_pixel_width = stbir__get_filter_pixel_width(info.horizontal_filter, info.horizontal_scale);
+	info.vertical_filter_pixel_width = stbir__get_filter_pixel_width(info.vertical_filter, info.vertical_scale);
+	info.horizontal_filter_pixel_margin = stbir__get_filter_pixel_margin(info.horizontal_filter, info.horizontal_scale);
+	info.vertical_filter_pixel_margin = stbir__get_filter_pixel_margin(info.vertical_filter, info.vertical_scale);
+
+	info.ring_buffer_length_bytes = static_cast<int>(info.output_w * info.channels * sizeof(float));
+	info.decode_buffer_pixels = info.input_w + info.horizontal_filter_pixel_margin * 2;
+
+	auto coefficientsSize = static_cast<size_t>(info.horizontal_contributors_size) + info.horizontal_coefficients_size + info.vertical_contributors_size + info.vertical_coefficients_size;
+	m_coefficients = std::unique_ptr<uint8_t[]> {new uint8_t[coefficientsSize] {}};
+	auto *ptr = m_coefficients.get();
+	info.horizontal_contributors = reinterpret_cast<stbir__contributors *>(ptr);
+	ptr += info.horizontal_contributors_size;
+	info.horizontal_coefficients = reinterpret_cast<float *>(ptr);
+	ptr += info.horizontal_coefficients_size;
+	info.vertical_contributors = reinterpret_cast<stbir__contributors *>(ptr);
+	ptr += info.vertical_contributors_size;
+	info.vertical_coefficients = reinterpret_cast<float *>(ptr);
+
+	stbir__calculate_filters(info.horizontal_contributors, info.horizontal_coefficients, info.horizontal_filter, info.horizontal_scale, info.horizontal_shift, info.input_w, info.output_w);
+	stbir__calculate_filters(info.vertical_contributors, info.vertical_coefficients, info.vertical_filter, info.vertical_scale, info.vertical_shift, info.input_h, info.output_h);
+	return true;
+}
+
+size_t pragma::image::ResizePlan::Resizer::GetScratchSize() const { return static_cast<size_t>(m_info.decode_buffer_size) + m_info.horizontal_buffer_size + m_info.ring_buffer_size + m_info.encode_buffer_size; }
+
+void pragma::image::ResizePlan::Resizer::ResizeRows(const void *src, void *dst, uint32_t yStart, uint32_t yEnd, void *scratch) const
+{
+	auto info = m_info;
+	info.input_data = src;
+	info.output_data = dst;
+	memset(scratch, 0, GetScratchSize());
+	auto *ptr = static_cast<uint8_t *>(scratch);
+	info.decode_buffer = reinterpret_cast<float *>(ptr);
+	ptr += info.decode_buffer_size;
+	if(stbir__use_height_upsampling(&info)) {
+		info.horizontal_buffer = nullptr;
+		info.ring_buffer = reinterpret_cast<float *>(ptr);
+		info.encode_buffer = reinterpret_cast<float *>(ptr + info.ring_buffer_size);
+	}
+	else {
+		info.horizontal_buffer = reinterpret_cast<float *>(ptr);
+		info.ring_buffer = reinterpret_cast<float *>(ptr + info.horizontal_buffer_size);
+		info.encode_buffer = nullptr;
+	}
+	// This signals that the ring buffer is empty
+	info.ring_buffer_begin_index = -1;
+
+	if(stbir__use_height_upsampling(&info))
+		ResizeRowsUpsample(info, yStart, yEnd);
+	else
+		ResizeRowsDownsample(info, yStart, yEnd);
+}
+
+// Same as stbir__buffer_loop_upsample, restricted to the output rows [yStart, yEnd)
+void pragma::image::ResizePlan::Resizer::ResizeRowsUpsample(stbir__info &info, int32_t yStart, int32_t yEnd)
+{
+	auto scaleRatio = info.vertical_scale;
+	auto outScanlinesRadius = stbir__filter_info_table[info.vertical_filter].support(1 / scaleRatio) * scaleRatio;
+	for(auto y = yStart; y < yEnd; ++y) {
+		float inCenterOfOut = 0;
+		int inFirstScanline = 0;
+		int inLastScanline = 0;
+		stbir__calculate_sample_range_upsample(y, outScanlinesRadius, scaleRatio, info.vertical_shift, &inFirstScanline, &inLastScanline, &inCenterOfOut);
+
+		if(info.ring_buffer_begin_index >= 0) {
+			// Get rid of whatever we don't need anymore
+			while(inFirstScanline > info.ring_buffer_first_scanline) {
+				if(info.ring_buffer_first_scanline == info.ring_buffer_last_scanline) {
+					info.ring_buffer_begin_index = -1;
+					info.ring_buffer_first_scanline = 0;
+					info.ring_buffer_last_scanline = 0;
+					break;
+				}
+				++info.ring_buffer_first_scanline;
+				info.ring_buffer_begin_index = (info.ring_buffer_begin_index + 1) % info.ring_buffer_num_entries;
+			}
+		}
+
+		if(info.ring_buffer_begin_index < 0)
+			stbir__decode_and_resample_upsample(&info, inFirstScanline);
+		while(inLastScanline > info.ring_buffer_last_scanline)
+			stbir__decode_and_resample_upsample(&info, info.ring_buffer_last_scanline + 1);
+
+		stbir__resample_vertical_upsample(&info, y);
+	}
+}
+
+// Same as stbir__buffer_loop_downsample, but only input rows that contribute to the output rows [yStart, yEnd) are processed.
+// Rows outside of the band accumulate partial results in the ring buffer, but are never written.
+void pragma::image::ResizePlan::Resizer::ResizeRowsDownsample(stbir__info &info, int32_t yStart, int32_t yEnd)
+{
+	auto scaleRatio = info.vertical_scale;
+	auto inPixelsRadius = stbir__filter_info_table[info.vertical_filter].support(scaleRatio) / scaleRatio;
+	auto pixelMargin = info.vertical_filter_pixel_margin;
+	auto maxY = info.input_h + pixelMargin;
+	for(auto y = -pixelMargin; y < maxY; ++y) {
+		float outCenterOfIn = 0;
+		int outFirstScanline = 0;
+		int outLastScanline = 0;
+		stbir__calculate_sample_range_downsample(y, inPixelsRadius, scaleRatio, info.vertical_shift, &outFirstScanline, &outLastScanline, &outCenterOfIn);
+		if(outLastScanline < yStart || outFirstScanline >= yEnd)
+			continue;
+
+		EmptyRingBuffer(info, outFirstScanline, yStart, yEnd);
+		stbir__decode_and_resample_downsample(&info, y);
+
+		if(info.ring_buffer_begin_index < 0)
+			stbir__add_empty_ring_buffer_entry(&info, outFirstScanline);
+		while(outLastScanline > info.ring_buffer_last_scanline)
+			stbir__add_empty_ring_buffer_entry(&info, info.ring_buffer_last_scanline + 1);
+
+		stbir__resample_vertical_downsample(&info, y);
+	}
+	EmptyRingBuffer(info, info.output_h, yStart, yEnd);
+}
+
+// Same as stbir__empty_ring_buffer, except that only rows within [yStart, yEnd) are written to the output
+void pragma::image::ResizePlan::Resizer::EmptyRingBuffer(stbir__info &info, int32_t firstNecessaryScanline, int32_t yStart, int32_t yEnd)
+{
+	if(info.ring_buffer_begin_index < 0)
+		return;
+	auto decode = STBIR__DECODE(info.type, info.colorspace);
+	auto ringBufferLength = info.ring_buffer_length_bytes / static_cast<int>(sizeof(float));
+	while(firstNecessaryScanline > info.ring_buffer_first_scanline) {
+		if(info.ring_buffer_first_scanline >= yStart && info.ring_buffer_first_scanline < yEnd) {
+			auto *ringBufferEntry = stbir__get_ring_buffer_entry(info.ring_buffer, info.ring_buffer_begin_index, ringBufferLength);
+			auto *outputRow = static_cast<char *>(info.output_data) + static_cast<size_t>(info.ring_buffer_first_scanline) * info.output_stride_bytes;
+			stbir__encode_scanline(&info, info.output_w, outputRow, ringBufferEntry, info.channels, info.alpha_channel, decode);
+		}
+		if(info.ring_buffer_first_scanline == info.ring_buffer_last_scanline) {
+			info.ring_buffer_begin_index = -1;
+			info.ring_buffer_first_scanline = 0;
+			info.ring_buffer_last_scanline = 0;
+			break;
+		}
+		++info.ring_buffer_first_scanline;
+		info.ring_buffer_begin_index = (info.ring_buffer_begin_index + 1) % info.ring_buffer_num_entries;
+	}
+}
+
+static std::optional<pragma::image::ResampleFilter> to_resample_filter(pragma::image::Filter filter, bool downsample)
+{
+	using namespace pragma::image;
+	switch(filter) {
+	case Filter::Default:
+		// Same choice as stb_image_resize
+		return downsample ? ResampleFilter::Mitchell : ResampleFilter::CatmullRom;
+	case Filter::Box:
+		return ResampleFilter::Box;
+	case Filter::Triangle:
+		return ResampleFilter::Triangle;
+	case Filter::CubicBSpline:
+		return ResampleFilter::CubicBSpline;
+	case Filter::CatmullRom:
+		return ResampleFilter::CatmullRom;
+	case Filter::Mitchell:
+		return ResampleFilter::Mitchell;
+	default:
+		return {};
+	}
+}
+
+std::unique_ptr<pragma::image::ResizePlan> pragma::image::ResizePlan::Create(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, Format format, EdgeAddressMode addressMode, Filter filter, ColorSpace colorSpace, ResizeBackend backend)
+{
+	if(srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0)
+		return nullptr;
+	auto plan = std::unique_ptr<ResizePlan> {new ResizePlan {}};
+	// downsample_2x2 treats 16-bit values as half floats like the native resampler, while stb_image_resize treats them as unorm16,
+	// so 16-bit images always go through stb_image_resize if it was requested explicitly
+	auto useDownsample2x2 = can_downsample_2x2(srcWidth, srcHeight, dstWidth, dstHeight, format, filter, colorSpace) && !(backend == ResizeBackend::Stb && ImageBuffer::GetChannelSize(format) == 2);
+	if(!useDownsample2x2) {
+		// stb_image_resize has no SIMD paths, which mostly matters for HDR and float images
+		if(backend == ResizeBackend::Native || (backend == ResizeBackend::Auto && ImageBuffer::GetChannelSize(format) > 1)) {
+			// Like stb_image_resize, the default filter is chosen for each axis separately
+			auto horizontalFilter = to_resample_filter(filter, dstWidth < srcWidth);
+			auto verticalFilter = to_resample_filter(filter, dstHeight < srcHeight);
+			if(horizontalFilter && verticalFilter)
+				plan->m_resamplePlan = ResamplePlan::Create(srcWidth, srcHeight, dstWidth, dstHeight, format, *horizontalFilter, *verticalFilter, addressMode, colorSpace);
+			if(!plan->m_resamplePlan && backend == ResizeBackend::Native)
+				return nullptr;
+		}
+		if(!plan->m_resamplePlan) {
+			auto params = get_stb_resize_params(format, addressMode, filter, colorSpace);
+			if(!params)
+				return nullptr;
+			auto resizer = std::make_unique<Resizer>();
+			if(!resizer->Initialize(*params, srcWidth, srcHeight, dstWidth, dstHeight))
+				return nullptr;
+			plan->m_resizer = std::move(resizer);
+		}
+	}
+	plan->m_srcWidth = srcWidth;
+	plan->m_srcHeight = srcHeight;
+	plan->m_dstWidth = dstWidth;
+	plan->m_dstHeight = dstHeight;
+	plan->m_format = format;
+	plan->m_addressMode = addressMode;
+	plan->m_filter = filter;
+	plan->m_colorSpace = colorSpace;
+	plan->m_backend = backend;
+	return plan;
+}
+
+std::shared_ptr<const pragma::image::ResizePlan> pragma::image::ResizePlan::Get(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, Format format, EdgeAddressMode addressMode, Filter filter, ColorSpace colorSpace, ResizeBackend backend)
+{
+	// Most recently used plans are at the front
+	static std::vector<std::shared_ptr<const ResizePlan>> cache;
+	static std::mutex cacheMutex;
+	std::scoped_lock lock {cacheMutex};
+	auto it = std::find_if(cache.begin(), cache.end(), [&](const std::shared_ptr<const ResizePlan> &plan) {
+		return plan->m_srcWidth == srcWidth && plan->m_srcHeight == srcHeight && plan->m_dstWidth == dstWidth && plan->m_dstHeight == dstHeight && plan->m_format == format && plan->m_addressMode == addressMode && plan->m_filter == filter && plan->m_colorSpace == colorSpace
+		  && plan->m_backend == backend;
+	});
+	if(it != cache.end()) {
+		std::rotate(cache.begin(), it, it + 1);
+		return cache.front();
+	}
+	std::shared_ptr<const ResizePlan> plan = Create(srcWidth, srcHeight, dstWidth, dstHeight, format, addressMode, filter, colorSpace, backend);
+	if(!plan)
+		return nullptr;
+	if(cache.size() == CACHE_SIZE)
+		cache.pop_back();
+	cache.insert(cache.begin(), plan);
+	return plan;
+}
+
+pragma::image::ResizePlan::ResizePlan() {}
+pragma::image::ResizePlan::~ResizePlan() {}
+
+uint32_t pragma::image::ResizePlan::GetSourceWidth() const { return m_srcWidth; }
+uint32_t pragma::image::ResizePlan::GetSourceHeight() const { return m_srcHeight; }
+uint32_t pragma::image::ResizePlan::GetDestinationWidth() const { return m_dstWidth; }
+uint32_t pragma::image::ResizePlan::GetDestinationHeight() const { return m_dstHeight; }
+pragma::image::Format pragma::image::ResizePlan::GetFormat() const { return m_format; }
+
+bool pragma::image::ResizePlan::Execute(const ImageBuffer &src, ImageBuffer &dst, ResizeScratch *scratch) const
+{
+	if(src.GetWidth() != m_srcWidth || src.GetHeight() != m_srcHeight || src.GetFormat() != m_format || dst.GetWidth() != m_dstWidth || dst.GetHeight() != m_dstHeight || dst.GetFormat() != m_format)
+		return false;
+	Execute(src.GetData(), dst.GetData(), scratch);
+	return true;
+}
+
+// Splits the output image into bands of rows which are resized in parallel.
+// If a scratch arena is specified, the image is resized as a single band on the calling thread without any heap allocations.
+void pragma::image::ResizePlan::Execute(const void *src, void *dst, ResizeScratch *scratch) const
+{
+	if(!m_resizer && !m_resamplePlan) {
+		downsample_2x2(src, m_srcWidth, m_srcHeight, dst, m_dstWidth, m_dstHeight, m_format, m_filter, m_addressMode, m_colorSpace, scratch);
+		return;
+	}
+	auto scratchSize = m_resizer ? m_resizer->GetScratchSize() : m_resamplePlan->GetScratchSize();
+	auto resizeRows = [this, src, dst](uint32_t yStart, uint32_t yEnd, void *rowScratch) {
+		if(m_resizer)
+			m_resizer->ResizeRows(src, dst, yStart, yEnd, rowScratch);
+		else
+			m_resamplePlan->ExecuteRows(src, dst, yStart, yEnd, rowScratch);
+	};
+	if(scratch) {
+		scratch->Reset();
+		resizeRows(0, m_dstHeight, scratch->Allocate(scratchSize));
+		// Grows the arena right away if this resize did not fit, so the next call doesn't have to allocate
+		scratch->Reset();
+		return;
+	}
+	// Every band has to decode all input rows within the filter support of its output rows,
+	// so bands shouldn't be too small. A few bands per thread help balance the load.
+	constexpr uint32_t minRowsPerBand = 16;
+	auto numThreads = ThreadPool::Get().GetThreadCount();
+	auto rowsPerBand = std::max((m_dstHeight + numThreads * 4 - 1) / (numThreads * 4), minRowsPerBand);
+	auto numBands = (m_dstHeight + rowsPerBand - 1) / rowsPerBand;
+	parallel_for(numBands, [&](uint32_t band) {
+		auto yStart = band * rowsPerBand;
+		auto yEnd = std::min(yStart + rowsPerBand, m_dstHeight);
+		std::unique_ptr<uint8_t[]> scratch {new uint8_t[scratchSize]};
+		resizeRows(yStart, yEnd, scratch.get());
+	});
+}
+
+void pragma::image::ImageBuffer::Resize(Size width, Size height, EdgeAddressMode addressMode, Filter filter, ColorSpace colorSpace, ResizeBackend backend)
+{
+	if(width == m_width && height == m_height)
 		return;
+	auto plan = ResizePlan::Get(m_width, m_height, width, height, GetFormat(), addressMode, filter, colorSpace, backend);
+	if(!plan)
+		return;
+	auto imgResized = Create(width, height, GetFormat());
+	plan->Execute(GetData(), imgResized->GetData());
 	*this = *imgResized;
 }
 
+bool pragma::image::ImageBuffer::ResizeInto(ImageBuffer &dst, EdgeAddressMode addressMode, Filter filter, ColorSpace colorSpace, ResizeScratch *scratch, ResizeBackend backend) const
+{
+	if(dst.GetFormat() != GetFormat() || &dst == this)
+		return false;
+	if(dst.GetWidth() == m_width && dst.GetHeight() == m_height) {
+		memcpy(dst.GetData(), GetData(), GetSize());
+		return true;
+	}
+	auto plan = ResizePlan::Get(m_width, m_height, dst.GetWidth(), dst.GetHeight(), GetFormat(), addressMode, filter, colorSpace, backend);
+	if(!plan)
+		return false;
+	plan->Execute(GetData(), dst.GetData(), scratch);
+	return true;
+}
+
+pragma::image::MipmapChain pragma::image::ImageBuffer::GenerateMipmaps(Filter filter, ColorSpace colorSpace, EdgeAddressMode addressMode, uint32_t numLevels) const
+{
+	MipmapChain chain {};
+	if(m_width == 0 || m_height == 0 || GetChannelSize(m_format) == 0)
+		return chain;
+	chain.Initialize(*this, numLevels);
+
+	// Each level is generated from the previous one
+	for(auto i = decltype(numLevels) {1u}; i < chain.GetLevelCount(); ++i) {
+		auto &src = chain.m_levels[i - 1];
+		auto &dst = chain.m_levels[i];
+		auto plan = ResizePlan::Get(src.width, src.height, dst.width, dst.height, m_format, addressMode, filter, colorSpace);
+		if(!plan)
+			return {};
+		plan->Execute(chain.GetLevelData(i - 1), chain.GetLevelData(i));
+	}
+	return chain;
+}
+
+pragma::image::MipmapChain pragma::image::ImageBuffer::GenerateMipmaps(ResampleFilter filter, ColorSpace colorSpace, EdgeAddressMode addressMode, uint32_t numLevels) const
+{
+	MipmapChain chain {};
+	if(m_width == 0 || m_height == 0 || GetChannelSize(m_format) == 0)
+		return chain;
+	chain.Initialize(*this, numLevels);
+	for(auto i = decltype(numLevels) {1u}; i < chain.GetLevelCount(); ++i) {
+		auto &src = chain.m_levels[i - 1];
+		auto &dst = chain.m_levels[i];
+		if(!resample(chain.GetLevelData(i - 1), src.width, src.height, chain.GetLevelData(i), dst.width, dst.height, m_format, filter, addressMode, colorSpace))
+			return {};
+	}
+	return chain;
+}
+
+void pragma::image::MipmapChain::Initialize(const ImageBuffer &baseLevel, uint32_t numLevels)
+{
+	auto w = baseLevel.GetWidth();
+	auto h = baseLevel.GetHeight();
+	auto maxLevels = calculate_mipmap_count(w, h);
+	numLevels = (numLevels == 0) ? maxLevels : std::min(numLevels, maxLevels);
+
+	m_format = baseLevel.GetFormat();
+	m_levels.clear();
+	m_levels.reserve(numLevels);
+	size_t totalSize = 0;
+	for(auto i = decltype(numLevels) {0u}; i < numLevels; ++i) {
+		Level level {};
+		calculate_mipmap_size(w, h, level.width, level.height, i);
+		level.offset = totalSize;
+		level.size = static_cast<size_t>(level.width) * level.height * baseLevel.GetPixelSize();
+		totalSize += level.size;
+		m_levels.push_back(level);
+	}
+	m_data = std::shared_ptr<uint8_t[]> {new uint8_t[totalSize]};
+	memcpy(m_data.get(), baseLevel.GetData(), m_levels.front().size);
+}
+
+pragma::image::Format pragma::image::MipmapChain::GetFormat() const { return m_format; }
+uint32_t pragma::image::MipmapChain::GetLevelCount() const { return static_cast<uint32_t>(m_levels.size()); }
+uint32_t pragma::image::MipmapChain::GetWidth(uint32_t level) const { return m_levels[level].width; }
+uint32_t pragma::image::MipmapChain::GetHeight(uint32_t level) const { return m_levels[level].height; }
+size_t pragma::image::MipmapChain::GetLevelOffset(uint32_t level) const { return m_levels[level].offset; }
+size_t pragma::image::MipmapChain::GetLevelSize(uint32_t level) const { return m_levels[level].size; }
+void *pragma::image::MipmapChain::GetLevelData(uint32_t level) { return m_data.get() + m_levels[level].offset; }
+const void *pragma::image::MipmapChain::GetLevelData(uint32_t level) const { return const_cast<MipmapChain *>(this)->GetLevelData(level); }
+const void *pragma::image::MipmapChain::GetData() const { return m_data.get(); }
+void *pragma::image::MipmapChain::GetData() { return m_data.get(); }
+size_t pragma::image::MipmapChain::GetSize() const { return m_levels.empty() ? 0 : (m_levels.back().offset + m_levels.back().size); }
+std::shared_ptr<pragma::image::ImageBuffer> pragma::image::MipmapChain::GetLevel(uint32_t level) const
+{
+	auto &info = m_levels[level];
+	// The buffer references the chain's memory directly and keeps it alive
+	return ImageBuffer::CreateWithCustomDeleter(m_data.get() + info.offset, info.width, info.height, m_format, [data = m_data](void *) {});
+}
+
+void pragma::image::ResizeScratch::Reserve(size_t size)
+{
+	if(size <= m_capacity)
+		return;
+	m_data = std::unique_ptr<uint8_t[]> {new uint8_t[size]};
+	m_capacity = size;
+	m_offset = 0;
+	m_required = 0;
+	m_overflow.clear();
+}
+size_t pragma::image::ResizeScratch::GetCapacity() const { return m_capacity; }
+void pragma::image::ResizeScratch::Release()
+{
+	m_data = nullptr;
+	m_capacity = 0;
+	m_offset = 0;
+	m_required = 0;
+	m_overflow.clear();
+}
+void pragma::image::ResizeScratch::Reset()
+{
+	if(!m_overflow.empty()) {
+		m_overflow.clear();
+		auto required = m_required;
+		m_required = 0;
+		Reserve(required);
+	}
+	m_offset = 0;
+	m_required = 0;
+}
+void *pragma::image::ResizeScratch::Allocate(size_t size, size_t alignment)
+{
+	// Padding is accounted for generously, since the alignment of the base address may change when the arena is reallocated
+	m_required += size + alignment;
+	if(m_data) {
+		auto base = reinterpret_cast<uintptr_t>(m_data.get());
+		auto aligned = (base + m_offset + alignment - 1) / alignment * alignment;
+		if(aligned + size <= base + m_capacity) {
+			m_offset = aligned + size - base;
+			return reinterpret_cast<void *>(aligned);
+		}
+	}
+	auto &block = m_overflow.emplace_back(new uint8_t[size + alignment]);
+	auto aligned = (reinterpret_cast<uintptr_t>(block.get()) + alignment - 1) / alignment * alignment;
+	return reinterpret_cast<void *>(aligned);
+}
+
 std::ostream &operator<<(std::ostream &out, const pragma::image::ImageBuffer &o)
 {
 	out << "ImageBuffer";
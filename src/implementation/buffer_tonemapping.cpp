@@ -4,20 +4,11 @@
 module pragma.image;
 
 import :buffer;
+import :core;
 
-constexpr float GAMMA = 2.2;
-constexpr float INV_GAMMA = 1.0 / GAMMA;
+Vector3 pragma::image::linear_to_srgb(const Vector3 &color) { return {linear_to_srgb(color.r), linear_to_srgb(color.g), linear_to_srgb(color.b)}; }
 
-constexpr Vector3 VGAMMA {GAMMA};
-constexpr Vector3 VINV_GAMMA {INV_GAMMA};
-
-// linear to sRGB approximation
-// see http://chilliant.blogspot.com/2012/08/srgb-approximations-for-hlsl.html
-Vector3 pragma::image::linear_to_srgb(const Vector3 &color) { return glm::pow(color, VINV_GAMMA); }
-
-// sRGB to linear approximation
-// see http://chilliant.blogspot.com/2012/08/srgb-approximations-for-hlsl.html
-Vector3 pragma::image::srgb_to_linear(const Vector3 &srgbIn) { return glm::pow(srgbIn, VGAMMA); }
+Vector3 pragma::image::srgb_to_linear(const Vector3 &srgbIn) { return {srgb_to_linear(srgbIn.r), srgb_to_linear(srgbIn.g), srgb_to_linear(srgbIn.b)}; }
 
 // Uncharted 2 tone map
 // see: http://filmicworlds.com/blog/filmic-tonemapping-operators/
@@ -37,7 +28,7 @@ static Vector3 tone_mapping_uncharted(const Vector3 &color)
 	const float W = 11.2;
 	auto toneMappedColor = tone_mapping_uncharted2_impl(color * 2.f);
 	auto whiteScale = 1.0 / tone_mapping_uncharted2_impl(uvec::vec3(W));
-	return pragma::image::linear_to_srgb(toneMappedColor * whiteScale);
+	return toneMappedColor * whiteScale;
 }
 
 // Hejl Richard tone map
@@ -57,16 +48,13 @@ static Vector3 tone_mapping_aces(const Vector3 &color)
 	const float C = 2.43;
 	const float D = 0.59;
 	const float E = 0.14;
-	return pragma::image::linear_to_srgb(glm::clamp((color * (A * color + B)) / (color * (C * color + D) + E), 0.f, 1.f));
+	return glm::clamp((color * (A * color + B)) / (color * (C * color + D) + E), 0.f, 1.f);
 }
 
 static Vector3 tone_mapping_reinhard(const Vector3 &color)
 {
 	// reinhard tone mapping
-	auto mapped = color / (color + uvec::vec3(1.0));
-	// gamma correction
-	mapped = glm::pow(mapped, uvec::vec3(1.0 / GAMMA));
-	return mapped;
+	return color / (color + uvec::vec3(1.0));
 }
 
 static Vector3 uchimura(const Vector3 &x, float P, float a, float m, float l, float c, float b)
@@ -99,9 +87,12 @@ static Vector3 tone_mapping_gran_turismo(const Vector3 &x)
 	const float c = 1.33; // black
 	const float b = 0.0;  // pedestal
 
-	return pragma::image::linear_to_srgb(uchimura(x, P, a, m, l, c, b));
+	return uchimura(x, P, a, m, l, c, b);
 }
 
+// Encodes a linear color with the exact sRGB curve
+static std::array<uint8_t, 3> to_srgb_color(const Vector3 &col) { return {pragma::image::linear_to_srgb8(col.r), pragma::image::linear_to_srgb8(col.g), pragma::image::linear_to_srgb8(col.b)}; }
+
 static std::array<uint8_t, 3> to_ldr_color(const Vector3 &col)
 {
 	return {static_cast<uint8_t>(pragma::math::min(col.r * std::numeric_limits<uint8_t>::max(), static_cast<float>(std::numeric_limits<uint8_t>::max()))),
@@ -143,22 +134,22 @@ std::shared_ptr<pragma::image::ImageBuffer> pragma::image::ImageBuffer::ApplyTon
 	std::function<std::array<uint8_t, 3>(const Vector3 &)> fToneMapper = nullptr;
 	switch(toneMappingMethod) {
 	case ToneMapping::GammaCorrection:
-		fToneMapper = [](const Vector3 &hdrCol) -> std::array<uint8_t, 3> { return to_ldr_color(linear_to_srgb(hdrCol)); };
+		fToneMapper = [](const Vector3 &hdrCol) -> std::array<uint8_t, 3> { return to_srgb_color(hdrCol); };
 		break;
 	case ToneMapping::Reinhard:
-		fToneMapper = [](const Vector3 &hdrCol) -> std::array<uint8_t, 3> { return to_ldr_color(tone_mapping_reinhard(hdrCol)); };
+		fToneMapper = [](const Vector3 &hdrCol) -> std::array<uint8_t, 3> { return to_srgb_color(tone_mapping_reinhard(hdrCol)); };
 		break;
 	case ToneMapping::HejilRichard:
 		fToneMapper = [](const Vector3 &hdrCol) -> std::array<uint8_t, 3> { return to_ldr_color(tone_mapping_hejil_richard(hdrCol)); };
 		break;
 	case ToneMapping::Uncharted:
-		fToneMapper = [](const Vector3 &hdrCol) -> std::array<uint8_t, 3> { return to_ldr_color(tone_mapping_uncharted(hdrCol)); };
+		fToneMapper = [](const Vector3 &hdrCol) -> std::array<uint8_t, 3> { return to_srgb_color(tone_mapping_uncharted(hdrCol)); };
 		break;
 	case ToneMapping::Aces:
-		fToneMapper = [](const Vector3 &hdrCol) -> std::array<uint8_t, 3> { return to_ldr_color(tone_mapping_aces(hdrCol)); };
+		fToneMapper = [](const Vector3 &hdrCol) -> std::array<uint8_t, 3> { return to_srgb_color(tone_mapping_aces(hdrCol)); };
 		break;
 	case ToneMapping::GranTurismo:
-		fToneMapper = [](const Vector3 &hdrCol) -> std::array<uint8_t, 3> { return to_ldr_color(tone_mapping_gran_turismo(hdrCol)); };
+		fToneMapper = [](const Vector3 &hdrCol) -> std::array<uint8_t, 3> { return to_srgb_color(tone_mapping_gran_turismo(hdrCol)); };
 		break;
 	}
 	return ApplyToneMapping(fToneMapper);
@@ -228,6 +228,10 @@ std::optional<image::ITextureCompressor::ResultData> image::CompressonatorTextur
 
 	auto &textureSaveInfo = compressInfo.textureSaveInfo;
 	auto &texInfo = compressInfo.textureSaveInfo.texInfo;
+	if(compressInfo.outputHandler.index() == 1 && texInfo.containerFormat == image::TextureInfo::ContainerFormat::KTX2) {
+		compressInfo.errorHandler("KTX2 container format is not supported by compressonator");
+		return {};
+	}
 	auto cmpFormat = to_cmp_enum(texInfo.outputFormat);
 	auto origFormat = to_cmp_enum(texInfo.inputFormat);
 	if(!cmpFormat) {
@@ -0,0 +1,360 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module pragma.image;
+
+import :compressors.etc2;
+
+// Pixels within a block are stored in column-major order (index = x * 4 + y), which is the order of the pixel indices in ETC and EAC blocks
+namespace etc {
+	using Color = std::array<int32_t, 3>;
+	static constexpr std::array<std::array<int32_t, 2>, 8> ETC1_MODIFIERS {{{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}}};
+	static constexpr std::array<std::array<int32_t, 8>, 16> EAC_MODIFIERS {{
+	  {-3, -6, -9, -15, 2, 5, 8, 14},
+	  {-3, -7, -10, -13, 2, 6, 9, 12},
+	  {-2, -5, -8, -13, 1, 4, 7, 12},
+	  {-2, -4, -6, -13, 1, 3, 5, 12},
+	  {-3, -6, -8, -12, 2, 5, 7, 11},
+	  {-3, -7, -9, -11, 2, 6, 8, 10},
+	  {-4, -7, -8, -11, 3, 6, 7, 10},
+	  {-3, -5, -8, -11, 2, 4, 7, 10},
+	  {-2, -6, -8, -10, 1, 5, 7, 9},
+	  {-2, -5, -8, -10, 1, 4, 7, 9},
+	  {-2, -4, -8, -10, 1, 3, 7, 9},
+	  {-2, -5, -7, -10, 1, 4, 6, 9},
+	  {-3, -4, -7, -10, 2, 3, 6, 9},
+	  {-1, -2, -3, -10, 0, 1, 2, 9},
+	  {-4, -6, -8, -9, 3, 5, 7, 8},
+	  {-3, -5, -7, -9, 2, 4, 6, 8},
+	}};
+
+	static int32_t get_etc1_modifier(uint32_t table, uint32_t index)
+	{
+		// Index bits (msb, lsb): 00 = +a, 01 = +b, 10 = -a, 11 = -b
+		auto v = ETC1_MODIFIERS[table][index & 1];
+		return (index & 2) ? -v : v;
+	}
+	static int32_t clamp255(int32_t v) { return std::clamp(v, 0, 255); }
+	static int32_t extend4(int32_t v) { return (v << 4) | v; }
+	static int32_t extend5(int32_t v) { return (v << 3) | (v >> 2); }
+	static int32_t extend6(int32_t v) { return (v << 2) | (v >> 4); }
+	static int32_t extend7(int32_t v) { return (v << 1) | (v >> 6); }
+	static int32_t quantize(float v, int32_t maxValue) { return std::clamp(static_cast<int32_t>(std::lround(v * maxValue / 255.f)), 0, maxValue); }
+	static uint32_t get_color_error(const Color &a, const Color &b)
+	{
+		uint32_t err = 0;
+		for(size_t c = 0; c < a.size(); ++c)
+			err += (a[c] - b[c]) * (a[c] - b[c]);
+		return err;
+	}
+
+	static void write_block(uint64_t block, uint8_t *dst)
+	{
+		// Blocks are stored in big-endian order
+		for(uint32_t i = 0; i < 8; ++i)
+			dst[i] = static_cast<uint8_t>(block >> (56 - i * 8));
+	}
+
+	template<typename TFunc>
+	static void for_each_block(const uint8_t *src, uint32_t width, uint32_t height, uint32_t stride, uint32_t pixelSize, uint8_t *dst, uint32_t blockSize, const TFunc &fn)
+	{
+		auto blocksX = (width + 3) / 4;
+		auto blocksY = (height + 3) / 4;
+		std::array<const uint8_t *, 16> pixels;
+		for(uint32_t by = 0; by < blocksY; ++by) {
+			for(uint32_t bx = 0; bx < blocksX; ++bx) {
+				for(uint32_t x = 0; x < 4; ++x) {
+					auto px = std::min(bx * 4 + x, width - 1);
+					for(uint32_t y = 0; y < 4; ++y) {
+						auto py = std::min(by * 4 + y, height - 1);
+						pixels[x * 4 + y] = src + static_cast<size_t>(py) * stride + static_cast<size_t>(px) * pixelSize;
+					}
+				}
+				fn(pixels, dst + (static_cast<size_t>(by) * blocksX + bx) * blockSize);
+			}
+		}
+	}
+
+	struct SubblockFit {
+		uint32_t error = std::numeric_limits<uint32_t>::max();
+		uint32_t table = 0;
+		// Pixel index bits in block layout (msb in the upper, lsb in the lower 16 bits)
+		uint32_t indices = 0;
+	};
+	// Finds the modifier table and per-pixel modifiers with the smallest error for the given base color
+	static SubblockFit fit_subblock(const std::array<Color, 16> &block, const std::array<uint8_t, 8> &pixels, const Color &base)
+	{
+		SubblockFit best {};
+		for(uint32_t t = 0; t < ETC1_MODIFIERS.size(); ++t) {
+			SubblockFit fit {};
+			fit.error = 0;
+			fit.table = t;
+			for(auto i : pixels) {
+				auto bestPxErr = std::numeric_limits<uint32_t>::max();
+				uint32_t bestIdx = 0;
+				for(uint32_t idx = 0; idx < 4; ++idx) {
+					auto mod = get_etc1_modifier(t, idx);
+					auto err = get_color_error({clamp255(base[0] + mod), clamp255(base[1] + mod), clamp255(base[2] + mod)}, block[i]);
+					if(err < bestPxErr) {
+						bestPxErr = err;
+						bestIdx = idx;
+					}
+				}
+				fit.error += bestPxErr;
+				fit.indices |= ((bestIdx >> 1) << (16 + i)) | ((bestIdx & 1) << i);
+			}
+			if(fit.error < best.error)
+				best = fit;
+		}
+		return best;
+	}
+
+	struct BlockFit {
+		uint32_t error = std::numeric_limits<uint32_t>::max();
+		uint64_t block = 0;
+	};
+	// Individual and differential modes, which are also valid ETC1
+	static void fit_etc1_modes(const std::array<Color, 16> &block, BlockFit &inOutBest)
+	{
+		for(uint32_t flip = 0; flip < 2; ++flip) {
+			// Without flip the subblocks are 2x4 (left/right), with flip 4x2 (top/bottom)
+			std::array<std::array<uint8_t, 8>, 2> subblockPixels;
+			std::array<uint32_t, 2> counts {0, 0};
+			for(uint32_t i = 0; i < 16; ++i) {
+				auto x = i / 4;
+				auto y = i % 4;
+				auto sb = flip ? (y / 2) : (x / 2);
+				subblockPixels[sb][counts[sb]++] = static_cast<uint8_t>(i);
+			}
+			std::array<std::array<float, 3>, 2> avg {};
+			for(uint32_t sb = 0; sb < 2; ++sb) {
+				for(auto i : subblockPixels[sb]) {
+					for(uint32_t c = 0; c < 3; ++c)
+						avg[sb][c] += block[i][c] / 8.f;
+				}
+			}
+
+			// Individual mode: Two 4-bit base colors
+			{
+				std::array<Color, 2> q;
+				std::array<Color, 2> base;
+				for(uint32_t sb = 0; sb < 2; ++sb) {
+					for(uint32_t c = 0; c < 3; ++c) {
+						q[sb][c] = quantize(avg[sb][c], 15);
+						base[sb][c] = extend4(q[sb][c]);
+					}
+				}
+				auto fit0 = fit_subblock(block, subblockPixels[0], base[0]);
+				auto fit1 = fit_subblock(block, subblockPixels[1], base[1]);
+				auto err = fit0.error + fit1.error;
+				if(err < inOutBest.error) {
+					uint64_t v = 0;
+					v |= static_cast<uint64_t>(q[0][0]) << 60 | static_cast<uint64_t>(q[1][0]) << 56;
+					v |= static_cast<uint64_t>(q[0][1]) << 52 | static_cast<uint64_t>(q[1][1]) << 48;
+					v |= static_cast<uint64_t>(q[0][2]) << 44 | static_cast<uint64_t>(q[1][2]) << 40;
+					v |= static_cast<uint64_t>(fit0.table) << 37 | static_cast<uint64_t>(fit1.table) << 34;
+					v |= static_cast<uint64_t>(flip) << 32;
+					v |= fit0.indices | fit1.indices;
+					inOutBest = {err, v};
+				}
+			}
+
+			// Differential mode: A 5-bit base color and a 3-bit signed offset for the second subblock.
+			// The offset is clamped to its range, so the resulting colors never overflow (which would select the T, H or planar modes).
+			{
+				Color q0, d;
+				std::array<Color, 2> base;
+				for(uint32_t c = 0; c < 3; ++c) {
+					q0[c] = quantize(avg[0][c], 31);
+					d[c] = std::clamp(quantize(avg[1][c], 31) - q0[c], -4, 3);
+					base[0][c] = extend5(q0[c]);
+					base[1][c] = extend5(q0[c] + d[c]);
+				}
+				auto fit0 = fit_subblock(block, subblockPixels[0], base[0]);
+				auto fit1 = fit_subblock(block, subblockPixels[1], base[1]);
+				auto err = fit0.error + fit1.error;
+				if(err < inOutBest.error) {
+					uint64_t v = 0;
+					v |= static_cast<uint64_t>(q0[0]) << 59 | static_cast<uint64_t>(d[0] & 7) << 56;
+					v |= static_cast<uint64_t>(q0[1]) << 51 | static_cast<uint64_t>(d[1] & 7) << 48;
+					v |= static_cast<uint64_t>(q0[2]) << 43 | static_cast<uint64_t>(d[2] & 7) << 40;
+					v |= static_cast<uint64_t>(fit0.table) << 37 | static_cast<uint64_t>(fit1.table) << 34;
+					v |= 1ull << 33 | static_cast<uint64_t>(flip) << 32;
+					v |= fit0.indices | fit1.indices;
+					inOutBest = {err, v};
+				}
+			}
+		}
+	}
+
+	// Planar mode: The block is approximated by a plane through three RGB676 colors at (0,0), (4,0) and (0,4), which suits smooth gradients
+	static void fit_planar_mode(const std::array<Color, 16> &block, BlockFit &inOutBest)
+	{
+		// Least-squares fit of c(x,y) = a + b * x + d * y, x and y are in [0,3]
+		Color o, h, v;
+		for(uint32_t c = 0; c < 3; ++c) {
+			float mean = 0.f;
+			float sx = 0.f;
+			float sy = 0.f;
+			for(uint32_t i = 0; i < 16; ++i) {
+				auto val = static_cast<float>(block[i][c]);
+				mean += val / 16.f;
+				sx += (static_cast<int32_t>(i / 4) - 1.5f) * val;
+				sy += (static_cast<int32_t>(i % 4) - 1.5f) * val;
+			}
+			auto b = sx / 20.f;
+			auto d = sy / 20.f;
+			auto a = mean - 1.5f * (b + d);
+			auto maxValue = (c == 1) ? 127 : 63;
+			o[c] = quantize(a, maxValue);
+			h[c] = quantize(a + 4.f * b, maxValue);
+			v[c] = quantize(a + 4.f * d, maxValue);
+		}
+		auto extend = [](const Color &col) -> Color { return {extend6(col[0]), extend7(col[1]), extend6(col[2])}; };
+		auto eo = extend(o);
+		auto eh = extend(h);
+		auto ev = extend(v);
+		uint32_t err = 0;
+		for(uint32_t i = 0; i < 16; ++i) {
+			int32_t x = i / 4;
+			int32_t y = i % 4;
+			Color col;
+			for(uint32_t c = 0; c < 3; ++c)
+				col[c] = clamp255((x * (eh[c] - eo[c]) + y * (ev[c] - eo[c]) + 4 * eo[c] + 2) >> 2);
+			err += get_color_error(col, block[i]);
+		}
+		if(err >= inOutBest.error)
+			return;
+
+		uint64_t bits = 0;
+		auto set = [&bits](uint64_t value, uint32_t msb, uint32_t numBits) { bits |= (value & ((1ull << numBits) - 1)) << (msb + 1 - numBits); };
+		set(o[0], 62, 6);
+		set(o[1] >> 6, 56, 1);
+		set(o[1], 54, 6);
+		set(o[2] >> 5, 48, 1);
+		set(o[2] >> 3, 44, 2);
+		set(o[2], 41, 3);
+		set(h[0] >> 1, 38, 5);
+		set(h[0], 32, 1);
+		set(h[1], 31, 7);
+		set(h[2], 24, 6);
+		set(v[0], 18, 6);
+		set(v[1], 12, 7);
+		set(v[2], 5, 6);
+		set(1, 33, 1); // Differential bit
+		// The remaining bits are chosen so that red and green don't overflow in differential mode, but blue does, which selects the planar mode
+		set((bits >> 58) & 1, 63, 1);
+		set((bits >> 50) & 1, 55, 1);
+		auto b0 = (bits >> 43) & 3;
+		auto b1 = (bits >> 40) & 3;
+		if(b0 + b1 >= 4)
+			set(7, 47, 3); // 28 + b0 + b1 > 31
+		else
+			set(1, 42, 1); // b0 + (b1 - 4) < 0
+		inOutBest = {err, bits};
+	}
+
+	static uint64_t encode_rgb_block(const std::array<Color, 16> &block)
+	{
+		BlockFit best {};
+		fit_etc1_modes(block, best);
+		if(best.error > 0)
+			fit_planar_mode(block, best);
+		return best.block;
+	}
+
+	// EAC blocks store a base value, a multiplier and one of 16 modifier tables, values are in [0,255] for 8-bit alpha and in [0,2047] for 11-bit channels
+	static uint64_t encode_eac_block(const std::array<int32_t, 16> &values, bool elevenBit)
+	{
+		auto [itMin, itMax] = std::minmax_element(values.begin(), values.end());
+		auto minValue = *itMin;
+		auto maxValue = *itMax;
+		auto maxOutput = elevenBit ? 2047 : 255;
+		// A multiplier of 0 is only valid for 11-bit channels, where it corresponds to a step of 1
+		auto getStep = [elevenBit](int32_t m) { return elevenBit ? ((m == 0) ? 1 : m * 8) : m; };
+		auto getBaseValue = [elevenBit](int32_t base) { return elevenBit ? (base * 8 + 4) : base; };
+		auto minMultiplier = elevenBit ? 0 : 1;
+
+		auto bestErr = std::numeric_limits<uint64_t>::max();
+		uint64_t bestBlock = 0;
+		for(uint32_t t = 0; t < EAC_MODIFIERS.size() && bestErr > 0; ++t) {
+			auto &mods = EAC_MODIFIERS[t];
+			auto modMin = mods[3];
+			auto modMax = mods[7];
+			auto idealStep = (maxValue - minValue) / static_cast<float>(modMax - modMin);
+			auto mc = static_cast<int32_t>(std::lround(elevenBit ? (idealStep / 8.f) : idealStep));
+			for(auto m = std::max(mc - 1, minMultiplier); m <= std::min(mc + 1, 15); ++m) {
+				auto step = getStep(m);
+				auto center = (minValue + maxValue) * 0.5f - (modMin + modMax) * step * 0.5f;
+				auto bc = static_cast<int32_t>(std::lround(elevenBit ? ((center - 4.f) / 8.f) : center));
+				for(auto base = std::max(bc - 1, 0); base <= std::min(bc + 1, 255); ++base) {
+					auto baseValue = getBaseValue(base);
+					uint64_t err = 0;
+					uint64_t indices = 0;
+					for(uint32_t i = 0; i < 16; ++i) {
+						auto bestPxErr = std::numeric_limits<int32_t>::max();
+						uint32_t bestIdx = 0;
+						for(uint32_t idx = 0; idx < 8; ++idx) {
+							auto diff = std::clamp(baseValue + mods[idx] * step, 0, maxOutput) - values[i];
+							auto pxErr = diff * diff;
+							if(pxErr < bestPxErr) {
+								bestPxErr = pxErr;
+								bestIdx = idx;
+							}
+						}
+						err += bestPxErr;
+						indices |= static_cast<uint64_t>(bestIdx) << (45 - i * 3);
+					}
+					if(err < bestErr) {
+						bestErr = err;
+						bestBlock = static_cast<uint64_t>(base) << 56 | static_cast<uint64_t>(m) << 52 | static_cast<uint64_t>(t) << 48 | indices;
+					}
+				}
+			}
+		}
+		return bestBlock;
+	}
+
+	static std::array<int32_t, 16> get_channel_values(const std::array<const uint8_t *, 16> &pixels, uint32_t channel, bool elevenBit)
+	{
+		std::array<int32_t, 16> values;
+		for(uint32_t i = 0; i < 16; ++i) {
+			int32_t v = pixels[i][channel];
+			values[i] = elevenBit ? ((v * 2047 + 127) / 255) : v;
+		}
+		return values;
+	}
+	static std::array<Color, 16> get_rgb_values(const std::array<const uint8_t *, 16> &pixels)
+	{
+		std::array<Color, 16> block;
+		for(uint32_t i = 0; i < 16; ++i)
+			block[i] = {pixels[i][0], pixels[i][1], pixels[i][2]};
+		return block;
+	}
+};
+
+void pragma::image::etc2::compress_blocks_rgb(const uint8_t *rgba8, uint32_t width, uint32_t height, uint32_t stride, uint8_t *dst)
+{
+	etc::for_each_block(rgba8, width, height, stride, 4, dst, 8, [](const std::array<const uint8_t *, 16> &pixels, uint8_t *dstBlock) { etc::write_block(etc::encode_rgb_block(etc::get_rgb_values(pixels)), dstBlock); });
+}
+
+void pragma::image::etc2::compress_blocks_rgba(const uint8_t *rgba8, uint32_t width, uint32_t height, uint32_t stride, uint8_t *dst)
+{
+	etc::for_each_block(rgba8, width, height, stride, 4, dst, 16, [](const std::array<const uint8_t *, 16> &pixels, uint8_t *dstBlock) {
+		etc::write_block(etc::encode_eac_block(etc::get_channel_values(pixels, 3, false), false), dstBlock);
+		etc::write_block(etc::encode_rgb_block(etc::get_rgb_values(pixels)), dstBlock + 8);
+	});
+}
+
+void pragma::image::etc2::compress_blocks_r11(const uint8_t *r8, uint32_t width, uint32_t height, uint32_t stride, uint8_t *dst)
+{
+	etc::for_each_block(r8, width, height, stride, 1, dst, 8, [](const std::array<const uint8_t *, 16> &pixels, uint8_t *dstBlock) { etc::write_block(etc::encode_eac_block(etc::get_channel_values(pixels, 0, true), true), dstBlock); });
+}
+
+void pragma::image::etc2::compress_blocks_rg11(const uint8_t *rg8, uint32_t width, uint32_t height, uint32_t stride, uint8_t *dst)
+{
+	etc::for_each_block(rg8, width, height, stride, 2, dst, 16, [](const std::array<const uint8_t *, 16> &pixels, uint8_t *dstBlock) {
+		etc::write_block(etc::encode_eac_block(etc::get_channel_values(pixels, 0, true), true), dstBlock);
+		etc::write_block(etc::encode_eac_block(etc::get_channel_values(pixels, 1, true), true), dstBlock + 8);
+	});
+}
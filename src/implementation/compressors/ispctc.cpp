@@ -8,7 +8,10 @@ module;
 
 module pragma.image;
 
+import :compressors.etc2;
 import :compressors.ispctc;
+import :texture_file;
+import :thread_pool;
 import gli;
 
 enum class TextureFormat {
@@ -20,6 +23,19 @@ enum class TextureFormat {
 	BC5,
 	BC6H,
 	BC7,
+	ETC1,
+	ETC2_R,
+	ETC2_RG,
+	ETC2_RGB,
+	ETC2_RGBA,
+	ASTC_4x4,
+	ASTC_5x4,
+	ASTC_5x5,
+	ASTC_6x5,
+	ASTC_6x6,
+	ASTC_8x5,
+	ASTC_8x6,
+	ASTC_8x8,
 };
 
 struct TextureImageInfo {
@@ -47,6 +63,32 @@ static gli::format to_gli_format(TextureFormat format, bool srgb)
 		return gli::format::FORMAT_RGB_BP_UFLOAT_BLOCK16;
 	case TextureFormat::BC7:
 		return srgb ? gli::format::FORMAT_RGBA_BP_SRGB_BLOCK16 : gli::format::FORMAT_RGBA_BP_UNORM_BLOCK16;
+	case TextureFormat::ETC1:
+		return gli::format::FORMAT_RGB_ETC_UNORM_BLOCK8;
+	case TextureFormat::ETC2_R:
+		return gli::format::FORMAT_R_EAC_UNORM_BLOCK8;
+	case TextureFormat::ETC2_RG:
+		return gli::format::FORMAT_RG_EAC_UNORM_BLOCK16;
+	case TextureFormat::ETC2_RGB:
+		return srgb ? gli::format::FORMAT_RGB_ETC2_SRGB_BLOCK8 : gli::format::FORMAT_RGB_ETC2_UNORM_BLOCK8;
+	case TextureFormat::ETC2_RGBA:
+		return srgb ? gli::format::FORMAT_RGBA_ETC2_SRGB_BLOCK16 : gli::format::FORMAT_RGBA_ETC2_UNORM_BLOCK16;
+	case TextureFormat::ASTC_4x4:
+		return srgb ? gli::format::FORMAT_RGBA_ASTC_4X4_SRGB_BLOCK16 : gli::format::FORMAT_RGBA_ASTC_4X4_UNORM_BLOCK16;
+	case TextureFormat::ASTC_5x4:
+		return srgb ? gli::format::FORMAT_RGBA_ASTC_5X4_SRGB_BLOCK16 : gli::format::FORMAT_RGBA_ASTC_5X4_UNORM_BLOCK16;
+	case TextureFormat::ASTC_5x5:
+		return srgb ? gli::format::FORMAT_RGBA_ASTC_5X5_SRGB_BLOCK16 : gli::format::FORMAT_RGBA_ASTC_5X5_UNORM_BLOCK16;
+	case TextureFormat::ASTC_6x5:
+		return srgb ? gli::format::FORMAT_RGBA_ASTC_6X5_SRGB_BLOCK16 : gli::format::FORMAT_RGBA_ASTC_6X5_UNORM_BLOCK16;
+	case TextureFormat::ASTC_6x6:
+		return srgb ? gli::format::FORMAT_RGBA_ASTC_6X6_SRGB_BLOCK16 : gli::format::FORMAT_RGBA_ASTC_6X6_UNORM_BLOCK16;
+	case TextureFormat::ASTC_8x5:
+		return srgb ? gli::format::FORMAT_RGBA_ASTC_8X5_SRGB_BLOCK16 : gli::format::FORMAT_RGBA_ASTC_8X5_UNORM_BLOCK16;
+	case TextureFormat::ASTC_8x6:
+		return srgb ? gli::format::FORMAT_RGBA_ASTC_8X6_SRGB_BLOCK16 : gli::format::FORMAT_RGBA_ASTC_8X6_UNORM_BLOCK16;
+	case TextureFormat::ASTC_8x8:
+		return srgb ? gli::format::FORMAT_RGBA_ASTC_8X8_SRGB_BLOCK16 : gli::format::FORMAT_RGBA_ASTC_8X8_UNORM_BLOCK16;
 	default:
 		break;
 	}
@@ -103,6 +145,17 @@ static pragma::image::Format to_uimg_format(pragma::image::TextureInfo::InputFor
 	throw std::runtime_error("Unsupported input format for uimg: " + std::string {magic_enum::enum_name(inputFormat)});
 	return {};
 }
+static pragma::image::EdgeAddressMode to_edge_address_mode(pragma::image::TextureInfo::WrapMode wrapMode)
+{
+	switch(wrapMode) {
+	case pragma::image::TextureInfo::WrapMode::Repeat:
+		return pragma::image::EdgeAddressMode::Wrap;
+	case pragma::image::TextureInfo::WrapMode::Mirror:
+		return pragma::image::EdgeAddressMode::Reflect;
+	default:
+		return pragma::image::EdgeAddressMode::Clamp;
+	}
+}
 static bool save_gli(TextureFormat format, const std::string &filename, const TextureImageInfo &imgInfo, bool saveAsKtx, std::string &outErr)
 {
 	auto saveSuccess = false;
@@ -131,10 +184,177 @@ static bool save_dds(DdsLibrary ddsLib, TextureFormat format, const std::string
 }
 static bool save_ktx(TextureFormat format, const std::string &filename, const TextureImageInfo &imgInfo, std::string &outErr) { return save_gli(format, filename, imgInfo, true, outErr); }
 
+static pragma::image::TextureFileFormat to_texture_file_format(TextureFormat format)
+{
+	using pragma::image::TextureFileFormat;
+	switch(format) {
+	case TextureFormat::BC1:
+		return TextureFileFormat::BC1;
+	case TextureFormat::BC1a:
+		return TextureFileFormat::BC1a;
+	case TextureFormat::BC2:
+		return TextureFileFormat::BC2;
+	case TextureFormat::BC3:
+		return TextureFileFormat::BC3;
+	case TextureFormat::BC4:
+		return TextureFileFormat::BC4;
+	case TextureFormat::BC5:
+		return TextureFileFormat::BC5;
+	case TextureFormat::BC6H:
+		return TextureFileFormat::BC6H;
+	case TextureFormat::BC7:
+		return TextureFileFormat::BC7;
+	case TextureFormat::ETC1:
+		return TextureFileFormat::ETC1;
+	case TextureFormat::ETC2_R:
+		return TextureFileFormat::EAC_R11;
+	case TextureFormat::ETC2_RG:
+		return TextureFileFormat::EAC_RG11;
+	case TextureFormat::ETC2_RGB:
+		return TextureFileFormat::ETC2_RGB;
+	case TextureFormat::ETC2_RGBA:
+		return TextureFileFormat::ETC2_RGBA;
+	default:
+		break;
+	}
+	if(format >= TextureFormat::ASTC_4x4 && format <= TextureFormat::ASTC_8x8)
+		return static_cast<TextureFileFormat>(pragma::math::to_integral(TextureFileFormat::ASTC_4x4) + (pragma::math::to_integral(format) - pragma::math::to_integral(TextureFormat::ASTC_4x4)));
+	return TextureFileFormat::Unknown;
+}
+static int32_t get_zstd_level(pragma::image::CompressionSpeed speed)
+{
+	using pragma::image::CompressionSpeed;
+	switch(speed) {
+	case CompressionSpeed::UltraFast:
+		return 1;
+	case CompressionSpeed::VeryFast:
+		return 3;
+	case CompressionSpeed::Fast:
+		return 6;
+	case CompressionSpeed::Basic:
+		return 12;
+	case CompressionSpeed::Slow:
+		return 16;
+	case CompressionSpeed::VerySlow:
+		return 19;
+	default:
+		break;
+	}
+	return 16;
+}
+static bool save_ktx2(TextureFormat format, const std::string &filename, const TextureImageInfo &imgInfo, pragma::image::CompressionSpeed speed, std::string &outErr)
+{
+	auto &texture = imgInfo.texture;
+	pragma::image::Ktx2WriteInfo writeInfo {};
+	writeInfo.format = to_texture_file_format(format);
+	writeInfo.srgb = imgInfo.srgb;
+	writeInfo.width = static_cast<uint32_t>(texture.extent().x);
+	writeInfo.height = static_cast<uint32_t>(texture.extent().y);
+	writeInfo.cubemap = imgInfo.cubemap;
+	writeInfo.numLayers = static_cast<uint32_t>(texture.layers() * texture.faces());
+	writeInfo.numMipmaps = static_cast<uint32_t>(texture.levels());
+#ifdef UIMG_ENABLE_ZSTD
+	writeInfo.supercompression = pragma::image::TextureFileSupercompression::Zstd;
+	writeInfo.compressionLevel = get_zstd_level(speed);
+#else
+	writeInfo.supercompression = pragma::image::TextureFileSupercompression::Zlib;
+#endif
+	writeInfo.getSurfaceData = [&texture, cubemap = imgInfo.cubemap](uint32_t layer, uint32_t mipmap) -> std::span<const uint8_t> {
+		auto l = cubemap ? layer / 6 : layer;
+		auto f = cubemap ? layer % 6 : 0;
+		return {static_cast<const uint8_t *>(texture.data(l, f, mipmap)), texture.size(mipmap)};
+	};
+	if(!pragma::image::write_ktx2(filename, writeInfo)) {
+		outErr = "Failed to save KTX2 file: " + filename;
+		return false;
+	}
+	return true;
+}
+
+static void get_bc6h_profile(pragma::image::CompressionSpeed speed, bc6h_enc_settings &settings)
+{
+	using pragma::image::CompressionSpeed;
+	switch(speed) {
+	case CompressionSpeed::UltraFast:
+	case CompressionSpeed::VeryFast:
+		GetProfile_bc6h_veryfast(&settings);
+		break;
+	case CompressionSpeed::Fast:
+		GetProfile_bc6h_fast(&settings);
+		break;
+	case CompressionSpeed::Basic:
+		GetProfile_bc6h_basic(&settings);
+		break;
+	case CompressionSpeed::VerySlow:
+		GetProfile_bc6h_veryslow(&settings);
+		break;
+	default:
+		GetProfile_bc6h_slow(&settings);
+		break;
+	}
+}
+// The opaque BC7 profiles ignore the alpha channel
+static void get_bc7_profile(pragma::image::CompressionSpeed speed, bool alpha, bc7_enc_settings &settings)
+{
+	using pragma::image::CompressionSpeed;
+	switch(speed) {
+	case CompressionSpeed::UltraFast:
+		alpha ? GetProfile_alpha_ultrafast(&settings) : GetProfile_ultrafast(&settings);
+		break;
+	case CompressionSpeed::VeryFast:
+		alpha ? GetProfile_alpha_veryfast(&settings) : GetProfile_veryfast(&settings);
+		break;
+	case CompressionSpeed::Fast:
+		alpha ? GetProfile_alpha_fast(&settings) : GetProfile_fast(&settings);
+		break;
+	case CompressionSpeed::Basic:
+		alpha ? GetProfile_alpha_basic(&settings) : GetProfile_basic(&settings);
+		break;
+	default:
+		alpha ? GetProfile_alpha_slow(&settings) : GetProfile_slow(&settings);
+		break;
+	}
+}
+// ISPC only provides a slow profile with alpha, the opaque variant uses the same search threshold
+static void get_astc_profile(pragma::image::CompressionSpeed speed, bool alpha, uint32_t blockWidth, uint32_t blockHeight, astc_enc_settings &settings)
+{
+	using pragma::image::CompressionSpeed;
+	switch(speed) {
+	case CompressionSpeed::UltraFast:
+	case CompressionSpeed::VeryFast:
+	case CompressionSpeed::Fast:
+	case CompressionSpeed::Basic:
+		alpha ? GetProfile_astc_alpha_fast(&settings, blockWidth, blockHeight) : GetProfile_astc_fast(&settings, blockWidth, blockHeight);
+		break;
+	default:
+		{
+			GetProfile_astc_alpha_slow(&settings, blockWidth, blockHeight);
+			if(!alpha) {
+				astc_enc_settings alphaSettings = settings;
+				GetProfile_astc_fast(&settings, blockWidth, blockHeight);
+				settings.fastSkipTreshold = alphaSettings.fastSkipTreshold;
+				settings.refineIterations = alphaSettings.refineIterations;
+			}
+			break;
+		}
+	}
+}
+static bool has_transparency(const uint8_t *rgba8, size_t numPixels)
+{
+	for(size_t i = 0; i < numPixels; ++i) {
+		if(rgba8[i * 4 + 3] != std::numeric_limits<uint8_t>::max())
+			return true;
+	}
+	return false;
+}
+
 std::optional<pragma::image::ITextureCompressor::ResultData> pragma::image::IspctcTextureCompressor::Compress(const CompressInfo &compressInfo)
 {
 	auto &texInfo = compressInfo.textureSaveInfo.texInfo;
-	if(pragma::math::to_integral(texInfo.outputFormat) < pragma::math::to_integral(TextureInfo::OutputFormat::BCFirst) || pragma::math::to_integral(texInfo.outputFormat) > pragma::math::to_integral(TextureInfo::OutputFormat::BCLast))
+	auto isBc = pragma::math::to_integral(texInfo.outputFormat) >= pragma::math::to_integral(TextureInfo::OutputFormat::BCFirst) && pragma::math::to_integral(texInfo.outputFormat) <= pragma::math::to_integral(TextureInfo::OutputFormat::BCLast);
+	auto isEtc = pragma::math::to_integral(texInfo.outputFormat) >= pragma::math::to_integral(TextureInfo::OutputFormat::ETC1) && pragma::math::to_integral(texInfo.outputFormat) <= pragma::math::to_integral(TextureInfo::OutputFormat::ETC2_RGB_A1);
+	auto isAstc = pragma::math::to_integral(texInfo.outputFormat) >= pragma::math::to_integral(TextureInfo::OutputFormat::ASTCFirst) && pragma::math::to_integral(texInfo.outputFormat) <= pragma::math::to_integral(TextureInfo::OutputFormat::ASTCLast);
+	if(!isBc && !isEtc && !isAstc)
 		return {};
 
 	TextureFormat dstTexFormat;
@@ -146,6 +366,9 @@ std::optional<pragma::image::ITextureCompressor::ResultData> pragma::image::Ispc
 		outputFormat = TextureInfo::OutputFormat::BC3;
 	else if(outputFormat == TextureInfo::OutputFormat::BC3n)
 		outputFormat = TextureInfo::OutputFormat::BC5;
+	// ETC2 with punch-through alpha is not supported by the native ETC2 encoder, so we fall back to full alpha
+	else if(outputFormat == TextureInfo::OutputFormat::ETC2_RGB_A1)
+		outputFormat = TextureInfo::OutputFormat::ETC2_RGBA;
 
 	Format expectedInputFormat;
 	switch(outputFormat) {
@@ -173,184 +396,421 @@ std::optional<pragma::image::ITextureCompressor::ResultData> pragma::image::Ispc
 		dstTexFormat = TextureFormat::BC7;
 		expectedInputFormat = Format::RGBA8;
 		break;
+	case TextureInfo::OutputFormat::ETC1:
+		dstTexFormat = TextureFormat::ETC1;
+		expectedInputFormat = Format::RGBA8;
+		break;
+	case TextureInfo::OutputFormat::ETC2_R:
+		dstTexFormat = TextureFormat::ETC2_R;
+		expectedInputFormat = Format::R8;
+		break;
+	case TextureInfo::OutputFormat::ETC2_RG:
+		dstTexFormat = TextureFormat::ETC2_RG;
+		expectedInputFormat = Format::RG8;
+		break;
+	case TextureInfo::OutputFormat::ETC2_RGB:
+		dstTexFormat = TextureFormat::ETC2_RGB;
+		expectedInputFormat = Format::RGBA8;
+		break;
+	case TextureInfo::OutputFormat::ETC2_RGBA:
+		dstTexFormat = TextureFormat::ETC2_RGBA;
+		expectedInputFormat = Format::RGBA8;
+		break;
+	case TextureInfo::OutputFormat::ASTC_4x4:
+		dstTexFormat = TextureFormat::ASTC_4x4;
+		expectedInputFormat = Format::RGBA8;
+		break;
+	case TextureInfo::OutputFormat::ASTC_5x4:
+		dstTexFormat = TextureFormat::ASTC_5x4;
+		expectedInputFormat = Format::RGBA8;
+		break;
+	case TextureInfo::OutputFormat::ASTC_5x5:
+		dstTexFormat = TextureFormat::ASTC_5x5;
+		expectedInputFormat = Format::RGBA8;
+		break;
+	case TextureInfo::OutputFormat::ASTC_6x5:
+		dstTexFormat = TextureFormat::ASTC_6x5;
+		expectedInputFormat = Format::RGBA8;
+		break;
+	case TextureInfo::OutputFormat::ASTC_6x6:
+		dstTexFormat = TextureFormat::ASTC_6x6;
+		expectedInputFormat = Format::RGBA8;
+		break;
+	case TextureInfo::OutputFormat::ASTC_8x5:
+		dstTexFormat = TextureFormat::ASTC_8x5;
+		expectedInputFormat = Format::RGBA8;
+		break;
+	case TextureInfo::OutputFormat::ASTC_8x6:
+		dstTexFormat = TextureFormat::ASTC_8x6;
+		expectedInputFormat = Format::RGBA8;
+		break;
+	case TextureInfo::OutputFormat::ASTC_8x8:
+		dstTexFormat = TextureFormat::ASTC_8x8;
+		expectedInputFormat = Format::RGBA8;
+		break;
 	default:
 		return {};
 	}
 
-	gli::texture inputTex;
 	auto srgb = pragma::math::is_flag_set(texInfo.flags, TextureInfo::Flags::SRGB);
 
-	TextureImageInfo dstImageInfo {};
-	auto &outputTex = dstImageInfo.texture;
-	dstImageInfo.srgb = srgb;
-	dstImageInfo.cubemap = compressInfo.textureSaveInfo.cubemap;
-
-	auto gliFormat = to_gli_format(expectedInputFormat);
 	auto numDstMipmaps = compressInfo.numMipmaps;
 	auto genMipmaps = pragma::math::is_flag_set(texInfo.flags, TextureInfo::Flags::GenerateMipmaps);
 	if(genMipmaps)
 		numDstMipmaps = pragma::image::calculate_mipmap_count(compressInfo.width, compressInfo.height);
-	if(compressInfo.numLayers == 1) {
-		inputTex = gli::texture2d {gliFormat, gli::extent2d {compressInfo.width, compressInfo.height}, numDstMipmaps};
-		outputTex = gli::texture2d {to_gli_format(dstTexFormat, srgb), gli::extent2d {compressInfo.width, compressInfo.height}, numDstMipmaps};
-	}
-	else if(dstImageInfo.cubemap) {
-		inputTex = gli::texture_cube {gliFormat, gli::extent3d {compressInfo.width, compressInfo.height, 1}, numDstMipmaps};
-		outputTex = gli::texture_cube {to_gli_format(dstTexFormat, srgb), gli::extent3d {compressInfo.width, compressInfo.height, 1}, numDstMipmaps};
-	}
-	else {
-		inputTex = gli::texture2d_array {gliFormat, gli::extent3d {compressInfo.width, compressInfo.height, 1}, compressInfo.numLayers, numDstMipmaps};
-		outputTex = gli::texture2d_array {to_gli_format(dstTexFormat, srgb), gli::extent3d {compressInfo.width, compressInfo.height, 1}, compressInfo.numLayers, numDstMipmaps};
-	}
+	auto getExtent = [&compressInfo](uint32_t m) -> std::pair<uint32_t, uint32_t> { return {std::max(compressInfo.width >> m, 1u), std::max(compressInfo.height >> m, 1u)}; };
+
+	// The compressor reads the caller's data directly if it is already in the expected format, otherwise it is converted stripe by stripe
+	// right before compression. Only generated mipmaps, and base levels that have to be converted to generate them, are stored.
+	struct Surface {
+		const uint8_t *data = nullptr;
+		bool convert = false;
+		std::unique_ptr<uint8_t[]> storage = nullptr;
+		std::function<void()> deleter = nullptr;
+	};
+	std::vector<Surface> surfaces(static_cast<size_t>(compressInfo.numLayers) * numDstMipmaps);
+	auto getSurface = [&surfaces, numDstMipmaps](uint32_t l, uint32_t m) -> Surface & { return surfaces[static_cast<size_t>(l) * numDstMipmaps + m]; };
+	pragma::util::ScopeGuard sgSurfaces {[&surfaces]() {
+		for(auto &surface : surfaces) {
+			if(surface.deleter)
+				surface.deleter();
+		}
+	}};
+
 	auto swapRedBlue = false; // (texInfo.inputFormat == pragma::image::TextureInfo::InputFormat::B8G8R8A8_UInt);
 	auto uimgFormat = to_uimg_format(texInfo.inputFormat);
-	for(auto l = decltype(compressInfo.numLayers) {0u}; l < compressInfo.numLayers; ++l) {
-		for(auto m = decltype(compressInfo.numMipmaps) {0u}; m < compressInfo.numMipmaps; ++m) {
-			std::function<void(void)> deleter = nullptr;
-			auto *data = compressInfo.getImageData(l, m, deleter);
-			assert(data != nullptr);
-			auto extent = inputTex.extent(m);
-			auto imgBuf = ImageBuffer::Create(const_cast<unsigned char *>(data), extent.x, extent.y, uimgFormat, true);
-			if(swapRedBlue) {
-				// Copy the buffer to not pollute the original data
-				imgBuf = imgBuf->Copy();
-				imgBuf->SwapChannels(Channel::Red, Channel::Blue);
-			}
+	auto needsConversion = swapRedBlue || (uimgFormat != expectedInputFormat);
+	auto srcPixelSize = ImageBuffer::GetPixelSize(uimgFormat);
+	auto dstPixelSize = ImageBuffer::GetPixelSize(expectedInputFormat);
+	auto convertRows = [&](const uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst) {
+		auto srcBuf = ImageBuffer::Create(const_cast<uint8_t *>(src), width, height, uimgFormat, true);
+		auto dstBuf = ImageBuffer::Create(dst, width, height, expectedInputFormat, true);
+		srcBuf->Convert(*dstBuf);
+		if(swapRedBlue)
+			dstBuf->SwapChannels(Channel::Red, Channel::Blue);
+	};
 
-			// Make sure the image is in the expected input format
-			switch(outputFormat) {
-			case TextureInfo::OutputFormat::BC1:
-			case TextureInfo::OutputFormat::BC3:
-			case TextureInfo::OutputFormat::BC7:
-				imgBuf->Convert(Format::RGBA8);
-				break;
-			case TextureInfo::OutputFormat::BC4:
-				imgBuf->Convert(Format::R8);
-				break;
-			case TextureInfo::OutputFormat::BC5:
-				imgBuf->Convert(Format::RG8);
-				break;
-			case TextureInfo::OutputFormat::BC6:
-				imgBuf->Convert(Format::RGBA16);
-				break;
-			default:
+	// Generated mipmaps replace all but the base level
+	auto numSrcMipmaps = genMipmaps ? std::min(compressInfo.numMipmaps, 1u) : compressInfo.numMipmaps;
+	for(auto l = decltype(compressInfo.numLayers) {0u}; l < compressInfo.numLayers; ++l) {
+		for(auto m = decltype(numSrcMipmaps) {0u}; m < numSrcMipmaps; ++m) {
+			auto &surface = getSurface(l, m);
+			auto *data = compressInfo.getImageData(l, m, surface.deleter);
+			if(!data)
 				return {};
+			if(needsConversion && genMipmaps) {
+				auto [w, h] = getExtent(m);
+				surface.storage = std::unique_ptr<uint8_t[]> {new uint8_t[static_cast<size_t>(w) * h * dstPixelSize]};
+				convertRows(data, w, h, surface.storage.get());
+				surface.data = surface.storage.get();
+				if(surface.deleter) {
+					surface.deleter();
+					surface.deleter = nullptr;
+				}
+				continue;
 			}
-
-			memcpy(inputTex.data(dstImageInfo.cubemap ? 0 : l, dstImageInfo.cubemap ? l : 0, m), imgBuf->GetData(), inputTex.size(m));
-			if(deleter)
-				deleter();
+			surface.data = data;
+			surface.convert = needsConversion;
 		}
 	}
 	if(genMipmaps) {
-		// TODO: Choose Filter depending on texture type?
-		auto filter = gli::filter::FILTER_LINEAR;
-		switch(inputTex.target()) {
-		case gli::target::TARGET_2D:
-			inputTex = gli::generate_mipmaps(gli::texture2d {inputTex}, filter);
-			break;
-		case gli::target::TARGET_3D:
-			inputTex = gli::generate_mipmaps(gli::texture3d {inputTex}, filter);
-			break;
-		case gli::target::TARGET_CUBE:
-			inputTex = gli::generate_mipmaps(gli::texture_cube {inputTex}, filter);
-			break;
+		for(auto l = decltype(compressInfo.numLayers) {0u}; l < compressInfo.numLayers; ++l) {
+			for(auto m = decltype(numDstMipmaps) {1u}; m < numDstMipmaps; ++m) {
+				auto [w, h] = getExtent(m);
+				auto &surface = getSurface(l, m);
+				surface.storage = std::unique_ptr<uint8_t[]> {new uint8_t[static_cast<size_t>(w) * h * dstPixelSize]};
+				surface.data = surface.storage.get();
+			}
+		}
+		auto filter = (texInfo.mipMapFilter == TextureInfo::MipmapFilter::Kaiser) ? ResampleFilter::Kaiser : ResampleFilter::Box;
+		auto addressMode = to_edge_address_mode(texInfo.wrapMode);
+		auto colorSpace = (srgb && ImageBuffer::GetChannelSize(expectedInputFormat) == 1) ? ColorSpace::SRGB : ColorSpace::Linear;
+		auto normalMap = texInfo.IsNormalMap();
+		// The stored normal length has to reflect the variance of all base level normals covered by a texel,
+		// so in that case every level is generated from the base level instead
+		auto storeNormalLength = normalMap && compressInfo.textureSaveInfo.storeNormalLengthInAlpha && ImageBuffer::GetChannelCount(expectedInputFormat) == 4;
+		auto &alphaCoverageCutoff = compressInfo.textureSaveInfo.alphaCoverageCutoff;
+		auto preserveAlphaCoverage = alphaCoverageCutoff.has_value() && !normalMap && ImageBuffer::GetChannelCount(expectedInputFormat) == 4;
+		// Every level is generated from the previous one, the layers are independent of each other
+		std::atomic<bool> resampleSuccess = true;
+		pragma::image::parallel_for(compressInfo.numLayers, [&](uint32_t l) {
+			float coverage = 0.f;
+			if(preserveAlphaCoverage) {
+				auto [w, h] = getExtent(0);
+				coverage = calculate_alpha_coverage(getSurface(l, 0).data, w, h, expectedInputFormat, *alphaCoverageCutoff);
+			}
+			for(auto m = decltype(numDstMipmaps) {1u}; m < numDstMipmaps; ++m) {
+				auto srcLevel = storeNormalLength ? 0 : (m - 1);
+				auto [srcWidth, srcHeight] = getExtent(srcLevel);
+				auto [dstWidth, dstHeight] = getExtent(m);
+				auto *srcData = getSurface(l, srcLevel).data;
+				auto *dstData = getSurface(l, m).storage.get();
+				auto resampled = normalMap ? resample_normal_map(srcData, srcWidth, srcHeight, dstData, dstWidth, dstHeight, expectedInputFormat, filter, addressMode, storeNormalLength)
+				                           : resample(srcData, srcWidth, srcHeight, dstData, dstWidth, dstHeight, expectedInputFormat, filter, addressMode, colorSpace);
+				if(!resampled) {
+					resampleSuccess = false;
+					return;
+				}
+				if(preserveAlphaCoverage)
+					scale_alpha_to_coverage(dstData, dstWidth, dstHeight, expectedInputFormat, coverage, *alphaCoverageCutoff);
+			}
+		});
+		if(!resampleSuccess) {
+			compressInfo.errorHandler("Failed to generate mipmaps for input format " + std::string {magic_enum::enum_name(expectedInputFormat)} + "!");
+			return {};
 		}
 	}
 
-	uint32_t srcSizePerPixel = gli::block_size(inputTex.format());
-	for(auto l = decltype(compressInfo.numLayers) {0u}; l < compressInfo.numLayers; ++l) {
-		for(auto m = decltype(numDstMipmaps) {0u}; m < numDstMipmaps; ++m) {
-			auto extent = inputTex.extent(m);
-			auto wMipmap = extent.x;
-			auto hMipmap = extent.y;
-
-			rgba_surface src = {};
-			src.width = wMipmap;
-			src.height = hMipmap;
-			src.stride = wMipmap * srcSizePerPixel;
-			src.ptr = static_cast<uint8_t *>(inputTex.data(dstImageInfo.cubemap ? 0 : l, dstImageInfo.cubemap ? l : 0, m));
-
-			// Each block is always 4x4 pixels
-			auto blocksX = (wMipmap + 3) / 4;
-			auto blocksY = (hMipmap + 3) / 4;
-			auto numBlocks = blocksX * blocksY;
+	auto blockSize = static_cast<uint32_t>(gli::block_size(to_gli_format(dstTexFormat, srgb)));
+	auto blockExtent = gli::block_extent(to_gli_format(dstTexFormat, srgb));
+	auto blockWidth = static_cast<uint32_t>(blockExtent.x);
+	auto blockHeight = static_cast<uint32_t>(blockExtent.y);
+	bc6h_enc_settings bc6hSettings;
+	bc7_enc_settings bc7Settings;
+	bc7_enc_settings bc7AlphaSettings;
+	etc_enc_settings etcSettings;
+	astc_enc_settings astcSettings;
+	astc_enc_settings astcAlphaSettings;
+	if(dstTexFormat == TextureFormat::BC6H)
+		get_bc6h_profile(compressInfo.textureSaveInfo.compressionSpeed, bc6hSettings);
+	else if(dstTexFormat == TextureFormat::BC7) {
+		get_bc7_profile(compressInfo.textureSaveInfo.compressionSpeed, false, bc7Settings);
+		get_bc7_profile(compressInfo.textureSaveInfo.compressionSpeed, true, bc7AlphaSettings);
+	}
+	else if(dstTexFormat == TextureFormat::ETC1)
+		GetProfile_etc_slow(&etcSettings); // The only ETC profile
+	else if(isAstc) {
+		get_astc_profile(compressInfo.textureSaveInfo.compressionSpeed, false, blockWidth, blockHeight, astcSettings);
+		get_astc_profile(compressInfo.textureSaveInfo.compressionSpeed, true, blockWidth, blockHeight, astcAlphaSettings);
+	}
 
-			auto *dstData = static_cast<uint8_t *>(outputTex.data(dstImageInfo.cubemap ? 0 : l, dstImageInfo.cubemap ? l : 0, m));
-			switch(dstTexFormat) {
-			case TextureFormat::BC1:
-				CompressBlocksBC1(&src, dstData);
-				break;
-			case TextureFormat::BC3:
-				CompressBlocksBC3(&src, dstData);
-				break;
-			case TextureFormat::BC4:
-				CompressBlocksBC4(&src, dstData);
-				break;
-			case TextureFormat::BC5:
-				CompressBlocksBC5(&src, dstData);
-				break;
-			case TextureFormat::BC6H:
-				{
-					bc6h_enc_settings settings;
-					GetProfile_bc6h_slow(&settings);
-					CompressBlocksBC6H(&src, dstData, &settings);
-					break;
-				}
-			case TextureFormat::BC7:
-				{
-					bc7_enc_settings settings;
-					GetProfile_slow(&settings);
-					CompressBlocksBC7(&src, dstData, &settings);
-					break;
-				}
+	// The ISPC kernels are vectorized, but single-threaded. Every surface is split into stripes of whole block rows,
+	// which are compressed concurrently.
+	struct Stripe {
+		const Surface *surface;
+		uint32_t width;
+		uint32_t yStart;
+		uint32_t numRows;
+		uint8_t *dst;
+	};
+	constexpr uint32_t minBlockRowsPerStripe = 4;
+	auto numThreads = ThreadPool::Get().GetThreadCount();
+	// BC and ETC blocks are always 4x4 pixels, ASTC blocks are up to 8x8 pixels
+	auto getSurfaceSize = [&getExtent, blockSize, blockWidth, blockHeight](uint32_t m) -> size_t {
+		auto [w, h] = getExtent(m);
+		return static_cast<size_t>((w + blockWidth - 1) / blockWidth) * ((h + blockHeight - 1) / blockHeight) * blockSize;
+	};
+	auto addStripes = [&](uint32_t l, uint32_t m, uint8_t *dstData, std::vector<Stripe> &stripes) {
+		auto [wMipmap, hMipmap] = getExtent(m);
+		auto blocksX = (wMipmap + blockWidth - 1) / blockWidth;
+		auto blocksY = (hMipmap + blockHeight - 1) / blockHeight;
+		auto blockRowsPerStripe = std::max((blocksY + numThreads * 4 - 1) / (numThreads * 4), minBlockRowsPerStripe);
+		for(uint32_t by = 0; by < blocksY; by += blockRowsPerStripe) {
+			Stripe stripe {};
+			stripe.surface = &getSurface(l, m);
+			stripe.width = wMipmap;
+			stripe.yStart = by * blockHeight;
+			stripe.numRows = std::min(blockRowsPerStripe * blockHeight, hMipmap - by * blockHeight);
+			stripe.dst = dstData + static_cast<size_t>(by) * blocksX * blockSize;
+			stripes.push_back(stripe);
+		}
+	};
+	auto hasAlpha = [&texInfo](const rgba_surface &src) {
+		switch(texInfo.alphaMode) {
+		case TextureInfo::AlphaMode::Transparency:
+			return true;
+		case TextureInfo::AlphaMode::Auto:
+			return has_transparency(src.ptr, static_cast<size_t>(src.width) * src.height);
+		default:
+			return false;
+		}
+	};
+	auto compressStripe = [&](const Stripe &stripe) {
+		rgba_surface src {};
+		src.width = stripe.width;
+		src.height = stripe.numRows;
+		src.stride = stripe.width * dstPixelSize;
+		if(stripe.surface->convert) {
+			// Reused by all stripes processed on this thread
+			thread_local std::vector<uint8_t> convertedRows;
+			convertedRows.resize(static_cast<size_t>(src.stride) * stripe.numRows);
+			convertRows(stripe.surface->data + static_cast<size_t>(stripe.yStart) * stripe.width * srcPixelSize, stripe.width, stripe.numRows, convertedRows.data());
+			src.ptr = convertedRows.data();
+		}
+		else
+			src.ptr = const_cast<uint8_t *>(stripe.surface->data) + static_cast<size_t>(stripe.yStart) * src.stride;
+		auto isNative = (dstTexFormat == TextureFormat::ETC2_R || dstTexFormat == TextureFormat::ETC2_RG || dstTexFormat == TextureFormat::ETC2_RGB || dstTexFormat == TextureFormat::ETC2_RGBA);
+		if(!isNative && ((src.width % blockWidth) != 0 || (src.height % blockHeight) != 0)) {
+			// The ISPC kernels only encode whole blocks, so partial blocks at the right and bottom edges are padded by repeating
+			// the last column and row
+			thread_local std::vector<uint8_t> paddedRows;
+			auto paddedWidth = (src.width + blockWidth - 1) / blockWidth * blockWidth;
+			auto paddedHeight = (src.height + blockHeight - 1) / blockHeight * blockHeight;
+			auto paddedStride = static_cast<uint32_t>(paddedWidth * dstPixelSize);
+			paddedRows.resize(static_cast<size_t>(paddedStride) * paddedHeight);
+			for(uint32_t y = 0; y < paddedHeight; ++y) {
+				auto *srcRow = src.ptr + static_cast<size_t>(std::min(y, static_cast<uint32_t>(src.height) - 1)) * src.stride;
+				auto *dstRow = paddedRows.data() + static_cast<size_t>(y) * paddedStride;
+				std::memcpy(dstRow, srcRow, static_cast<size_t>(src.width) * dstPixelSize);
+				for(auto x = static_cast<uint32_t>(src.width); x < paddedWidth; ++x)
+					std::memcpy(dstRow + static_cast<size_t>(x) * dstPixelSize, srcRow + static_cast<size_t>(src.width - 1) * dstPixelSize, dstPixelSize);
 			}
+			src.ptr = paddedRows.data();
+			src.width = paddedWidth;
+			src.height = paddedHeight;
+			src.stride = paddedStride;
 		}
-	}
+		switch(dstTexFormat) {
+		case TextureFormat::BC1:
+			CompressBlocksBC1(&src, stripe.dst);
+			break;
+		case TextureFormat::BC3:
+			CompressBlocksBC3(&src, stripe.dst);
+			break;
+		case TextureFormat::BC4:
+			CompressBlocksBC4(&src, stripe.dst);
+			break;
+		case TextureFormat::BC5:
+			CompressBlocksBC5(&src, stripe.dst);
+			break;
+		case TextureFormat::BC6H:
+			CompressBlocksBC6H(&src, stripe.dst, &bc6hSettings);
+			break;
+		case TextureFormat::BC7:
+			// The opaque profiles are used for stripes without transparency
+			CompressBlocksBC7(&src, stripe.dst, hasAlpha(src) ? &bc7AlphaSettings : &bc7Settings);
+			break;
+		case TextureFormat::ETC1:
+			CompressBlocksETC1(&src, stripe.dst, &etcSettings);
+			break;
+		// ETC2 and EAC are encoded natively
+		case TextureFormat::ETC2_R:
+			etc2::compress_blocks_r11(src.ptr, src.width, src.height, src.stride, stripe.dst);
+			break;
+		case TextureFormat::ETC2_RG:
+			etc2::compress_blocks_rg11(src.ptr, src.width, src.height, src.stride, stripe.dst);
+			break;
+		case TextureFormat::ETC2_RGB:
+			etc2::compress_blocks_rgb(src.ptr, src.width, src.height, src.stride, stripe.dst);
+			break;
+		case TextureFormat::ETC2_RGBA:
+			etc2::compress_blocks_rgba(src.ptr, src.width, src.height, src.stride, stripe.dst);
+			break;
+		case TextureFormat::ASTC_4x4:
+		case TextureFormat::ASTC_5x4:
+		case TextureFormat::ASTC_5x5:
+		case TextureFormat::ASTC_6x5:
+		case TextureFormat::ASTC_6x6:
+		case TextureFormat::ASTC_8x5:
+		case TextureFormat::ASTC_8x6:
+		case TextureFormat::ASTC_8x8:
+			CompressBlocksASTC(&src, stripe.dst, hasAlpha(src) ? &astcAlphaSettings : &astcSettings);
+			break;
+		}
+	};
 
 	auto &outputHandler = compressInfo.outputHandler;
 	if(outputHandler.index() == 0) {
 		auto &texOutputHandler = std::get<TextureOutputHandler>(outputHandler);
-		auto &tex = dstImageInfo.texture;
-		for(size_t l = 0; l < tex.layers(); ++l) {
-			for(size_t m = 0; m < tex.levels(); ++m) {
-				auto extent = tex.extent(m);
-				texOutputHandler.beginImage(tex.size(m), extent.x, extent.y, l, 0, m);
-				texOutputHandler.writeData(tex.data(dstImageInfo.cubemap ? 0 : l, dstImageInfo.cubemap ? l : 0, m), tex.size(m));
-				texOutputHandler.endImage();
+		// Every surface is handed to the output handler as soon as it has been compressed, while the next surface is already being
+		// compressed. Only two compressed surfaces are held in memory at any time.
+		// Both run as items of a parallel_for instead of waiting on a task of the pool, which would deadlock if this is called from a worker.
+		auto numSurfaces = compressInfo.numLayers * numDstMipmaps;
+		std::array<std::vector<uint8_t>, 2> compressedSurfaces;
+		auto compressSurface = [&](uint32_t i) {
+			auto l = i / numDstMipmaps;
+			auto m = i % numDstMipmaps;
+			auto &dst = compressedSurfaces[i % compressedSurfaces.size()];
+			dst.resize(getSurfaceSize(m));
+			std::vector<Stripe> stripes;
+			addStripes(l, m, dst.data(), stripes);
+			pragma::image::parallel_for(static_cast<uint32_t>(stripes.size()), [&](uint32_t iStripe) { compressStripe(stripes[iStripe]); });
+		};
+		auto writeSurface = [&](uint32_t i) {
+			auto l = i / numDstMipmaps;
+			auto m = i % numDstMipmaps;
+			// The source data isn't needed anymore, mipmaps have already been generated at this point
+			auto &surface = getSurface(l, m);
+			if(surface.deleter) {
+				surface.deleter();
+				surface.deleter = nullptr;
 			}
+			surface.storage = nullptr;
+
+			auto &data = compressedSurfaces[i % compressedSurfaces.size()];
+			auto [w, h] = getExtent(m);
+			texOutputHandler.beginImage(static_cast<int>(data.size()), w, h, 1, l, m);
+			auto success = texOutputHandler.writeData(data.data(), static_cast<int>(data.size()));
+			texOutputHandler.endImage();
+			return success;
+		};
+		compressSurface(0);
+		for(auto i = decltype(numSurfaces) {0u}; i < numSurfaces; ++i) {
+			auto success = true;
+			if(i + 1 < numSurfaces) {
+				pragma::image::parallel_for(2, [&](uint32_t job) {
+					if(job == 0)
+						success = writeSurface(i);
+					else
+						compressSurface(i + 1);
+				});
+			}
+			else
+				success = writeSurface(i);
+			if(!success)
+				return {};
 		}
 		ResultData resultData {};
 		return resultData;
 	}
-	else {
-		auto &fileName = std::get<std::string>(outputHandler);
-		std::string outputFilePath = compressInfo.absoluteFileName ? fileName.c_str() : get_absolute_path(fileName, texInfo.containerFormat).c_str();
 
-		std::string err;
-		auto saveSuccess = false;
-		switch(texInfo.containerFormat) {
-		case TextureInfo::ContainerFormat::DDS:
-			{
-				saveSuccess = save_dds(DdsLibrary::Gli, dstTexFormat, outputFilePath, dstImageInfo, err);
-				break;
-			}
-		case TextureInfo::ContainerFormat::KTX:
-			saveSuccess = save_ktx(dstTexFormat, outputFilePath, dstImageInfo, err);
-			break;
-		default:
-			err = "Unsupported container format: " + std::string {magic_enum::enum_name(texInfo.containerFormat)};
-			saveSuccess = false;
+	TextureImageInfo dstImageInfo {};
+	auto &outputTex = dstImageInfo.texture;
+	dstImageInfo.srgb = srgb;
+	dstImageInfo.cubemap = compressInfo.textureSaveInfo.cubemap;
+	if(compressInfo.numLayers == 1)
+		outputTex = gli::texture2d {to_gli_format(dstTexFormat, srgb), gli::extent2d {compressInfo.width, compressInfo.height}, numDstMipmaps};
+	else if(dstImageInfo.cubemap)
+		outputTex = gli::texture_cube {to_gli_format(dstTexFormat, srgb), gli::extent3d {compressInfo.width, compressInfo.height, 1}, numDstMipmaps};
+	else
+		outputTex = gli::texture2d_array {to_gli_format(dstTexFormat, srgb), gli::extent3d {compressInfo.width, compressInfo.height, 1}, compressInfo.numLayers, numDstMipmaps};
+
+	// The stripes of all layers and mipmaps are compressed at once
+	std::vector<Stripe> stripes;
+	for(auto l = decltype(compressInfo.numLayers) {0u}; l < compressInfo.numLayers; ++l) {
+		for(auto m = decltype(numDstMipmaps) {0u}; m < numDstMipmaps; ++m)
+			addStripes(l, m, static_cast<uint8_t *>(outputTex.data(dstImageInfo.cubemap ? 0 : l, dstImageInfo.cubemap ? l : 0, m)), stripes);
+	}
+	pragma::image::parallel_for(static_cast<uint32_t>(stripes.size()), [&](uint32_t i) { compressStripe(stripes[i]); });
+
+	auto &fileName = std::get<std::string>(outputHandler);
+	std::string outputFilePath = compressInfo.absoluteFileName ? fileName.c_str() : get_absolute_path(fileName, texInfo.containerFormat).c_str();
+
+	std::string err;
+	auto saveSuccess = false;
+	switch(texInfo.containerFormat) {
+	case TextureInfo::ContainerFormat::DDS:
+		{
+			saveSuccess = save_dds(DdsLibrary::Gli, dstTexFormat, outputFilePath, dstImageInfo, err);
 			break;
 		}
+	case TextureInfo::ContainerFormat::KTX:
+		saveSuccess = save_ktx(dstTexFormat, outputFilePath, dstImageInfo, err);
+		break;
+	case TextureInfo::ContainerFormat::KTX2:
+		saveSuccess = save_ktx2(dstTexFormat, outputFilePath, dstImageInfo, compressInfo.textureSaveInfo.compressionSpeed, err);
+		break;
+	default:
+		err = "Unsupported container format: " + std::string {magic_enum::enum_name(texInfo.containerFormat)};
+		saveSuccess = false;
+		break;
+	}
 
-		if(!saveSuccess)
-			return {};
+	if(!saveSuccess)
+		return {};
 
-		ResultData resultData {};
-		resultData.outputFilePath = outputFilePath;
-		return resultData;
-	}
-	return {};
+	ResultData resultData {};
+	resultData.outputFilePath = outputFilePath;
+	return resultData;
 }
 std::unique_ptr<pragma::image::ITextureCompressor> pragma::image::IspctcTextureCompressor::Create() { return std::make_unique<IspctcTextureCompressor>(); }
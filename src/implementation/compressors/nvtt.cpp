@@ -119,7 +119,7 @@ static nvtt::Format to_nvtt_enum(pragma::image::TextureInfo::OutputFormat format
 	default:
 		break;
 	}
-	static_assert(pragma::math::to_integral(pragma::image::TextureInfo::OutputFormat::Count) == 20);
+	static_assert(pragma::math::to_integral(pragma::image::TextureInfo::OutputFormat::Count) == 28);
 	return {};
 }
 
@@ -137,7 +137,7 @@ static nvtt::Container to_nvtt_enum(pragma::image::TextureInfo::ContainerFormat
 	default:
 		break;
 	}
-	static_assert(pragma::math::to_integral(pragma::image::TextureInfo::ContainerFormat::Count) == 2);
+	static_assert(pragma::math::to_integral(pragma::image::TextureInfo::ContainerFormat::Count) == 3);
 	return {};
 }
 
@@ -149,7 +149,7 @@ static nvtt::MipmapFilter to_nvtt_enum(pragma::image::TextureInfo::MipmapFilter
 	case pragma::image::TextureInfo::MipmapFilter::Kaiser:
 		return nvtt::MipmapFilter_Kaiser;
 	}
-	static_assert(pragma::math::to_integral(pragma::image::TextureInfo::ContainerFormat::Count) == 2);
+	static_assert(pragma::math::to_integral(pragma::image::TextureInfo::ContainerFormat::Count) == 3);
 	return {};
 }
 
@@ -165,7 +165,7 @@ static nvtt::WrapMode to_nvtt_enum(pragma::image::TextureInfo::WrapMode wrapMode
 	default:
 		break;
 	}
-	static_assert(pragma::math::to_integral(pragma::image::TextureInfo::ContainerFormat::Count) == 2);
+	static_assert(pragma::math::to_integral(pragma::image::TextureInfo::ContainerFormat::Count) == 3);
 	return {};
 }
 
@@ -197,6 +197,10 @@ std::optional<pragma::image::ITextureCompressor::ResultData> pragma::image::Nvtt
 {
 	auto &textureSaveInfo = compressInfo.textureSaveInfo;
 	auto &texInfo = compressInfo.textureSaveInfo.texInfo;
+	if(compressInfo.outputHandler.index() == 1 && texInfo.containerFormat == pragma::image::TextureInfo::ContainerFormat::KTX2) {
+		compressInfo.errorHandler("KTX2 container format is not supported by nvtt");
+		return {};
+	}
 	auto nvttFormat = get_nvtt_format(texInfo.inputFormat);
 	nvtt::InputOptions inputOptions {};
 	inputOptions.reset();
@@ -255,7 +259,7 @@ std::optional<pragma::image::ITextureCompressor::ResultData> pragma::image::Nvtt
 	}
 	inputOptions.setAlphaMode((alphaMode == pragma::image::TextureInfo::AlphaMode::Transparency) ? nvtt::AlphaMode::AlphaMode_Transparency : nvtt::AlphaMode::AlphaMode_None);
 
-	static_assert(pragma::math::to_integral(pragma::image::TextureInfo::ContainerFormat::Count) == 2);
+	static_assert(pragma::math::to_integral(pragma::image::TextureInfo::ContainerFormat::Count) == 3);
 	/*auto f = FileManager::OpenFile<fs::VFilePtrReal>(fileNameWithExt,fs::FileMode::Write | fs::FileMode::Binary);
 if(f == nullptr)
 {
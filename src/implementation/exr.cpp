@@ -0,0 +1,267 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module;
+
+#include <zlib.h>
+
+module pragma.image;
+
+import :core;
+import :thread_pool;
+
+// See https://openexr.com/en/latest/OpenEXRFileLayout.html
+namespace exr {
+	enum class PixelType : int32_t { UInt = 0, Half, Float };
+	enum class Compression : uint8_t { None = 0, Rle, Zips, Zip };
+	static constexpr std::array<uint8_t, 4> MAGIC = {0x76, 0x2f, 0x31, 0x01};
+	static constexpr uint32_t VERSION = 2; // Single-part scanline file
+
+	static uint32_t get_scanlines_per_chunk(Compression compression) { return (compression == Compression::Zip) ? 16 : 1; }
+
+	class HeaderWriter {
+	  public:
+		template<typename T>
+		void Write(const T &value)
+		{
+			auto offset = m_data.size();
+			m_data.resize(offset + sizeof(T));
+			memcpy(m_data.data() + offset, &value, sizeof(T));
+		}
+		void WriteString(const std::string &str)
+		{
+			m_data.insert(m_data.end(), str.begin(), str.end());
+			m_data.push_back('\0');
+		}
+		void BeginAttribute(const std::string &name, const std::string &type, int32_t size)
+		{
+			WriteString(name);
+			WriteString(type);
+			Write(size);
+		}
+		std::vector<uint8_t> &GetData() { return m_data; }
+	  private:
+		std::vector<uint8_t> m_data;
+	};
+
+	// Splits the bytes into two halves and delta-encodes them, which is the
+	// preprocessing step shared by the RLE and ZIP compression schemes.
+	static void apply_predictor(const uint8_t *src, size_t size, std::vector<uint8_t> &dst)
+	{
+		dst.resize(size);
+		auto *t1 = dst.data();
+		auto *t2 = dst.data() + (size + 1) / 2;
+		auto *end = src + size;
+		while(src < end) {
+			*(t1++) = *(src++);
+			if(src < end)
+				*(t2++) = *(src++);
+		}
+		if(size == 0)
+			return;
+		auto p = static_cast<int32_t>(dst[0]);
+		for(size_t i = 1; i < size; ++i) {
+			auto d = static_cast<int32_t>(dst[i]) - p + (128 + 256);
+			p = dst[i];
+			dst[i] = static_cast<uint8_t>(d);
+		}
+	}
+
+	static void compress_rle(const uint8_t *src, size_t size, std::vector<uint8_t> &dst)
+	{
+		constexpr int32_t MIN_RUN_LENGTH = 3;
+		constexpr int32_t MAX_RUN_LENGTH = 127;
+		dst.clear();
+		dst.reserve(size + size / 128 + 1);
+		auto *end = src + size;
+		auto *runStart = src;
+		auto *runEnd = src + 1;
+		while(runStart < end) {
+			while(runEnd < end && *runStart == *runEnd && runEnd - runStart - 1 < MAX_RUN_LENGTH)
+				++runEnd;
+			if(runEnd - runStart >= MIN_RUN_LENGTH) {
+				// Compressible run
+				dst.push_back(static_cast<uint8_t>((runEnd - runStart) - 1));
+				dst.push_back(*runStart);
+				runStart = runEnd;
+			}
+			else {
+				// Uncompressible run
+				while(runEnd < end && ((runEnd + 1 >= end || *runEnd != *(runEnd + 1)) || (runEnd + 2 >= end || *(runEnd + 1) != *(runEnd + 2))) && runEnd - runStart < MAX_RUN_LENGTH)
+					++runEnd;
+				dst.push_back(static_cast<uint8_t>(static_cast<int8_t>(runStart - runEnd)));
+				dst.insert(dst.end(), runStart, runEnd);
+				runStart = runEnd;
+			}
+			++runEnd;
+		}
+	}
+
+	static bool compress_zip(const uint8_t *src, size_t size, std::vector<uint8_t> &dst)
+	{
+		auto dstSize = compressBound(static_cast<uLong>(size));
+		dst.resize(dstSize);
+		if(compress2(dst.data(), &dstSize, src, static_cast<uLong>(size), Z_DEFAULT_COMPRESSION) != Z_OK)
+			return false;
+		dst.resize(dstSize);
+		return true;
+	}
+};
+
+bool pragma::image::save_exr(ufile::IFile &f, const ImageBuffer &imgBuffer, ExrCompression compression, bool flipVertically)
+{
+	auto w = imgBuffer.GetWidth();
+	auto h = imgBuffer.GetHeight();
+	if(w == 0 || h == 0)
+		return false;
+	exr::Compression exrCompression;
+	switch(compression) {
+	case ExrCompression::None:
+		exrCompression = exr::Compression::None;
+		break;
+	case ExrCompression::Rle:
+		exrCompression = exr::Compression::Rle;
+		break;
+	case ExrCompression::Zip:
+		exrCompression = exr::Compression::Zip;
+		break;
+	default:
+		return false;
+	}
+
+	// LDR data is stored as half, everything else is written as-is
+	auto pixelType = imgBuffer.IsFloatFormat() ? exr::PixelType::Float : exr::PixelType::Half;
+	auto srcChannelSize = imgBuffer.GetChannelSize();
+	auto dstChannelSize = (pixelType == exr::PixelType::Float) ? sizeof(float) : sizeof(uint16_t);
+	auto numChannels = imgBuffer.GetChannelCount();
+
+	// Channels have to be stored in alphabetical order
+	constexpr std::array<const char *, 4> channelNames = {"R", "G", "B", "A"};
+	std::vector<uint8_t> channelOrder;
+	for(auto c : {Channel::Alpha, Channel::Blue, Channel::Green, Channel::Red}) {
+		if(pragma::math::to_integral(c) < numChannels)
+			channelOrder.push_back(pragma::math::to_integral(c));
+	}
+
+	std::array<uint16_t, std::numeric_limits<uint8_t>::max() + 1> ldrToHalf;
+	if(imgBuffer.IsLDRFormat()) {
+		for(size_t i = 0; i < ldrToHalf.size(); ++i)
+			ldrToHalf[i] = ImageBuffer::ToHDRValue(static_cast<ImageBuffer::LDRValue>(i));
+	}
+
+	exr::HeaderWriter header {};
+	header.GetData().insert(header.GetData().end(), exr::MAGIC.begin(), exr::MAGIC.end());
+	header.Write(exr::VERSION);
+
+	header.BeginAttribute("channels", "chlist", static_cast<int32_t>(channelOrder.size() * (2 + 16) + 1));
+	for(auto c : channelOrder) {
+		header.WriteString(channelNames[c]);
+		header.Write(static_cast<int32_t>(pixelType));
+		header.Write(static_cast<uint8_t>(0)); // pLinear
+		for(uint8_t i = 0; i < 3; ++i)
+			header.Write(static_cast<uint8_t>(0)); // Reserved
+		header.Write(static_cast<int32_t>(1));     // xSampling
+		header.Write(static_cast<int32_t>(1));     // ySampling
+	}
+	header.Write(static_cast<uint8_t>(0));
+
+	header.BeginAttribute("compression", "compression", 1);
+	header.Write(static_cast<uint8_t>(exrCompression));
+
+	std::array<int32_t, 4> window = {0, 0, static_cast<int32_t>(w) - 1, static_cast<int32_t>(h) - 1};
+	header.BeginAttribute("dataWindow", "box2i", sizeof(window));
+	header.Write(window);
+	header.BeginAttribute("displayWindow", "box2i", sizeof(window));
+	header.Write(window);
+
+	header.BeginAttribute("lineOrder", "lineOrder", 1);
+	header.Write(static_cast<uint8_t>(0)); // INCREASING_Y
+
+	header.BeginAttribute("pixelAspectRatio", "float", sizeof(float));
+	header.Write(1.f);
+
+	header.BeginAttribute("screenWindowCenter", "v2f", sizeof(float) * 2);
+	header.Write(0.f);
+	header.Write(0.f);
+
+	header.BeginAttribute("screenWindowWidth", "float", sizeof(float));
+	header.Write(1.f);
+
+	header.Write(static_cast<uint8_t>(0)); // End of header
+
+	auto linesPerChunk = exr::get_scanlines_per_chunk(exrCompression);
+	auto numChunks = (h + linesPerChunk - 1) / linesPerChunk;
+	auto dstRowSize = static_cast<size_t>(w) * numChannels * dstChannelSize;
+	auto srcPixelSize = imgBuffer.GetPixelSize();
+	auto *srcData = static_cast<const uint8_t *>(imgBuffer.GetData());
+
+	// Chunks are independent of each other, so we can pack and compress them in parallel
+	std::vector<std::vector<uint8_t>> chunks;
+	chunks.resize(numChunks);
+	std::atomic<bool> success = true;
+	parallel_for(numChunks, [&](uint32_t chunkIdx) {
+		auto yStart = chunkIdx * linesPerChunk;
+		auto numLines = std::min(linesPerChunk, h - yStart);
+		std::vector<uint8_t> rawData;
+		rawData.resize(numLines * dstRowSize);
+		auto *dst = rawData.data();
+		for(auto y = yStart; y < yStart + numLines; ++y) {
+			auto srcY = flipVertically ? (h - 1 - y) : y;
+			auto *srcRow = srcData + static_cast<size_t>(srcY) * w * srcPixelSize;
+			for(auto c : channelOrder) {
+				auto *src = srcRow + c * srcChannelSize;
+				if(imgBuffer.IsLDRFormat()) {
+					auto *dstValues = reinterpret_cast<uint16_t *>(dst);
+					for(auto x = decltype(w) {0u}; x < w; ++x)
+						dstValues[x] = ldrToHalf[src[x * srcPixelSize]];
+				}
+				else {
+					for(auto x = decltype(w) {0u}; x < w; ++x)
+						memcpy(dst + x * dstChannelSize, src + x * srcPixelSize, dstChannelSize);
+				}
+				dst += w * dstChannelSize;
+			}
+		}
+
+		auto &chunk = chunks[chunkIdx];
+		auto writeChunk = [&chunk, yStart](const std::vector<uint8_t> &data) {
+			chunk.resize(sizeof(int32_t) * 2 + data.size());
+			auto y = static_cast<int32_t>(yStart);
+			auto size = static_cast<int32_t>(data.size());
+			memcpy(chunk.data(), &y, sizeof(y));
+			memcpy(chunk.data() + sizeof(y), &size, sizeof(size));
+			memcpy(chunk.data() + sizeof(y) + sizeof(size), data.data(), data.size());
+		};
+		if(exrCompression == exr::Compression::None) {
+			writeChunk(rawData);
+			return;
+		}
+		std::vector<uint8_t> predicted;
+		exr::apply_predictor(rawData.data(), rawData.size(), predicted);
+		std::vector<uint8_t> compressed;
+		if(exrCompression == exr::Compression::Rle)
+			exr::compress_rle(predicted.data(), predicted.size(), compressed);
+		else if(!exr::compress_zip(predicted.data(), predicted.size(), compressed)) {
+			success = false;
+			return;
+		}
+		// If compression didn't help, the chunk has to be stored uncompressed
+		writeChunk((compressed.size() < rawData.size()) ? compressed : rawData);
+	});
+	if(!success)
+		return false;
+
+	auto &headerData = header.GetData();
+	uint64_t offset = headerData.size() + numChunks * sizeof(uint64_t);
+	for(auto &chunk : chunks) {
+		header.Write(offset);
+		offset += chunk.size();
+	}
+	if(f.Write(headerData.data(), headerData.size()) != headerData.size())
+		return false;
+	for(auto &chunk : chunks) {
+		if(f.Write(chunk.data(), chunk.size()) != chunk.size())
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,192 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module;
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+module pragma.image;
+
+import :file_writer;
+
+std::unique_ptr<pragma::image::BufferedFileWriter> pragma::image::BufferedFileWriter::OpenDirect(const std::string &path, size_t bufferSize)
+{
+#ifdef __linux__
+	auto fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+	if(fd == -1)
+		return nullptr;
+	return std::unique_ptr<BufferedFileWriter> {new BufferedFileWriter {fd, bufferSize}};
+#else
+	return nullptr;
+#endif
+}
+
+pragma::image::BufferedFileWriter::BufferedFileWriter(ufile::IFile &f, size_t bufferSize) : m_file {&f}
+{
+	InitBuffer(bufferSize);
+	m_offset = f.Tell();
+}
+
+pragma::image::BufferedFileWriter::BufferedFileWriter(int fd, size_t bufferSize) : m_fd {fd} { InitBuffer(bufferSize); }
+
+pragma::image::BufferedFileWriter::~BufferedFileWriter() { Close(); }
+
+void pragma::image::BufferedFileWriter::InitBuffer(size_t bufferSize)
+{
+	m_bufferSize = std::max(bufferSize, static_cast<size_t>(1));
+	if(m_file) {
+		// The buffer is always written before it is read, so it doesn't need to be initialized
+		m_storage = std::make_unique_for_overwrite<uint8_t[]>(m_bufferSize);
+		m_buffer = m_storage.get();
+		return;
+	}
+	// O_DIRECT requires the buffer address, the write size and the file offset to be aligned
+	m_bufferSize = (m_bufferSize + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+	auto storageSize = m_bufferSize + BLOCK_ALIGNMENT;
+	m_storage = std::make_unique_for_overwrite<uint8_t[]>(storageSize);
+	void *ptr = m_storage.get();
+	m_buffer = static_cast<uint8_t *>(std::align(BLOCK_ALIGNMENT, m_bufferSize, ptr, storageSize));
+}
+
+bool pragma::image::BufferedFileWriter::HasFailed() const { return m_failed; }
+
+bool pragma::image::BufferedFileWriter::WriteBlock(const uint8_t *data, size_t size)
+{
+	if(m_file)
+		return m_file->Write(data, size) == size;
+#ifdef __linux__
+	auto offset = m_offset;
+	while(size > 0) {
+		auto n = pwrite(m_fd, data, size, static_cast<off_t>(offset));
+		if(n < 0) {
+			if(errno == EINTR)
+				continue;
+			return false;
+		}
+		data += n;
+		offset += n;
+		size -= n;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+size_t pragma::image::BufferedFileWriter::Write(const void *data, size_t size)
+{
+	if(m_failed || m_closed)
+		return 0;
+	auto *src = static_cast<const uint8_t *>(data);
+	auto remaining = size;
+	while(remaining > 0) {
+		if(m_file && m_numBuffered == 0 && remaining >= m_bufferSize) {
+			// Large writes don't need to go through the buffer
+			if(!WriteBlock(src, remaining)) {
+				m_failed = true;
+				return size - remaining;
+			}
+			m_offset += remaining;
+			m_size = std::max(m_size, m_offset);
+			return size;
+		}
+		auto n = std::min(remaining, m_bufferSize - m_numBuffered);
+		memcpy(m_buffer + m_numBuffered, src, n);
+		m_numBuffered += n;
+		src += n;
+		remaining -= n;
+		m_size = std::max(m_size, m_offset + m_numBuffered);
+		if(m_numBuffered == m_bufferSize) {
+			if(!WriteBlock(m_buffer, m_bufferSize)) {
+				m_failed = true;
+				return size - remaining;
+			}
+			m_offset += m_bufferSize;
+			m_numBuffered = 0;
+		}
+	}
+	return size;
+}
+
+bool pragma::image::BufferedFileWriter::Flush()
+{
+	if(m_failed || m_closed || m_numBuffered == 0)
+		return !m_failed;
+	if(m_file) {
+		if(!WriteBlock(m_buffer, m_numBuffered))
+			m_failed = true;
+		else {
+			m_offset += m_numBuffered;
+			m_numBuffered = 0;
+		}
+		return !m_failed;
+	}
+	// Direct writes have to cover whole blocks, so the partial block is padded and written, but kept in the buffer
+	// in case more data follows. The padding is truncated when the file is closed.
+	auto paddedSize = (m_numBuffered + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+	std::fill(m_buffer + m_numBuffered, m_buffer + paddedSize, 0);
+	if(!WriteBlock(m_buffer, paddedSize))
+		m_failed = true;
+	return !m_failed;
+}
+
+bool pragma::image::BufferedFileWriter::Close()
+{
+	if(m_closed)
+		return !m_failed;
+	Flush();
+	m_closed = true;
+#ifdef __linux__
+	if(m_fd != -1) {
+		if(ftruncate(m_fd, static_cast<off_t>(m_size)) != 0)
+			m_failed = true;
+		if(close(m_fd) != 0)
+			m_failed = true;
+		m_fd = -1;
+	}
+#endif
+	return !m_failed;
+}
+
+size_t pragma::image::BufferedFileWriter::Read(void *, size_t) { return 0; }
+int32_t pragma::image::BufferedFileWriter::ReadChar() { return -1; }
+
+size_t pragma::image::BufferedFileWriter::Tell() { return m_offset + m_numBuffered; }
+
+void pragma::image::BufferedFileWriter::Seek(size_t offset, Whence whence)
+{
+	if(m_closed)
+		return;
+	if(!m_file) {
+		size_t target;
+		switch(whence) {
+		case Whence::Set:
+			target = offset;
+			break;
+		case Whence::Cur:
+			target = Tell() + offset;
+			break;
+		default:
+			target = m_size + offset;
+			break;
+		}
+		if(target != Tell())
+			m_failed = true;
+		return;
+	}
+	if(!Flush())
+		return;
+	m_file->Seek(offset, whence);
+	m_offset = m_file->Tell();
+}
+
+size_t pragma::image::BufferedFileWriter::GetSize()
+{
+	if(m_file)
+		return std::max(m_file->GetSize(), m_offset + m_numBuffered);
+	return m_size;
+}
@@ -12,6 +12,7 @@ module;
 module pragma.image;
 
 import :core;
+import :file_writer;
 import pragma.filesystem;
 
 void pragma::image::ChannelMask::Reverse() { *this = GetReverse(); }
@@ -67,6 +68,8 @@ std::optional<pragma::image::ImageFormat> pragma::image::string_to_image_output_
 		return ImageFormat::JPG;
 	else if(pragma::string::compare<std::string>(str, "HDR", false))
 		return ImageFormat::HDR;
+	else if(pragma::string::compare<std::string>(str, "EXR", false))
+		return ImageFormat::EXR;
 	return {};
 }
 
@@ -83,6 +86,8 @@ std::string pragma::image::get_image_output_format_extension(ImageFormat format)
 		return "jpg";
 	case ImageFormat::HDR:
 		return "hdr";
+	case ImageFormat::EXR:
+		return "exr";
 	default:
 		break;
 	}
@@ -119,10 +124,12 @@ std::string pragma::image::get_file_extension(ImageFormat format)
 		return "jpg";
 	case ImageFormat::HDR:
 		return "hdr";
+	case ImageFormat::EXR:
+		return "exr";
 	default:
 		break;
 	}
-	static_assert(pragma::math::to_integral(ImageFormat::Count) == 5);
+	static_assert(pragma::math::to_integral(ImageFormat::Count) == 6);
 	return "";
 }
 
@@ -171,10 +178,54 @@ std::shared_ptr<pragma::image::ImageBuffer> pragma::image::load_image(ufile::IFi
 	return imgBuffer;
 }
 
-bool pragma::image::save_image(ufile::IFile &f, ImageBuffer &imgBuffer, ImageFormat format, float quality, bool flipVertically)
+bool pragma::image::save_image(const std::string &fileName, ImageBuffer &imgBuffer, ImageFormat format, float quality, bool flipVertically, Value16Encoding value16Encoding)
 {
+	auto fp = fs::open_file<fs::VFilePtrReal>(fileName.c_str(), fs::FileMode::Write | fs::FileMode::Binary);
+	if(fp == nullptr)
+		return false;
+	fs::File f {fp};
+	return save_image(f, imgBuffer, format, quality, flipVertically, value16Encoding);
+}
+
+bool pragma::image::save_image(ufile::IFile &f, ImageBuffer &imgBuffer, ImageFormat format, float quality, bool flipVertically, Value16Encoding value16Encoding)
+{
+	if(!dynamic_cast<BufferedFileWriter *>(&f)) {
+		// The encoders issue many small writes, which are coalesced into large blocks. The encoded image is rarely
+		// larger than the raw data, so small images don't need the full default buffer.
+		BufferedFileWriter writer {f, std::min(imgBuffer.GetSize() + BufferedFileWriter::BLOCK_ALIGNMENT, BufferedFileWriter::DEFAULT_BUFFER_SIZE)};
+		auto result = save_image(writer, imgBuffer, format, quality, flipVertically, value16Encoding);
+		return writer.Close() && result;
+	}
 	auto *fptr = &f;
 
+	if(format == ImageFormat::EXR) {
+		// EXR supports half and float channels natively, so no conversion is required
+		ExrCompression compression;
+		if(quality >= 0.9f)
+			compression = ExrCompression::None;
+		else if(quality >= 0.5f)
+			compression = ExrCompression::Rle;
+		else
+			compression = ExrCompression::Zip;
+		return save_exr(f, imgBuffer, compression, flipVertically);
+	}
+
+	if(format == ImageFormat::PNG && imgBuffer.IsHDRFormat()) {
+		// 16-bit buffers are written as 16-bit PNGs to preserve precision (e.g. for height maps)
+		int32_t compressionLevel;
+		if(quality >= 0.9f)
+			compressionLevel = 1;
+		else if(quality >= 0.75f)
+			compressionLevel = 6;
+		else if(quality >= 0.5f)
+			compressionLevel = 7;
+		else if(quality >= 0.25f)
+			compressionLevel = 8;
+		else
+			compressionLevel = 9;
+		return save_png16(f, imgBuffer, value16Encoding, compressionLevel, flipVertically);
+	}
+
 	auto imgFormat = imgBuffer.GetFormat();
 	// imgFormat = ::pragma::image::ImageBuffer::ToRGBFormat(imgFormat);
 	if(format != ImageFormat::HDR)
@@ -186,6 +237,12 @@ bool pragma::image::save_image(ufile::IFile &f, ImageBuffer &imgBuffer, ImageFor
 	auto h = imgBuffer.GetHeight();
 	auto *data = imgBuffer.GetData();
 	auto numChannels = imgBuffer.GetChannelCount();
+	if(format == ImageFormat::JPG)
+		return save_jpeg(f, imgBuffer, quality, flipVertically);
+	// The flip flag and the PNG compression level are global stb_image_write state, so concurrent encodes (e.g. by the workers of an ImageWriter)
+	// have to be serialized
+	static std::mutex stbWriteMutex;
+	std::scoped_lock lock {stbWriteMutex};
 	int result = 0;
 	stbi_flip_vertically_on_write(flipVertically);
 	switch(format) {
@@ -208,9 +265,6 @@ bool pragma::image::save_image(ufile::IFile &f, ImageBuffer &imgBuffer, ImageFor
 	case ImageFormat::TGA:
 		result = stbi_write_tga_to_func([](void *context, void *data, int size) { static_cast<ufile::IFile *>(context)->Write(data, size); }, fptr, w, h, numChannels, data);
 		break;
-	case ImageFormat::JPG:
-		result = stbi_write_jpg_to_func([](void *context, void *data, int size) { static_cast<ufile::IFile *>(context)->Write(data, size); }, fptr, w, h, numChannels, data, static_cast<int32_t>(quality * 100.f));
-		break;
 	case ImageFormat::HDR:
 		result = stbi_write_hdr_to_func([](void *context, void *data, int size) { static_cast<ufile::IFile *>(context)->Write(data, size); }, fptr, w, h, numChannels, reinterpret_cast<float *>(data));
 		break;
@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module pragma.image;
+
+import :file_writer;
+import :image_writer;
+
+pragma::image::ImageWriter::ImageWriter() : ImageWriter {Config {}} {}
+pragma::image::ImageWriter::ImageWriter(const Config &config) : m_config {config}
+{
+	m_config.numThreads = std::max(m_config.numThreads, 1u);
+	m_config.maxQueueDepth = std::max(m_config.maxQueueDepth, 1u);
+	m_threads.reserve(m_config.numThreads);
+	for(auto i = decltype(m_config.numThreads) {0u}; i < m_config.numThreads; ++i)
+		m_threads.push_back(std::thread {[this]() { RunWorker(); }});
+}
+
+pragma::image::ImageWriter::~ImageWriter()
+{
+	{
+		std::scoped_lock lock {m_mutex};
+		m_running = false;
+	}
+	m_jobAvailable.notify_all();
+	for(auto &t : m_threads)
+		t.join();
+}
+
+const pragma::image::ImageWriter::Config &pragma::image::ImageWriter::GetConfig() const { return m_config; }
+
+uint32_t pragma::image::ImageWriter::GetPendingJobCount() const
+{
+	std::scoped_lock lock {m_mutex};
+	return m_numPendingJobs;
+}
+
+size_t pragma::image::ImageWriter::GetPendingMemory() const
+{
+	std::scoped_lock lock {m_mutex};
+	return m_pendingMemory;
+}
+
+bool pragma::image::ImageWriter::CanAccept(size_t size) const
+{
+	if(m_numPendingJobs == 0)
+		return true;
+	return m_numPendingJobs < m_config.maxQueueDepth && m_pendingMemory + size <= m_config.maxQueuedMemory;
+}
+
+void pragma::image::ImageWriter::PushJob(Job &&job, size_t size)
+{
+	++m_numPendingJobs;
+	m_pendingMemory += size;
+	m_jobs.push(std::move(job));
+}
+
+bool pragma::image::ImageWriter::Enqueue(Job job)
+{
+	if(!job.imageBuffer)
+		return false;
+	auto size = job.imageBuffer->GetSize();
+	{
+		std::unique_lock lock {m_mutex};
+		m_jobCompleted.wait(lock, [this, size]() { return CanAccept(size); });
+		PushJob(std::move(job), size);
+	}
+	m_jobAvailable.notify_one();
+	return true;
+}
+
+bool pragma::image::ImageWriter::TryEnqueue(Job &job)
+{
+	if(!job.imageBuffer)
+		return false;
+	auto size = job.imageBuffer->GetSize();
+	{
+		std::scoped_lock lock {m_mutex};
+		if(!CanAccept(size))
+			return false;
+		PushJob(std::move(job), size);
+	}
+	m_jobAvailable.notify_one();
+	return true;
+}
+
+void pragma::image::ImageWriter::Flush()
+{
+	std::unique_lock lock {m_mutex};
+	m_jobCompleted.wait(lock, [this]() { return m_numPendingJobs == 0; });
+}
+
+void pragma::image::ImageWriter::RunWorker()
+{
+	for(;;) {
+		Job job;
+		{
+			std::unique_lock lock {m_mutex};
+			m_jobAvailable.wait(lock, [this]() { return !m_running || !m_jobs.empty(); });
+			if(m_jobs.empty())
+				return; // Writer is shutting down and all jobs have been processed
+			job = std::move(m_jobs.front());
+			m_jobs.pop();
+		}
+		auto size = job.imageBuffer->GetSize();
+		auto success = false;
+		auto directFile = m_config.directIo ? BufferedFileWriter::OpenDirect(job.fileName) : nullptr;
+		if(directFile) {
+			success = save_image(*directFile, *job.imageBuffer, job.format, job.quality, job.flipVertically, job.value16Encoding);
+			success = directFile->Close() && success;
+		}
+		else
+			success = save_image(job.fileName, *job.imageBuffer, job.format, job.quality, job.flipVertically, job.value16Encoding);
+		if(job.onComplete)
+			job.onComplete(success);
+		job.imageBuffer = nullptr;
+		{
+			std::scoped_lock lock {m_mutex};
+			--m_numPendingJobs;
+			m_pendingMemory -= size;
+		}
+		m_jobCompleted.notify_all();
+	}
+}
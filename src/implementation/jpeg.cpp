@@ -0,0 +1,464 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module;
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UIMG_JPEG_SSE2
+#include <emmintrin.h>
+#endif
+
+module pragma.image;
+
+import :core;
+import :thread_pool;
+
+// Baseline JPEG encoder. Every row of MCUs is its own restart interval, which allows
+// the rows to be entropy-coded independently on separate threads and concatenated afterwards.
+// Quantization and Huffman tables are the same as the ones used by stb_image_write.
+namespace jpeg {
+	static constexpr std::array<uint8_t, 64> ZIGZAG = {0, 1, 5, 6, 14, 15, 27, 28, 2, 4, 7, 13, 16, 26, 29, 42, 3, 8, 12, 17, 25, 30, 41, 43, 9, 11, 18, 24, 31, 40, 44, 53, 10, 19, 23, 32, 39, 45, 52, 54, 20, 22, 33, 38, 46, 51, 55, 60, 21, 34, 37, 47, 50, 56, 59, 61, 35,
+	  36, 48, 49, 57, 58, 62, 63};
+	static constexpr std::array<uint8_t, 64> Y_QUANTIZATION_TABLE
+	  = {16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55, 14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62, 18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92, 49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99};
+	static constexpr std::array<uint8_t, 64> UV_QUANTIZATION_TABLE
+	  = {17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99, 24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99};
+	// AAN DCT scale factors
+	static constexpr std::array<float, 8> AASF = {1.0f * 2.828427125f, 1.387039845f * 2.828427125f, 1.306562965f * 2.828427125f, 1.175875602f * 2.828427125f, 1.0f * 2.828427125f, 0.785694958f * 2.828427125f, 0.541196100f * 2.828427125f, 0.275899379f * 2.828427125f};
+
+	// Standard Huffman tables (ITU T.81 Annex K.3)
+	static constexpr std::array<uint8_t, 16> DC_LUMINANCE_COUNTS = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+	static constexpr std::array<uint8_t, 12> DC_LUMINANCE_VALUES = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+	static constexpr std::array<uint8_t, 16> AC_LUMINANCE_COUNTS = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+	static constexpr std::array<uint8_t, 162> AC_LUMINANCE_VALUES = {0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24,
+	  0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67,
+	  0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9,
+	  0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa};
+	static constexpr std::array<uint8_t, 16> DC_CHROMINANCE_COUNTS = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+	static constexpr std::array<uint8_t, 12> DC_CHROMINANCE_VALUES = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+	static constexpr std::array<uint8_t, 16> AC_CHROMINANCE_COUNTS = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+	static constexpr std::array<uint8_t, 162> AC_CHROMINANCE_VALUES = {0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15,
+	  0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66,
+	  0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7,
+	  0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa};
+
+	struct HuffmanTable {
+		std::array<uint16_t, 256> codes {};
+		std::array<uint8_t, 256> sizes {};
+	};
+	template<size_t N>
+	static HuffmanTable build_huffman_table(const std::array<uint8_t, 16> &counts, const std::array<uint8_t, N> &values)
+	{
+		HuffmanTable table {};
+		uint16_t code = 0;
+		size_t k = 0;
+		for(uint8_t len = 1; len <= 16; ++len) {
+			for(auto i = decltype(counts[len - 1]) {0u}; i < counts[len - 1]; ++i) {
+				table.codes[values[k]] = code++;
+				table.sizes[values[k]] = len;
+				++k;
+			}
+			code <<= 1;
+		}
+		return table;
+	}
+
+	struct Tables {
+		Tables()
+		{
+			dcLuminance = build_huffman_table(DC_LUMINANCE_COUNTS, DC_LUMINANCE_VALUES);
+			acLuminance = build_huffman_table(AC_LUMINANCE_COUNTS, AC_LUMINANCE_VALUES);
+			dcChrominance = build_huffman_table(DC_CHROMINANCE_COUNTS, DC_CHROMINANCE_VALUES);
+			acChrominance = build_huffman_table(AC_CHROMINANCE_COUNTS, AC_CHROMINANCE_VALUES);
+		}
+		HuffmanTable dcLuminance;
+		HuffmanTable acLuminance;
+		HuffmanTable dcChrominance;
+		HuffmanTable acChrominance;
+	};
+	static const Tables &get_tables()
+	{
+		static Tables tables {};
+		return tables;
+	}
+
+	class BitWriter {
+	  public:
+		BitWriter(std::vector<uint8_t> &out) : m_out {out} {}
+		void Write(uint32_t code, uint32_t size)
+		{
+			m_buffer = (m_buffer << size) | (code & ((1u << size) - 1));
+			m_count += size;
+			while(m_count >= 8) {
+				auto byte = static_cast<uint8_t>(m_buffer >> (m_count - 8));
+				m_out.push_back(byte);
+				if(byte == 0xFF)
+					m_out.push_back(0); // Byte stuffing
+				m_count -= 8;
+			}
+			m_buffer &= (1u << m_count) - 1;
+		}
+		// Pads the remaining bits with 1s, as required at the end of a restart interval
+		void Flush()
+		{
+			if(m_count > 0)
+				Write(0x7F, 8 - m_count);
+		}
+	  private:
+		std::vector<uint8_t> &m_out;
+		uint32_t m_buffer = 0;
+		uint32_t m_count = 0;
+	};
+
+	template<typename T>
+	static void dct_1d(std::array<T, 8> &v)
+	{
+		auto tmp0 = v[0] + v[7];
+		auto tmp7 = v[0] - v[7];
+		auto tmp1 = v[1] + v[6];
+		auto tmp6 = v[1] - v[6];
+		auto tmp2 = v[2] + v[5];
+		auto tmp5 = v[2] - v[5];
+		auto tmp3 = v[3] + v[4];
+		auto tmp4 = v[3] - v[4];
+
+		// Even part
+		auto tmp10 = tmp0 + tmp3;
+		auto tmp13 = tmp0 - tmp3;
+		auto tmp11 = tmp1 + tmp2;
+		auto tmp12 = tmp1 - tmp2;
+
+		v[0] = tmp10 + tmp11;
+		v[4] = tmp10 - tmp11;
+
+		auto z1 = (tmp12 + tmp13) * 0.707106781f;
+		v[2] = tmp13 + z1;
+		v[6] = tmp13 - z1;
+
+		// Odd part
+		tmp10 = tmp4 + tmp5;
+		tmp11 = tmp5 + tmp6;
+		tmp12 = tmp6 + tmp7;
+
+		auto z5 = (tmp10 - tmp12) * 0.382683433f;
+		auto z2 = tmp10 * 0.541196100f + z5;
+		auto z4 = tmp12 * 1.306562965f + z5;
+		auto z3 = tmp11 * 0.707106781f;
+
+		auto z11 = tmp7 + z3;
+		auto z13 = tmp7 - z3;
+
+		v[5] = z13 + z2;
+		v[3] = z13 - z2;
+		v[1] = z11 + z4;
+		v[7] = z11 - z4;
+	}
+
+#ifdef UIMG_JPEG_SSE2
+	struct Float4 {
+		__m128 v;
+		Float4 operator+(const Float4 &o) const { return {_mm_add_ps(v, o.v)}; }
+		Float4 operator-(const Float4 &o) const { return {_mm_sub_ps(v, o.v)}; }
+		Float4 operator*(float f) const { return {_mm_mul_ps(v, _mm_set1_ps(f))}; }
+	};
+	// Transforms the 8x8 block in-place. Each half of a row is processed as one vector, so
+	// the vertical pass transforms four columns at once, then the block is transposed for the horizontal pass.
+	static void dct_2d(float *block)
+	{
+		std::array<Float4, 8> left;
+		std::array<Float4, 8> right;
+		for(uint32_t r = 0; r < 8; ++r) {
+			left[r].v = _mm_loadu_ps(block + r * 8);
+			right[r].v = _mm_loadu_ps(block + r * 8 + 4);
+		}
+		auto transpose = [&left, &right]() {
+			_MM_TRANSPOSE4_PS(left[0].v, left[1].v, left[2].v, left[3].v);
+			_MM_TRANSPOSE4_PS(left[4].v, left[5].v, left[6].v, left[7].v);
+			_MM_TRANSPOSE4_PS(right[0].v, right[1].v, right[2].v, right[3].v);
+			_MM_TRANSPOSE4_PS(right[4].v, right[5].v, right[6].v, right[7].v);
+			// Swap the off-diagonal 4x4 quadrants
+			for(uint32_t i = 0; i < 4; ++i)
+				std::swap(right[i], left[i + 4]);
+		};
+		dct_1d(left);
+		dct_1d(right);
+		transpose();
+		dct_1d(left);
+		dct_1d(right);
+		transpose();
+		for(uint32_t r = 0; r < 8; ++r) {
+			_mm_storeu_ps(block + r * 8, left[r].v);
+			_mm_storeu_ps(block + r * 8 + 4, right[r].v);
+		}
+	}
+#else
+	static void dct_2d(float *block)
+	{
+		std::array<float, 8> v;
+		for(uint32_t r = 0; r < 8; ++r) {
+			std::copy_n(block + r * 8, 8, v.begin());
+			dct_1d(v);
+			std::copy_n(v.begin(), 8, block + r * 8);
+		}
+		for(uint32_t c = 0; c < 8; ++c) {
+			for(uint32_t r = 0; r < 8; ++r)
+				v[r] = block[r * 8 + c];
+			dct_1d(v);
+			for(uint32_t r = 0; r < 8; ++r)
+				block[r * 8 + c] = v[r];
+		}
+	}
+#endif
+
+	// Converts a block of r, g, b values (stored as separate planes) to Y, Cb and Cr in-place
+	static void rgb_to_ycbcr(float *r, float *g, float *b)
+	{
+#ifdef UIMG_JPEG_SSE2
+		for(uint32_t i = 0; i < 64; i += 4) {
+			auto vr = _mm_loadu_ps(r + i);
+			auto vg = _mm_loadu_ps(g + i);
+			auto vb = _mm_loadu_ps(b + i);
+			auto y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vr, _mm_set1_ps(0.29900f)), _mm_mul_ps(vg, _mm_set1_ps(0.58700f))), _mm_sub_ps(_mm_mul_ps(vb, _mm_set1_ps(0.11400f)), _mm_set1_ps(128.f)));
+			auto cb = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(vr, _mm_set1_ps(-0.16874f)), _mm_mul_ps(vg, _mm_set1_ps(0.33126f))), _mm_mul_ps(vb, _mm_set1_ps(0.50000f)));
+			auto cr = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(vr, _mm_set1_ps(0.50000f)), _mm_mul_ps(vg, _mm_set1_ps(0.41869f))), _mm_mul_ps(vb, _mm_set1_ps(0.08131f)));
+			_mm_storeu_ps(r + i, y);
+			_mm_storeu_ps(g + i, cb);
+			_mm_storeu_ps(b + i, cr);
+		}
+#else
+		for(uint32_t i = 0; i < 64; ++i) {
+			auto vr = r[i];
+			auto vg = g[i];
+			auto vb = b[i];
+			r[i] = +0.29900f * vr + 0.58700f * vg + 0.11400f * vb - 128;
+			g[i] = -0.16874f * vr - 0.33126f * vg + 0.50000f * vb;
+			b[i] = +0.50000f * vr - 0.41869f * vg - 0.08131f * vb;
+		}
+#endif
+	}
+
+	static void encode_block(BitWriter &writer, float *block, const std::array<float, 64> &fdtbl, int32_t &dc, const HuffmanTable &dcTable, const HuffmanTable &acTable)
+	{
+		dct_2d(block);
+
+		std::array<int32_t, 64> du;
+		for(uint32_t i = 0; i < 64; ++i) {
+			auto v = block[i] * fdtbl[i];
+			du[ZIGZAG[i]] = static_cast<int32_t>(v < 0 ? v - 0.5f : v + 0.5f);
+		}
+
+		auto writeValue = [&writer](const HuffmanTable &table, uint32_t runLength, int32_t value) {
+			auto absValue = static_cast<uint32_t>(value < 0 ? -value : value);
+			uint32_t numBits = 0;
+			while(absValue >> numBits)
+				++numBits;
+			auto symbol = (runLength << 4) | numBits;
+			writer.Write(table.codes[symbol], table.sizes[symbol]);
+			if(numBits > 0)
+				writer.Write(static_cast<uint32_t>(value < 0 ? value - 1 : value), numBits);
+		};
+
+		writeValue(dcTable, 0, du[0] - dc);
+		dc = du[0];
+
+		int32_t end = 63;
+		while(end > 0 && du[end] == 0)
+			--end;
+		uint32_t numZeroes = 0;
+		for(int32_t i = 1; i <= end; ++i) {
+			if(du[i] == 0) {
+				++numZeroes;
+				continue;
+			}
+			while(numZeroes >= 16) {
+				writer.Write(acTable.codes[0xF0], acTable.sizes[0xF0]);
+				numZeroes -= 16;
+			}
+			writeValue(acTable, numZeroes, du[i]);
+			numZeroes = 0;
+		}
+		if(end != 63)
+			writer.Write(acTable.codes[0x00], acTable.sizes[0x00]); // EOB
+	}
+
+	static void write_u16(std::vector<uint8_t> &out, uint32_t value)
+	{
+		out.push_back(static_cast<uint8_t>(value >> 8));
+		out.push_back(static_cast<uint8_t>(value & 0xFF));
+	}
+	template<size_t N>
+	static void write_huffman_table(std::vector<uint8_t> &out, uint8_t tableClassAndId, const std::array<uint8_t, 16> &counts, const std::array<uint8_t, N> &values)
+	{
+		out.push_back(tableClassAndId);
+		out.insert(out.end(), counts.begin(), counts.end());
+		out.insert(out.end(), values.begin(), values.end());
+	}
+};
+
+bool pragma::image::save_jpeg(ufile::IFile &f, const ImageBuffer &imgBuffer, float quality, bool flipVertically)
+{
+	if(!imgBuffer.IsLDRFormat())
+		return save_jpeg(f, *imgBuffer.Copy(ImageBuffer::ToLDRFormat(imgBuffer.GetFormat())), quality, flipVertically);
+	auto w = imgBuffer.GetWidth();
+	auto h = imgBuffer.GetHeight();
+	if(w == 0 || h == 0 || w > std::numeric_limits<uint16_t>::max() || h > std::numeric_limits<uint16_t>::max())
+		return false;
+	auto numChannels = imgBuffer.GetChannelCount();
+	// Two-channel images are treated as grayscale + alpha, alpha is ignored
+	auto grayscale = numChannels < 3;
+	auto numComponents = grayscale ? 1u : 3u;
+
+	auto iquality = pragma::math::clamp(static_cast<int32_t>(quality * 100.f), 1, 100);
+	// Like stb_image_write, chroma is subsampled (4:2:0) for anything but the highest quality settings
+	auto subsample = !grayscale && iquality <= 90;
+	iquality = (iquality < 50) ? (5000 / iquality) : (200 - iquality * 2);
+
+	std::array<uint8_t, 64> yTable;
+	std::array<uint8_t, 64> uvTable;
+	for(uint32_t i = 0; i < 64; ++i) {
+		yTable[jpeg::ZIGZAG[i]] = static_cast<uint8_t>(pragma::math::clamp((jpeg::Y_QUANTIZATION_TABLE[i] * iquality + 50) / 100, 1, 255));
+		uvTable[jpeg::ZIGZAG[i]] = static_cast<uint8_t>(pragma::math::clamp((jpeg::UV_QUANTIZATION_TABLE[i] * iquality + 50) / 100, 1, 255));
+	}
+	std::array<float, 64> fdtblY;
+	std::array<float, 64> fdtblUV;
+	for(uint32_t row = 0, k = 0; row < 8; ++row) {
+		for(uint32_t col = 0; col < 8; ++col, ++k) {
+			fdtblY[k] = 1.f / (yTable[jpeg::ZIGZAG[k]] * jpeg::AASF[row] * jpeg::AASF[col]);
+			fdtblUV[k] = 1.f / (uvTable[jpeg::ZIGZAG[k]] * jpeg::AASF[row] * jpeg::AASF[col]);
+		}
+	}
+
+	auto mcuSize = subsample ? 16u : 8u;
+	auto numMcusX = (w + mcuSize - 1) / mcuSize;
+	auto numMcusY = (h + mcuSize - 1) / mcuSize;
+
+	std::vector<uint8_t> header;
+	header.reserve(1024);
+	// SOI + APP0 (JFIF)
+	header.insert(header.end(), {0xFF, 0xD8, 0xFF, 0xE0, 0, 0x10, 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0});
+	// DQT
+	header.insert(header.end(), {0xFF, 0xDB});
+	jpeg::write_u16(header, 2 + (grayscale ? 65 : 130));
+	header.push_back(0);
+	header.insert(header.end(), yTable.begin(), yTable.end());
+	if(!grayscale) {
+		header.push_back(1);
+		header.insert(header.end(), uvTable.begin(), uvTable.end());
+	}
+	// SOF0
+	header.insert(header.end(), {0xFF, 0xC0});
+	jpeg::write_u16(header, 8 + 3 * numComponents);
+	header.push_back(8);
+	jpeg::write_u16(header, h);
+	jpeg::write_u16(header, w);
+	header.push_back(static_cast<uint8_t>(numComponents));
+	for(uint8_t c = 0; c < numComponents; ++c)
+		header.insert(header.end(), {static_cast<uint8_t>(c + 1), static_cast<uint8_t>((c == 0 && subsample) ? 0x22 : 0x11), static_cast<uint8_t>(c == 0 ? 0 : 1)});
+	// DHT
+	header.insert(header.end(), {0xFF, 0xC4});
+	auto sizeDht = 2 + (1 + 16 + jpeg::DC_LUMINANCE_VALUES.size()) + (1 + 16 + jpeg::AC_LUMINANCE_VALUES.size());
+	if(!grayscale)
+		sizeDht += (1 + 16 + jpeg::DC_CHROMINANCE_VALUES.size()) + (1 + 16 + jpeg::AC_CHROMINANCE_VALUES.size());
+	jpeg::write_u16(header, static_cast<uint32_t>(sizeDht));
+	jpeg::write_huffman_table(header, 0x00, jpeg::DC_LUMINANCE_COUNTS, jpeg::DC_LUMINANCE_VALUES);
+	jpeg::write_huffman_table(header, 0x10, jpeg::AC_LUMINANCE_COUNTS, jpeg::AC_LUMINANCE_VALUES);
+	if(!grayscale) {
+		jpeg::write_huffman_table(header, 0x01, jpeg::DC_CHROMINANCE_COUNTS, jpeg::DC_CHROMINANCE_VALUES);
+		jpeg::write_huffman_table(header, 0x11, jpeg::AC_CHROMINANCE_COUNTS, jpeg::AC_CHROMINANCE_VALUES);
+	}
+	// DRI, one restart interval per MCU row
+	header.insert(header.end(), {0xFF, 0xDD, 0, 4});
+	jpeg::write_u16(header, numMcusX);
+	// SOS
+	header.insert(header.end(), {0xFF, 0xDA});
+	jpeg::write_u16(header, 6 + 2 * numComponents);
+	header.push_back(static_cast<uint8_t>(numComponents));
+	for(uint8_t c = 0; c < numComponents; ++c)
+		header.insert(header.end(), {static_cast<uint8_t>(c + 1), static_cast<uint8_t>(c == 0 ? 0x00 : 0x11)});
+	header.insert(header.end(), {0, 63, 0});
+
+	auto &tables = jpeg::get_tables();
+	auto *data = static_cast<const uint8_t *>(imgBuffer.GetData());
+	auto pxSize = imgBuffer.GetPixelSize();
+	auto rowSize = imgBuffer.GetRowStride();
+	auto ofsG = grayscale ? 0 : 1;
+	auto ofsB = grayscale ? 0 : 2;
+	std::vector<std::vector<uint8_t>> segments;
+	segments.resize(numMcusY);
+	parallel_for(numMcusY, [&](uint32_t mcuY) {
+		auto &segment = segments[mcuY];
+		segment.reserve(numMcusX * 64);
+		jpeg::BitWriter writer {segment};
+		int32_t dcY = 0;
+		int32_t dcU = 0;
+		int32_t dcV = 0;
+		// Planes of a full MCU (up to 16x16 pixels), row-major
+		alignas(16) std::array<float, 256> r;
+		alignas(16) std::array<float, 256> g;
+		alignas(16) std::array<float, 256> b;
+		alignas(16) std::array<float, 64> block;
+		for(uint32_t mcuX = 0; mcuX < numMcusX; ++mcuX) {
+			for(uint32_t row = 0; row < mcuSize; ++row) {
+				// Blocks on the edges repeat the last row/column
+				auto y = std::min(mcuY * mcuSize + row, h - 1);
+				auto *srcRow = data + (flipVertically ? (h - 1 - y) : y) * rowSize;
+				for(uint32_t col = 0; col < mcuSize; ++col) {
+					auto *px = srcRow + std::min(mcuX * mcuSize + col, w - 1) * pxSize;
+					r[row * mcuSize + col] = px[0];
+					g[row * mcuSize + col] = px[ofsG];
+					b[row * mcuSize + col] = px[ofsB];
+				}
+			}
+			if(grayscale) {
+				for(uint32_t i = 0; i < 64; ++i)
+					r[i] -= 128.f;
+				jpeg::encode_block(writer, r.data(), fdtblY, dcY, tables.dcLuminance, tables.acLuminance);
+				continue;
+			}
+			for(uint32_t i = 0; i < mcuSize * mcuSize; i += 64)
+				jpeg::rgb_to_ycbcr(r.data() + i, g.data() + i, b.data() + i);
+			if(!subsample) {
+				jpeg::encode_block(writer, r.data(), fdtblY, dcY, tables.dcLuminance, tables.acLuminance);
+				jpeg::encode_block(writer, g.data(), fdtblUV, dcU, tables.dcChrominance, tables.acChrominance);
+				jpeg::encode_block(writer, b.data(), fdtblUV, dcV, tables.dcChrominance, tables.acChrominance);
+				continue;
+			}
+			// Four luminance blocks in raster order, followed by one block each of the 2x2-averaged chroma planes
+			for(uint32_t by = 0; by < 2; ++by) {
+				for(uint32_t bx = 0; bx < 2; ++bx) {
+					for(uint32_t row = 0; row < 8; ++row)
+						std::copy_n(r.data() + (by * 8 + row) * 16 + bx * 8, 8, block.data() + row * 8);
+					jpeg::encode_block(writer, block.data(), fdtblY, dcY, tables.dcLuminance, tables.acLuminance);
+				}
+			}
+			auto downsample = [&block](const std::array<float, 256> &plane) {
+				for(uint32_t row = 0; row < 8; ++row) {
+					for(uint32_t col = 0; col < 8; ++col) {
+						auto *src = plane.data() + row * 2 * 16 + col * 2;
+						block[row * 8 + col] = (src[0] + src[1] + src[16] + src[17]) * 0.25f;
+					}
+				}
+			};
+			downsample(g);
+			jpeg::encode_block(writer, block.data(), fdtblUV, dcU, tables.dcChrominance, tables.acChrominance);
+			downsample(b);
+			jpeg::encode_block(writer, block.data(), fdtblUV, dcV, tables.dcChrominance, tables.acChrominance);
+		}
+		writer.Flush();
+	});
+
+	if(f.Write(header.data(), header.size()) != header.size())
+		return false;
+	for(uint32_t i = 0; i < numMcusY; ++i) {
+		auto &segment = segments[i];
+		if(f.Write(segment.data(), segment.size()) != segment.size())
+			return false;
+		if(i + 1 < numMcusY) {
+			std::array<uint8_t, 2> rst = {0xFF, static_cast<uint8_t>(0xD0 + (i % 8))};
+			if(f.Write(rst.data(), rst.size()) != rst.size())
+				return false;
+		}
+	}
+	std::array<uint8_t, 2> eoi = {0xFF, 0xD9};
+	return f.Write(eoi.data(), eoi.size()) == eoi.size();
+}
@@ -0,0 +1,394 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module;
+
+#include <zlib.h>
+#ifdef UIMG_ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+module pragma.image;
+
+import :texture_file;
+import :thread_pool;
+
+// See https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+namespace ktx2_writer {
+	constexpr std::array<uint8_t, 12> IDENTIFIER = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+	constexpr uint32_t HEADER_SIZE = 80;
+	constexpr uint32_t LEVEL_INDEX_ENTRY_SIZE = 24;
+	constexpr std::string_view WRITER = "pragma::image";
+
+	// Data format descriptor values, see https://registry.khronos.org/DataFormat/specs/1.3/dataformat.1.3.html
+	namespace dfd {
+		enum class ColorModel : uint8_t { RGBSDA = 1, BC1A = 128, BC2, BC3, BC4, BC5, BC6H, BC7, ETC2 = 161, ASTC };
+		constexpr uint8_t PRIMARIES_BT709 = 1;
+		constexpr uint8_t TRANSFER_LINEAR = 1;
+		constexpr uint8_t TRANSFER_SRGB = 2;
+		constexpr uint32_t VERSION = 2;
+		constexpr uint32_t BLOCK_HEADER_SIZE = 24;
+		constexpr uint32_t SAMPLE_SIZE = 16;
+
+		// Channel identifiers depend on the color model
+		constexpr uint8_t CHANNEL_COLOR = 0; // BCn and ASTC
+		constexpr uint8_t CHANNEL_RED = 0;
+		constexpr uint8_t CHANNEL_GREEN = 1;
+		constexpr uint8_t CHANNEL_BLUE = 2;
+		constexpr uint8_t CHANNEL_ALPHA = 15;
+		constexpr uint8_t CHANNEL_BC1A_ALPHA_PRESENT = 1;
+		constexpr uint8_t CHANNEL_ETC2_COLOR = 2;
+
+		constexpr uint8_t QUALIFIER_LINEAR = 0x10;
+		constexpr uint8_t QUALIFIER_SIGNED = 0x40;
+		constexpr uint8_t QUALIFIER_FLOAT = 0x80;
+
+		constexpr uint32_t FLOAT_MINUS_ONE = 0xBF800000;
+		constexpr uint32_t FLOAT_ONE = 0x3F800000;
+
+		struct Sample {
+			uint8_t channel = 0;
+			uint8_t qualifiers = 0;
+			uint32_t bitOffset = 0;
+			uint32_t bitLength = 0;
+			uint32_t lower = 0;
+			uint32_t upper = std::numeric_limits<uint32_t>::max();
+		};
+
+		static std::vector<uint32_t> create(pragma::image::TextureFileFormat format, bool srgb, bool supercompressed)
+		{
+			using pragma::image::TextureFileFormat;
+			auto blockSize = pragma::image::get_block_size(format);
+			auto [bw, bh] = pragma::image::get_block_extent(format);
+			auto model = ColorModel::RGBSDA;
+			std::vector<Sample> samples;
+			// Compressed blocks with two channels store each of them in one half of the block
+			auto setBlockChannels = [&samples, blockSize, srgb](std::initializer_list<uint8_t> channels, uint8_t qualifiers = 0, uint32_t lower = 0, uint32_t upper = std::numeric_limits<uint32_t>::max()) {
+				auto bitLength = blockSize * 8 / static_cast<uint32_t>(channels.size());
+				uint32_t bitOffset = 0;
+				for(auto channel : channels) {
+					Sample sample {channel, qualifiers, bitOffset, bitLength, lower, upper};
+					// Alpha is never encoded with the sRGB transfer function
+					if(srgb && channel == CHANNEL_ALPHA)
+						sample.qualifiers |= QUALIFIER_LINEAR;
+					samples.push_back(sample);
+					bitOffset += bitLength;
+				}
+			};
+			auto setPixelChannels = [&samples, blockSize, srgb](std::initializer_list<uint8_t> channels, bool isFloat) {
+				auto bitLength = blockSize * 8 / static_cast<uint32_t>(channels.size());
+				uint32_t bitOffset = 0;
+				for(auto channel : channels) {
+					Sample sample {channel, 0, bitOffset, bitLength};
+					if(isFloat) {
+						sample.qualifiers = QUALIFIER_FLOAT | QUALIFIER_SIGNED;
+						sample.lower = FLOAT_MINUS_ONE;
+						sample.upper = FLOAT_ONE;
+					}
+					else
+						sample.upper = (1u << bitLength) - 1;
+					// Alpha is never encoded with the sRGB transfer function
+					if(srgb && channel == CHANNEL_ALPHA)
+						sample.qualifiers |= QUALIFIER_LINEAR;
+					samples.push_back(sample);
+					bitOffset += bitLength;
+				}
+			};
+			switch(format) {
+			case TextureFileFormat::R8:
+				setPixelChannels({CHANNEL_RED}, false);
+				break;
+			case TextureFileFormat::RG8:
+				setPixelChannels({CHANNEL_RED, CHANNEL_GREEN}, false);
+				break;
+			case TextureFileFormat::RGB8:
+				setPixelChannels({CHANNEL_RED, CHANNEL_GREEN, CHANNEL_BLUE}, false);
+				break;
+			case TextureFileFormat::RGBA8:
+				setPixelChannels({CHANNEL_RED, CHANNEL_GREEN, CHANNEL_BLUE, CHANNEL_ALPHA}, false);
+				break;
+			case TextureFileFormat::BGRA8:
+				setPixelChannels({CHANNEL_BLUE, CHANNEL_GREEN, CHANNEL_RED, CHANNEL_ALPHA}, false);
+				break;
+			case TextureFileFormat::R32F:
+				setPixelChannels({CHANNEL_RED}, true);
+				break;
+			case TextureFileFormat::RGBA16F:
+			case TextureFileFormat::RGBA32F:
+				setPixelChannels({CHANNEL_RED, CHANNEL_GREEN, CHANNEL_BLUE, CHANNEL_ALPHA}, true);
+				break;
+			case TextureFileFormat::BC1:
+				model = ColorModel::BC1A;
+				setBlockChannels({CHANNEL_COLOR});
+				break;
+			case TextureFileFormat::BC1a:
+				model = ColorModel::BC1A;
+				setBlockChannels({CHANNEL_BC1A_ALPHA_PRESENT});
+				break;
+			case TextureFileFormat::BC2:
+				model = ColorModel::BC2;
+				setBlockChannels({CHANNEL_ALPHA, CHANNEL_COLOR});
+				break;
+			case TextureFileFormat::BC3:
+				model = ColorModel::BC3;
+				setBlockChannels({CHANNEL_ALPHA, CHANNEL_COLOR});
+				break;
+			case TextureFileFormat::BC4:
+				model = ColorModel::BC4;
+				setBlockChannels({CHANNEL_RED});
+				break;
+			case TextureFileFormat::BC5:
+				model = ColorModel::BC5;
+				setBlockChannels({CHANNEL_RED, CHANNEL_GREEN});
+				break;
+			case TextureFileFormat::BC6H:
+				model = ColorModel::BC6H;
+				setBlockChannels({CHANNEL_COLOR}, QUALIFIER_FLOAT, 0, FLOAT_ONE);
+				break;
+			case TextureFileFormat::BC6H_Signed:
+				model = ColorModel::BC6H;
+				setBlockChannels({CHANNEL_COLOR}, QUALIFIER_FLOAT | QUALIFIER_SIGNED, FLOAT_MINUS_ONE, FLOAT_ONE);
+				break;
+			case TextureFileFormat::BC7:
+				model = ColorModel::BC7;
+				setBlockChannels({CHANNEL_COLOR});
+				break;
+			case TextureFileFormat::ETC1:
+			case TextureFileFormat::ETC2_RGB:
+			case TextureFileFormat::ETC2_RGB_A1:
+				model = ColorModel::ETC2;
+				setBlockChannels({CHANNEL_ETC2_COLOR});
+				break;
+			case TextureFileFormat::ETC2_RGBA:
+				model = ColorModel::ETC2;
+				setBlockChannels({CHANNEL_ALPHA, CHANNEL_ETC2_COLOR});
+				break;
+			case TextureFileFormat::EAC_R11:
+				model = ColorModel::ETC2;
+				setBlockChannels({CHANNEL_RED});
+				break;
+			case TextureFileFormat::EAC_RG11:
+				model = ColorModel::ETC2;
+				setBlockChannels({CHANNEL_RED, CHANNEL_GREEN});
+				break;
+			default:
+				if(pragma::math::to_integral(format) < pragma::math::to_integral(TextureFileFormat::ASTC_4x4) || pragma::math::to_integral(format) > pragma::math::to_integral(TextureFileFormat::ASTC_8x8))
+					return {};
+				model = ColorModel::ASTC;
+				setBlockChannels({CHANNEL_COLOR});
+				break;
+			}
+			static_assert(pragma::math::to_integral(TextureFileFormat::Count) == 32);
+
+			auto blockByteSize = BLOCK_HEADER_SIZE + static_cast<uint32_t>(samples.size()) * SAMPLE_SIZE;
+			std::vector<uint32_t> words;
+			words.reserve(1 + blockByteSize / sizeof(uint32_t));
+			words.push_back(sizeof(uint32_t) + blockByteSize);
+			words.push_back(0); // Khronos vendor, basic descriptor type
+			words.push_back(VERSION | (blockByteSize << 16));
+			auto isFloat = (format == TextureFileFormat::RGBA16F || format == TextureFileFormat::R32F || format == TextureFileFormat::RGBA32F || format == TextureFileFormat::BC6H || format == TextureFileFormat::BC6H_Signed);
+			auto transfer = (srgb && !isFloat) ? TRANSFER_SRGB : TRANSFER_LINEAR;
+			words.push_back(pragma::math::to_integral(model) | (PRIMARIES_BT709 << 8) | (transfer << 16));
+			words.push_back((bw - 1) | ((bh - 1) << 8));
+			// The size of a plane is unknown for supercompressed data
+			words.push_back(supercompressed ? 0 : blockSize);
+			words.push_back(0);
+			for(auto &sample : samples) {
+				words.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) | (static_cast<uint32_t>(sample.channel | sample.qualifiers) << 24));
+				words.push_back(0); // Sample position
+				words.push_back(sample.lower);
+				words.push_back(sample.upper);
+			}
+			return words;
+		}
+	};
+
+	template<typename T>
+	static void write_value(std::vector<uint8_t> &data, T value)
+	{
+		auto offset = data.size();
+		data.resize(offset + sizeof(T));
+		std::memcpy(data.data() + offset, &value, sizeof(T));
+	}
+
+	// Size of the data type of a pixel component, 1 for block-compressed formats
+	static uint32_t get_type_size(pragma::image::TextureFileFormat format)
+	{
+		using pragma::image::TextureFileFormat;
+		switch(format) {
+		case TextureFileFormat::RGBA16F:
+			return 2;
+		case TextureFileFormat::R32F:
+		case TextureFileFormat::RGBA32F:
+			return 4;
+		default:
+			break;
+		}
+		return 1;
+	}
+
+	static size_t get_surface_size(const pragma::image::Ktx2WriteInfo &info, uint32_t mipmap)
+	{
+		auto [bw, bh] = pragma::image::get_block_extent(info.format);
+		auto w = std::max(info.width >> mipmap, 1u);
+		auto h = std::max(info.height >> mipmap, 1u);
+		return static_cast<size_t>((w + bw - 1) / bw) * ((h + bh - 1) / bh) * pragma::image::get_block_size(info.format);
+	}
+
+	static bool compress(const pragma::image::Ktx2WriteInfo &info, const std::vector<uint8_t> &src, std::vector<uint8_t> &dst)
+	{
+		using pragma::image::TextureFileSupercompression;
+		switch(info.supercompression) {
+		case TextureFileSupercompression::Zstd:
+			{
+#ifdef UIMG_ENABLE_ZSTD
+				dst.resize(ZSTD_compressBound(src.size()));
+				auto size = ZSTD_compress(dst.data(), dst.size(), src.data(), src.size(), info.compressionLevel.value_or(ZSTD_CLEVEL_DEFAULT));
+				if(ZSTD_isError(size))
+					return false;
+				dst.resize(size);
+				return true;
+#else
+				return false;
+#endif
+			}
+		case TextureFileSupercompression::Zlib:
+			{
+				auto size = compressBound(static_cast<uLong>(src.size()));
+				dst.resize(size);
+				if(compress2(dst.data(), &size, src.data(), static_cast<uLong>(src.size()), info.compressionLevel.value_or(Z_DEFAULT_COMPRESSION)) != Z_OK)
+					return false;
+				dst.resize(size);
+				return true;
+			}
+		default:
+			break;
+		}
+		return false;
+	}
+
+	static bool write(const pragma::image::Ktx2WriteInfo &info, const std::function<bool(const void *, size_t)> &writeData)
+	{
+		using namespace pragma::image;
+		auto vkFormat = get_vk_format(info.format, info.srgb);
+		auto numFaces = info.cubemap ? 6u : 1u;
+		if(vkFormat == 0 || info.width == 0 || info.height == 0 || info.numLayers == 0 || info.numMipmaps == 0 || (info.numLayers % numFaces) != 0 || !info.getSurfaceData)
+			return false;
+		auto supercompressed = (info.supercompression != TextureFileSupercompression::None);
+#ifndef UIMG_ENABLE_ZSTD
+		if(info.supercompression == TextureFileSupercompression::Zstd)
+			return false;
+#endif
+
+		// Each level is supercompressed as a whole, the levels are distributed across the worker threads
+		std::vector<std::vector<uint8_t>> levelData;
+		levelData.resize(info.numMipmaps);
+		std::vector<size_t> uncompressedSizes;
+		uncompressedSizes.resize(info.numMipmaps);
+		std::atomic<bool> success = true;
+		pragma::image::parallel_for(info.numMipmaps, [&](uint32_t m) {
+			auto surfaceSize = get_surface_size(info, m);
+			std::vector<uint8_t> data;
+			data.resize(surfaceSize * info.numLayers);
+			for(uint32_t l = 0; l < info.numLayers; ++l) {
+				auto surfaceData = info.getSurfaceData(l, m);
+				if(surfaceData.size() != surfaceSize) {
+					success = false;
+					return;
+				}
+				std::memcpy(data.data() + l * surfaceSize, surfaceData.data(), surfaceSize);
+			}
+			uncompressedSizes[m] = data.size();
+			if(!supercompressed) {
+				levelData[m] = std::move(data);
+				return;
+			}
+			if(!compress(info, data, levelData[m]))
+				success = false;
+		});
+		if(!success)
+			return false;
+
+		auto dfd = dfd::create(info.format, info.srgb, supercompressed);
+		std::vector<uint8_t> kvd;
+		constexpr std::string_view writerKey = "KTXwriter";
+		write_value(kvd, static_cast<uint32_t>(writerKey.size() + WRITER.size() + 2));
+		kvd.insert(kvd.end(), writerKey.begin(), writerKey.end());
+		kvd.push_back(0);
+		kvd.insert(kvd.end(), WRITER.begin(), WRITER.end());
+		kvd.push_back(0);
+		kvd.resize((kvd.size() + 3) & ~static_cast<size_t>(3));
+
+		auto dfdOffset = HEADER_SIZE + info.numMipmaps * LEVEL_INDEX_ENTRY_SIZE;
+		auto dfdSize = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+		auto kvdOffset = dfdOffset + dfdSize;
+		auto kvdSize = static_cast<uint32_t>(kvd.size());
+
+		// Levels are stored from the smallest to the largest. Without supercompression they have to be aligned to the block size and to four bytes.
+		size_t alignment = 1;
+		if(!supercompressed)
+			alignment = std::lcm(static_cast<size_t>(get_block_size(info.format)), static_cast<size_t>(4));
+		std::vector<size_t> levelOffsets;
+		levelOffsets.resize(info.numMipmaps);
+		size_t offset = kvdOffset + kvdSize;
+		for(auto m = info.numMipmaps; m-- > 0;) {
+			offset = (offset + alignment - 1) / alignment * alignment;
+			levelOffsets[m] = offset;
+			offset += levelData[m].size();
+		}
+
+		std::vector<uint8_t> header;
+		header.reserve(kvdOffset + kvdSize);
+		header.insert(header.end(), IDENTIFIER.begin(), IDENTIFIER.end());
+		write_value(header, vkFormat);
+		write_value(header, get_type_size(info.format));
+		write_value(header, info.width);
+		write_value(header, info.height);
+		write_value(header, 0u); // pixelDepth
+		// The layer count is 0 if the texture is not an array
+		write_value(header, (info.numLayers > numFaces) ? info.numLayers / numFaces : 0u);
+		write_value(header, numFaces);
+		write_value(header, info.numMipmaps);
+		write_value(header, static_cast<uint32_t>(info.supercompression));
+		write_value(header, dfdOffset);
+		write_value(header, dfdSize);
+		write_value(header, kvdOffset);
+		write_value(header, kvdSize);
+		write_value(header, static_cast<uint64_t>(0)); // sgdByteOffset
+		write_value(header, static_cast<uint64_t>(0)); // sgdByteLength
+		for(uint32_t m = 0; m < info.numMipmaps; ++m) {
+			write_value(header, static_cast<uint64_t>(levelOffsets[m]));
+			write_value(header, static_cast<uint64_t>(levelData[m].size()));
+			write_value(header, static_cast<uint64_t>(uncompressedSizes[m]));
+		}
+		for(auto word : dfd)
+			write_value(header, word);
+		header.insert(header.end(), kvd.begin(), kvd.end());
+
+		if(!writeData(header.data(), header.size()))
+			return false;
+		offset = header.size();
+		constexpr std::array<uint8_t, 16> padding {};
+		for(auto m = info.numMipmaps; m-- > 0;) {
+			if(levelOffsets[m] > offset && !writeData(padding.data(), levelOffsets[m] - offset))
+				return false;
+			if(!writeData(levelData[m].data(), levelData[m].size()))
+				return false;
+			offset = levelOffsets[m] + levelData[m].size();
+		}
+		return true;
+	}
+};
+
+bool pragma::image::write_ktx2(ufile::IFile &f, const Ktx2WriteInfo &info)
+{
+	return ktx2_writer::write(info, [&f](const void *data, size_t size) { return f.Write(data, size) == size; });
+}
+
+bool pragma::image::write_ktx2(const std::string &path, const Ktx2WriteInfo &info)
+{
+	std::ofstream f {path, std::ios::binary | std::ios::trunc};
+	if(!f)
+		return false;
+	return ktx2_writer::write(info, [&f](const void *data, size_t size) { return static_cast<bool>(f.write(static_cast<const char *>(data), size)); });
+}
@@ -0,0 +1,139 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module;
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+module pragma.image;
+
+import :mapped_texture;
+
+namespace mapped_texture {
+	static const uint8_t *map_file(const std::string &path, size_t &outSize)
+	{
+#ifdef _WIN32
+		auto hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if(hFile == INVALID_HANDLE_VALUE)
+			return nullptr;
+		pragma::util::ScopeGuard sgFile {[hFile]() { CloseHandle(hFile); }};
+		LARGE_INTEGER size;
+		if(!GetFileSizeEx(hFile, &size) || size.QuadPart == 0)
+			return nullptr;
+		auto hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(!hMapping)
+			return nullptr;
+		// The view keeps the mapping alive, so neither handle is needed afterwards
+		pragma::util::ScopeGuard sgMapping {[hMapping]() { CloseHandle(hMapping); }};
+		auto *data = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+		if(!data)
+			return nullptr;
+		outSize = static_cast<size_t>(size.QuadPart);
+		return static_cast<const uint8_t *>(data);
+#else
+		auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if(fd == -1)
+			return nullptr;
+		// The mapping holds its own reference to the file
+		pragma::util::ScopeGuard sgFile {[fd]() { close(fd); }};
+		struct stat st;
+		if(fstat(fd, &st) != 0 || st.st_size <= 0)
+			return nullptr;
+		auto *data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if(data == MAP_FAILED)
+			return nullptr;
+		outSize = static_cast<size_t>(st.st_size);
+		return static_cast<const uint8_t *>(data);
+#endif
+	}
+	static void unmap_file(const uint8_t *data, size_t size)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+#else
+		munmap(const_cast<uint8_t *>(data), size);
+#endif
+	}
+	static size_t get_page_size()
+	{
+#ifdef _WIN32
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwPageSize;
+#else
+		return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+	}
+	static bool prefetch(const uint8_t *base, size_t offset, size_t size)
+	{
+		static auto pageSize = get_page_size();
+		auto start = offset / pageSize * pageSize;
+		auto *p = const_cast<uint8_t *>(base) + start;
+		auto len = offset + size - start;
+#ifdef _WIN32
+		WIN32_MEMORY_RANGE_ENTRY range {p, len};
+		return PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0) != 0;
+#else
+		return madvise(p, len, MADV_WILLNEED) == 0;
+#endif
+	}
+};
+
+std::unique_ptr<pragma::image::MappedTextureFile> pragma::image::MappedTextureFile::Open(const std::string &path)
+{
+	size_t size = 0;
+	auto *data = mapped_texture::map_file(path, size);
+	if(!data)
+		return nullptr;
+	auto info = parse_texture_file(std::span<const uint8_t> {data, size});
+	// Supercompressed surfaces can't be accessed in place
+	if(!info || info->supercompression != TextureFileSupercompression::None) {
+		mapped_texture::unmap_file(data, size);
+		return nullptr;
+	}
+	return std::unique_ptr<MappedTextureFile> {new MappedTextureFile {data, size, std::move(*info)}};
+}
+
+pragma::image::MappedTextureFile::MappedTextureFile(const uint8_t *data, size_t size, TextureFileInfo &&info) : m_data {data}, m_size {size}, m_info {std::move(info)} {}
+
+pragma::image::MappedTextureFile::~MappedTextureFile() { mapped_texture::unmap_file(m_data, m_size); }
+
+const pragma::image::TextureFileInfo &pragma::image::MappedTextureFile::GetInfo() const { return m_info; }
+std::span<const uint8_t> pragma::image::MappedTextureFile::GetData() const { return {m_data, m_size}; }
+const pragma::image::TextureFileSurface &pragma::image::MappedTextureFile::GetSurface(uint32_t layer, uint32_t mipmap) const { return m_info.GetSurface(layer, mipmap); }
+std::span<const uint8_t> pragma::image::MappedTextureFile::GetSurfaceData(uint32_t layer, uint32_t mipmap) const { return GetSurfaceData(GetSurface(layer, mipmap)); }
+std::span<const uint8_t> pragma::image::MappedTextureFile::GetSurfaceData(const TextureFileSurface &surface) const { return {m_data + surface.offset, surface.size}; }
+
+bool pragma::image::MappedTextureFile::Prefetch(uint32_t firstMipmap, uint32_t numMipmaps) const
+{
+	if(firstMipmap >= m_info.numMipmaps)
+		return false;
+	auto lastMipmap = firstMipmap + std::min(numMipmaps, m_info.numMipmaps - firstMipmap) - 1;
+	// Neighboring surfaces are merged into a single range: In KTX files the surfaces of a mipmap are stored contiguously for all layers,
+	// in DDS files the mipmaps of a layer are
+	std::vector<std::pair<size_t, size_t>> ranges;
+	for(auto &surface : m_info.surfaces) {
+		if(surface.mipmap < firstMipmap || surface.mipmap > lastMipmap)
+			continue;
+		ranges.push_back({surface.offset, surface.offset + surface.size});
+	}
+	std::sort(ranges.begin(), ranges.end());
+	auto success = true;
+	for(size_t i = 0; i < ranges.size();) {
+		auto [start, end] = ranges[i++];
+		// KTX surfaces may be separated by a few bytes of padding and size fields
+		constexpr size_t maxGap = 8;
+		while(i < ranges.size() && ranges[i].first <= end + maxGap)
+			end = std::max(end, ranges[i++].second);
+		if(!mapped_texture::prefetch(m_data, start, end - start))
+			success = false;
+	}
+	return success;
+}
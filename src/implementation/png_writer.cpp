@@ -0,0 +1,96 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module;
+
+#include <png.h>
+
+module pragma.image;
+
+import :core;
+
+// Maps every half-float value to the corresponding 16-bit unorm value (clamped to [0,1])
+static const std::array<uint16_t, std::numeric_limits<uint16_t>::max() + 1> &get_half_to_unorm16_table()
+{
+	static auto table = []() {
+		std::array<uint16_t, std::numeric_limits<uint16_t>::max() + 1> table;
+		for(size_t i = 0; i < table.size(); ++i) {
+			auto f = pragma::math::float16_to_float32_glm(static_cast<uint16_t>(i));
+			if(std::isnan(f))
+				f = 0.f;
+			table[i] = static_cast<uint16_t>(pragma::math::clamp(f, 0.f, 1.f) * std::numeric_limits<uint16_t>::max() + 0.5f);
+		}
+		return table;
+	}();
+	return table;
+}
+
+bool pragma::image::save_png16(ufile::IFile &f, const ImageBuffer &imgBuffer, Value16Encoding encoding, int32_t compressionLevel, bool flipVertically)
+{
+	if(!imgBuffer.IsHDRFormat())
+		return false;
+	auto w = imgBuffer.GetWidth();
+	auto h = imgBuffer.GetHeight();
+	if(w == 0 || h == 0)
+		return false;
+	int colorType;
+	switch(imgBuffer.GetChannelCount()) {
+	case 1:
+		colorType = PNG_COLOR_TYPE_GRAY;
+		break;
+	case 2:
+		colorType = PNG_COLOR_TYPE_GRAY_ALPHA;
+		break;
+	case 3:
+		colorType = PNG_COLOR_TYPE_RGB;
+		break;
+	default:
+		colorType = PNG_COLOR_TYPE_RGBA;
+		break;
+	}
+
+	auto *pngPtr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	if(!pngPtr)
+		return false;
+	auto *infoPtr = png_create_info_struct(pngPtr);
+	if(!infoPtr) {
+		png_destroy_write_struct(&pngPtr, nullptr);
+		return false;
+	}
+	// Unorm data can be handed to libpng directly, half data is converted one row at a time.
+	// The row buffer has to be allocated before setjmp, since libpng errors longjmp past any destructors.
+	auto numValuesPerRow = static_cast<size_t>(w) * imgBuffer.GetChannelCount();
+	std::vector<uint16_t> rowData;
+	if(encoding == Value16Encoding::Half)
+		rowData.resize(numValuesPerRow);
+	auto &halfToUnorm = get_half_to_unorm16_table();
+	auto *data = static_cast<const uint8_t *>(imgBuffer.GetData());
+	auto rowStride = imgBuffer.GetRowStride();
+
+	if(setjmp(png_jmpbuf(pngPtr))) {
+		png_destroy_write_struct(&pngPtr, &infoPtr);
+		return false;
+	}
+	png_set_write_fn(
+	  pngPtr, &f, [](png_structp pngPtr, png_bytep data, png_size_t size) { static_cast<ufile::IFile *>(png_get_io_ptr(pngPtr))->Write(data, size); }, [](png_structp) {});
+	png_set_compression_level(pngPtr, pragma::math::clamp(compressionLevel, 0, 9));
+	png_set_IHDR(pngPtr, infoPtr, w, h, 16, colorType, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(pngPtr, infoPtr);
+	// PNG stores 16-bit samples as big-endian
+	if constexpr(std::endian::native == std::endian::little)
+		png_set_swap(pngPtr);
+	for(auto y = decltype(h) {0u}; y < h; ++y) {
+		auto *srcRow = data + static_cast<size_t>(flipVertically ? (h - 1 - y) : y) * rowStride;
+		if(encoding == Value16Encoding::Unorm) {
+			png_write_row(pngPtr, srcRow);
+			continue;
+		}
+		auto *src = reinterpret_cast<const uint16_t *>(srcRow);
+		for(size_t i = 0; i < numValuesPerRow; ++i)
+			rowData[i] = halfToUnorm[src[i]];
+		png_write_row(pngPtr, reinterpret_cast<png_const_bytep>(rowData.data()));
+	}
+	png_write_end(pngPtr, nullptr);
+	png_destroy_write_struct(&pngPtr, &infoPtr);
+	return true;
+}
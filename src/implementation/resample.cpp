@@ -0,0 +1,958 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module;
+
+#if defined(__AVX2__)
+#define UIMG_RESAMPLE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UIMG_RESAMPLE_SSE2
+#include <emmintrin.h>
+#endif
+
+module pragma.image;
+
+import :buffer;
+import :core;
+import :thread_pool;
+
+// Native resampling. Values are decoded to linear floats (with color channels premultiplied by alpha, like stb_image_resize does it),
+// filtered and encoded back to the source format.
+namespace resample {
+	enum class ValueType : uint8_t { LDR = 0, Half, Float };
+
+	using Tables = pragma::image::SrgbTables;
+	static const Tables &get_tables() { return pragma::image::get_srgb_tables(); }
+
+	static uint8_t encode_linear(float v) { return static_cast<uint8_t>(pragma::math::clamp(v, 0.f, 1.f) * 255.f + 0.5f); }
+
+	// Filter taps, relative to the first source pixel covered by the destination pixel
+	struct DownsampleKernel {
+		std::array<int32_t, 4> offsets;
+		std::array<float, 4> weights;
+		uint32_t numTaps;
+	};
+	static DownsampleKernel get_downsample_kernel(pragma::image::Filter filter, bool halve)
+	{
+		if(!halve)
+			return {{0}, {1.f}, 1};
+		if(filter == pragma::image::Filter::Triangle)
+			return {{-1, 0, 1, 2}, {1 / 8.f, 3 / 8.f, 3 / 8.f, 1 / 8.f}, 4};
+		return {{0, 1}, {0.5f, 0.5f}, 2};
+	}
+
+	// Same as stbir__edge_wrap_slow, returns -1 for pixels outside of the image with EdgeAddressMode::Zero
+	static int32_t resolve_edge(int32_t n, int32_t max, pragma::image::EdgeAddressMode mode)
+	{
+		using pragma::image::EdgeAddressMode;
+		if(n >= 0 && n < max)
+			return n;
+		switch(mode) {
+		case EdgeAddressMode::Clamp:
+			return (n < 0) ? 0 : (max - 1);
+		case EdgeAddressMode::Reflect:
+			if(n < 0)
+				return std::min(-n, max - 1);
+			return (n >= max * 2) ? 0 : (max * 2 - n - 1);
+		case EdgeAddressMode::Wrap:
+			{
+				if(n >= 0)
+					return n % max;
+				auto m = (-n) % max;
+				return (m != 0) ? (max - m) : 0;
+			}
+		default:
+			return -1;
+		}
+	}
+
+	struct RowFormat {
+		// Number of channels of the decoded values, may be larger than the number of channels in memory
+		uint32_t numChannels;
+		uint32_t numStoredChannels;
+		ValueType type;
+		bool srgb;
+		bool alpha;
+		// Values are tangent space vectors, which are renormalized after filtering
+		bool normalMap;
+		// Store the length of the filtered vector in the alpha channel instead of the filtered alpha value
+		bool storeLength;
+	};
+	static std::optional<RowFormat> get_row_format(pragma::image::Format format, pragma::image::ColorSpace colorSpace)
+	{
+		using namespace pragma::image;
+		RowFormat rowFormat {};
+		rowFormat.numChannels = ImageBuffer::GetChannelCount(format);
+		rowFormat.numStoredChannels = rowFormat.numChannels;
+		switch(ImageBuffer::GetChannelSize(format)) {
+		case 1:
+			rowFormat.type = ValueType::LDR;
+			rowFormat.srgb = (colorSpace != ColorSpace::Linear);
+			break;
+		case 2:
+			rowFormat.type = ValueType::Half;
+			break;
+		case 4:
+			rowFormat.type = ValueType::Float;
+			break;
+		default:
+			return {};
+		}
+		// sRGB encoding of HDR and float values is not supported
+		if(rowFormat.type != ValueType::LDR && colorSpace == ColorSpace::SRGB)
+			return {};
+		rowFormat.alpha = (rowFormat.numChannels == 4);
+		return rowFormat;
+	}
+	static std::optional<RowFormat> get_normal_map_row_format(pragma::image::Format format, bool storeLength)
+	{
+		using namespace pragma::image;
+		auto rowFormat = get_row_format(format, ColorSpace::Linear);
+		// The z component of two-channel normal maps is reconstructed
+		if(!rowFormat || rowFormat->numChannels < 2)
+			return {};
+		// Vectors are always decoded to four channels, so the filters can use the four-channel paths
+		rowFormat->numChannels = 4;
+		rowFormat->alpha = false;
+		rowFormat->normalMap = true;
+		rowFormat->storeLength = storeLength && (rowFormat->numStoredChannels == 4);
+		return rowFormat;
+	}
+
+	struct DownsampleParams {
+		const uint8_t *src;
+		uint8_t *dst;
+		uint32_t srcWidth;
+		uint32_t srcHeight;
+		uint32_t dstWidth;
+		uint32_t dstHeight;
+		RowFormat format;
+		pragma::image::EdgeAddressMode addressMode;
+		DownsampleKernel horizontalKernel;
+		DownsampleKernel verticalKernel;
+		uint32_t horizontalFactor;
+		uint32_t verticalFactor;
+		size_t srcRowSize;
+		size_t dstRowSize;
+	};
+
+	// Number of decoded source rows kept around, the triangle kernel needs four
+	static constexpr uint32_t NUM_CACHED_ROWS = 4;
+	static size_t get_downsample_scratch_size(const DownsampleParams &params) { return (static_cast<size_t>(params.srcWidth) * (NUM_CACHED_ROWS + 1) + params.dstWidth) * params.format.numChannels * sizeof(float); }
+
+	// Scales the xyz components of the pixel to unit length and returns their original length.
+	// Vectors that have cancelled each other out are replaced with the up vector.
+	static float normalize_vector(float *px)
+	{
+#if defined(UIMG_RESAMPLE_AVX2) || defined(UIMG_RESAMPLE_SSE2)
+		auto v = _mm_loadu_ps(px);
+		auto sq = _mm_mul_ps(v, v);
+		auto dot = _mm_add_ss(_mm_add_ss(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 2, 2, 2)));
+		auto len = _mm_cvtss_f32(_mm_sqrt_ss(dot));
+		if(len > 1e-8f) {
+			auto w = px[3];
+			_mm_storeu_ps(px, _mm_mul_ps(v, _mm_set1_ps(1.f / len)));
+			px[3] = w;
+			return len;
+		}
+#else
+		auto len = std::sqrt(px[0] * px[0] + px[1] * px[1] + px[2] * px[2]);
+		if(len > 1e-8f) {
+			auto invLen = 1.f / len;
+			px[0] *= invLen;
+			px[1] *= invLen;
+			px[2] *= invLen;
+			return len;
+		}
+#endif
+		px[0] = 0.f;
+		px[1] = 0.f;
+		px[2] = 1.f;
+		return 0.f;
+	}
+
+	// LDR vectors are stored as unsigned normalized values, HDR and float vectors as signed values
+	static float decode_vector_component(const RowFormat &format, const uint8_t *px, uint32_t c)
+	{
+		float v;
+		switch(format.type) {
+		case ValueType::LDR:
+			v = px[c] / 255.f;
+			return (c < 3) ? (v * 2.f - 1.f) : v;
+		case ValueType::Half:
+			return pragma::math::float16_to_float32_glm(reinterpret_cast<const uint16_t *>(px)[c]);
+		default:
+			memcpy(&v, px + c * sizeof(float), sizeof(v));
+			return v;
+		}
+	}
+	static void decode_normal_row(const RowFormat &format, const uint8_t *row, uint32_t numPixels, float *out)
+	{
+		auto nc = format.numStoredChannels;
+		uint32_t x = 0;
+#ifdef UIMG_RESAMPLE_AVX2
+		if(format.type == ValueType::LDR && nc == 4) {
+			auto scale = _mm256_setr_ps(2 / 255.f, 2 / 255.f, 2 / 255.f, 1 / 255.f, 2 / 255.f, 2 / 255.f, 2 / 255.f, 1 / 255.f);
+			auto offset = _mm256_setr_ps(-1.f, -1.f, -1.f, 0.f, -1.f, -1.f, -1.f, 0.f);
+			for(; x + 2 <= numPixels; x += 2) {
+				auto v = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(row + x * 4))));
+				auto *px = out + x * 4;
+				_mm256_storeu_ps(px, _mm256_add_ps(_mm256_mul_ps(v, scale), offset));
+				normalize_vector(px);
+				normalize_vector(px + 4);
+			}
+		}
+#endif
+		auto pixelSize = static_cast<size_t>(nc) * ((format.type == ValueType::LDR) ? 1 : (format.type == ValueType::Half) ? 2 : 4);
+		for(; x < numPixels; ++x) {
+			auto *src = row + x * pixelSize;
+			auto *px = out + x * 4;
+			px[2] = 0.f;
+			px[3] = 1.f;
+			for(uint32_t c = 0; c < nc; ++c)
+				px[c] = decode_vector_component(format, src, c);
+			if(nc == 2)
+				px[2] = std::sqrt(std::max(1.f - px[0] * px[0] - px[1] * px[1], 0.f));
+			normalize_vector(px);
+		}
+	}
+	static void encode_normal_row(const RowFormat &format, float *in, uint32_t numPixels, uint8_t *row)
+	{
+		for(uint32_t x = 0; x < numPixels; ++x) {
+			auto *px = in + x * 4;
+			auto len = normalize_vector(px);
+			if(format.storeLength)
+				px[3] = pragma::math::clamp(len, 0.f, 1.f);
+		}
+		auto nc = format.numStoredChannels;
+		switch(format.type) {
+		case ValueType::LDR:
+			{
+				uint32_t x = 0;
+#ifdef UIMG_RESAMPLE_AVX2
+				if(nc == 4) {
+					auto scale = _mm256_setr_ps(127.5f, 127.5f, 127.5f, 255.f, 127.5f, 127.5f, 127.5f, 255.f);
+					auto offset = _mm256_setr_ps(128.f, 128.f, 128.f, 0.5f, 128.f, 128.f, 128.f, 0.5f);
+					auto vZero = _mm256_setzero_ps();
+					auto vMax = _mm256_set1_ps(255.f);
+					for(; x + 2 <= numPixels; x += 2) {
+						auto v = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(in + x * 4), scale), offset);
+						auto result = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(v, vZero), vMax));
+						auto packed = _mm_packus_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+						_mm_storel_epi64(reinterpret_cast<__m128i *>(row + x * 4), _mm_packus_epi16(packed, packed));
+					}
+				}
+#endif
+				for(; x < numPixels; ++x) {
+					for(uint32_t c = 0; c < nc; ++c) {
+						auto v = in[x * 4 + c];
+						row[x * nc + c] = encode_linear((c < 3) ? (v * 0.5f + 0.5f) : v);
+					}
+				}
+				break;
+			}
+		case ValueType::Half:
+			{
+				auto *values = reinterpret_cast<uint16_t *>(row);
+				for(uint32_t x = 0; x < numPixels; ++x) {
+					for(uint32_t c = 0; c < nc; ++c)
+						values[x * nc + c] = pragma::math::float32_to_float16_glm(in[x * 4 + c]);
+				}
+				break;
+			}
+		case ValueType::Float:
+			{
+				auto *values = reinterpret_cast<float *>(row);
+				for(uint32_t x = 0; x < numPixels; ++x)
+					memcpy(values + x * nc, in + x * 4, nc * sizeof(float));
+				break;
+			}
+		}
+	}
+
+	static void decode_row(const RowFormat &format, const Tables &tables, const uint8_t *row, uint32_t numPixels, float *out)
+	{
+		if(format.normalMap) {
+			decode_normal_row(format, row, numPixels, out);
+			return;
+		}
+		size_t n = static_cast<size_t>(numPixels) * format.numChannels;
+		size_t i = 0;
+		switch(format.type) {
+		case ValueType::LDR:
+			{
+				// Table offset per value, alpha is always decoded linearly
+				alignas(32) std::array<int32_t, 8> offsets;
+				for(uint32_t j = 0; j < offsets.size(); ++j)
+					offsets[j] = (!format.srgb || (format.alpha && (j % 4) == 3)) ? 256 : 0;
+#ifdef UIMG_RESAMPLE_AVX2
+				auto vOffsets = _mm256_load_si256(reinterpret_cast<const __m256i *>(offsets.data()));
+				for(; i + 8 <= n; i += 8) {
+					auto idx = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(row + i))), vOffsets);
+					_mm256_storeu_ps(out + i, _mm256_i32gather_ps(tables.decode.data(), idx, 4));
+				}
+#endif
+				for(; i < n; ++i)
+					out[i] = tables.decode[row[i] + offsets[i % offsets.size()]];
+				break;
+			}
+		case ValueType::Half:
+			{
+				auto *values = reinterpret_cast<const uint16_t *>(row);
+#if defined(UIMG_RESAMPLE_AVX2) && defined(__F16C__)
+				for(; i + 8 <= n; i += 8)
+					_mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i))));
+#endif
+				for(; i < n; ++i)
+					out[i] = pragma::math::float16_to_float32_glm(values[i]);
+				break;
+			}
+		case ValueType::Float:
+			memcpy(out, row, n * sizeof(float));
+			break;
+		}
+		if(format.alpha) {
+			for(size_t p = 0; p < n; p += 4) {
+				auto a = out[p + 3];
+				out[p] *= a;
+				out[p + 1] *= a;
+				out[p + 2] *= a;
+			}
+		}
+	}
+
+	// out = sum(rows[k] * weights[k])
+	static void accumulate_rows(float *out, const float *const *rows, const float *weights, uint32_t numRows, size_t n)
+	{
+		size_t i = 0;
+#if defined(UIMG_RESAMPLE_AVX2)
+		for(; i + 8 <= n; i += 8) {
+			auto acc = _mm256_mul_ps(_mm256_loadu_ps(rows[0] + i), _mm256_set1_ps(weights[0]));
+			for(uint32_t k = 1; k < numRows; ++k)
+				acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(rows[k] + i), _mm256_set1_ps(weights[k])));
+			_mm256_storeu_ps(out + i, acc);
+		}
+#elif defined(UIMG_RESAMPLE_SSE2)
+		for(; i + 4 <= n; i += 4) {
+			auto acc = _mm_mul_ps(_mm_loadu_ps(rows[0] + i), _mm_set1_ps(weights[0]));
+			for(uint32_t k = 1; k < numRows; ++k)
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(rows[k] + i), _mm_set1_ps(weights[k])));
+			_mm_storeu_ps(out + i, acc);
+		}
+#endif
+		for(; i < n; ++i) {
+			auto acc = rows[0][i] * weights[0];
+			for(uint32_t k = 1; k < numRows; ++k)
+				acc += rows[k][i] * weights[k];
+			out[i] = acc;
+		}
+	}
+
+	static void downsample_row_horizontally(const DownsampleParams &params, const float *in, float *out)
+	{
+		auto &kernel = params.horizontalKernel;
+		auto nc = params.format.numChannels;
+		auto srcWidth = static_cast<int32_t>(params.srcWidth);
+		for(uint32_t x = 0; x < params.dstWidth; ++x) {
+			auto sx0 = static_cast<int32_t>(x * params.horizontalFactor);
+			std::array<int32_t, 4> taps;
+			for(uint32_t k = 0; k < kernel.numTaps; ++k)
+				taps[k] = resolve_edge(sx0 + kernel.offsets[k], srcWidth, params.addressMode);
+			auto *px = out + x * nc;
+#if defined(UIMG_RESAMPLE_AVX2) || defined(UIMG_RESAMPLE_SSE2)
+			if(nc == 4) {
+				auto acc = _mm_setzero_ps();
+				for(uint32_t k = 0; k < kernel.numTaps; ++k) {
+					if(taps[k] != -1)
+						acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(in + taps[k] * 4), _mm_set1_ps(kernel.weights[k])));
+				}
+				_mm_storeu_ps(px, acc);
+				continue;
+			}
+#endif
+			for(uint32_t c = 0; c < nc; ++c) {
+				float acc = 0.f;
+				for(uint32_t k = 0; k < kernel.numTaps; ++k) {
+					if(taps[k] != -1)
+						acc += in[taps[k] * nc + c] * kernel.weights[k];
+				}
+				px[c] = acc;
+			}
+		}
+	}
+
+	static void encode_row(const RowFormat &format, const Tables &tables, float *in, uint32_t numPixels, uint8_t *row)
+	{
+		if(format.normalMap) {
+			encode_normal_row(format, in, numPixels, row);
+			return;
+		}
+		size_t n = static_cast<size_t>(numPixels) * format.numChannels;
+		if(format.alpha) {
+			for(size_t p = 0; p < n; p += 4) {
+				auto a = in[p + 3];
+				if(a <= 0.f)
+					continue;
+				auto invA = 1.f / a;
+				in[p] *= invA;
+				in[p + 1] *= invA;
+				in[p + 2] *= invA;
+			}
+		}
+		size_t i = 0;
+		switch(format.type) {
+		case ValueType::LDR:
+			{
+				alignas(32) std::array<int32_t, 8> linearMask;
+				for(uint32_t j = 0; j < linearMask.size(); ++j)
+					linearMask[j] = (!format.srgb || (format.alpha && (j % 4) == 3)) ? -1 : 0;
+#ifdef UIMG_RESAMPLE_AVX2
+				auto vLinearMask = _mm256_load_si256(reinterpret_cast<const __m256i *>(linearMask.data()));
+				auto vZero = _mm256_setzero_ps();
+				auto vOne = _mm256_set1_ps(1.f);
+				auto vMaxIdx = _mm256_set1_epi32(static_cast<int32_t>(tables.encodeBase.size() - 1));
+				for(; i + 8 <= n; i += 8) {
+					auto v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i), vZero), vOne);
+					auto idx = _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(v, _mm256_set1_ps(static_cast<float>(tables.encodeBase.size())))), vMaxIdx);
+					auto base = _mm256_i32gather_epi32(tables.encodeBase.data(), idx, 4);
+					auto threshold = _mm256_i32gather_ps(tables.encodeThresholds.data() + 1, base, 4);
+					auto srgb = _mm256_sub_epi32(base, _mm256_castps_si256(_mm256_cmp_ps(v, threshold, _CMP_GE_OQ)));
+					auto linear = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(255.f)), _mm256_set1_ps(0.5f)));
+					auto result = _mm256_blendv_epi8(srgb, linear, vLinearMask);
+					auto packed = _mm_packus_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+					_mm_storel_epi64(reinterpret_cast<__m128i *>(row + i), _mm_packus_epi16(packed, packed));
+				}
+#endif
+				for(; i < n; ++i)
+					row[i] = linearMask[i % linearMask.size()] ? encode_linear(in[i]) : pragma::image::linear_to_srgb8(in[i]);
+				break;
+			}
+		case ValueType::Half:
+			{
+				auto *values = reinterpret_cast<uint16_t *>(row);
+#if defined(UIMG_RESAMPLE_AVX2) && defined(__F16C__)
+				for(; i + 8 <= n; i += 8)
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(values + i), _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+				for(; i < n; ++i)
+					values[i] = pragma::math::float32_to_float16_glm(in[i]);
+				break;
+			}
+		case ValueType::Float:
+			memcpy(row, in, n * sizeof(float));
+			break;
+		}
+	}
+
+	static void process_rows_2x2(const DownsampleParams &params, uint32_t yStart, uint32_t yEnd, void *scratch)
+	{
+		auto &tables = get_tables();
+		auto rowSize = static_cast<size_t>(params.srcWidth) * params.format.numChannels;
+		auto *cache = static_cast<float *>(scratch);
+		auto *accumulated = cache + rowSize * NUM_CACHED_ROWS;
+		auto *filtered = accumulated + rowSize;
+		std::array<int32_t, NUM_CACHED_ROWS> cachedRows;
+		cachedRows.fill(-1);
+
+		auto &kernel = params.verticalKernel;
+		auto srcHeight = static_cast<int32_t>(params.srcHeight);
+		for(auto y = yStart; y < yEnd; ++y) {
+			std::array<const float *, NUM_CACHED_ROWS> rows;
+			std::array<float, NUM_CACHED_ROWS> weights;
+			uint32_t numRows = 0;
+			auto sy0 = static_cast<int32_t>(y * params.verticalFactor);
+			for(uint32_t k = 0; k < kernel.numTaps; ++k) {
+				auto sy = resolve_edge(sy0 + kernel.offsets[k], srcHeight, params.addressMode);
+				if(sy == -1)
+					continue;
+				// Consecutive destination rows share half of their source rows
+				auto slot = static_cast<uint32_t>(sy0 + kernel.offsets[k] + NUM_CACHED_ROWS) % NUM_CACHED_ROWS;
+				auto *cached = cache + slot * rowSize;
+				if(cachedRows[slot] != sy) {
+					decode_row(params.format, tables, params.src + sy * params.srcRowSize, params.srcWidth, cached);
+					cachedRows[slot] = sy;
+				}
+				rows[numRows] = cached;
+				weights[numRows] = kernel.weights[k];
+				++numRows;
+			}
+			if(numRows == 0)
+				std::fill(accumulated, accumulated + rowSize, 0.f);
+			else
+				accumulate_rows(accumulated, rows.data(), weights.data(), numRows, rowSize);
+			downsample_row_horizontally(params, accumulated, filtered);
+			encode_row(params.format, tables, filtered, params.dstWidth, params.dst + y * params.dstRowSize);
+		}
+	}
+
+	// Separable polyphase resampling for arbitrary sizes. Every source row is filtered horizontally once (per band) and cached,
+	// destination rows are then combined from the cached rows.
+	static double sinc(double x)
+	{
+		if(std::abs(x) < 1e-6)
+			return 1.0;
+		x *= std::numbers::pi;
+		return std::sin(x) / x;
+	}
+	// Modified Bessel function of the first kind of order zero
+	static double bessel0(double x)
+	{
+		auto sum = 1.0;
+		auto term = 1.0;
+		auto halfX = x * 0.5;
+		for(uint32_t k = 1; k < 64; ++k) {
+			term *= halfX / k;
+			auto t = term * term;
+			sum += t;
+			if(t < sum * 1e-12)
+				break;
+		}
+		return sum;
+	}
+	// Mitchell-Netravali cubic filters
+	static double evaluate_cubic(double x, double b, double c)
+	{
+		x = std::abs(x);
+		if(x < 1.0)
+			return ((12.0 - 9.0 * b - 6.0 * c) * x * x * x + (-18.0 + 12.0 * b + 6.0 * c) * x * x + (6.0 - 2.0 * b)) / 6.0;
+		if(x < 2.0)
+			return ((-b - 6.0 * c) * x * x * x + (6.0 * b + 30.0 * c) * x * x + (-12.0 * b - 48.0 * c) * x + (8.0 * b + 24.0 * c)) / 6.0;
+		return 0.0;
+	}
+	static double get_filter_support(pragma::image::ResampleFilter filter)
+	{
+		using pragma::image::ResampleFilter;
+		switch(filter) {
+		case ResampleFilter::Box:
+			return 0.5;
+		case ResampleFilter::Triangle:
+			return 1.0;
+		case ResampleFilter::Lanczos2:
+		case ResampleFilter::CubicBSpline:
+		case ResampleFilter::CatmullRom:
+		case ResampleFilter::Mitchell:
+			return 2.0;
+		default:
+			return 3.0;
+		}
+	}
+	static double evaluate_filter(pragma::image::ResampleFilter filter, double x)
+	{
+		using pragma::image::ResampleFilter;
+		switch(filter) {
+		case ResampleFilter::Box:
+			return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0;
+		case ResampleFilter::Kaiser:
+			{
+				// Same parameters as the Kaiser mipmap filter of nvtt (width 3, alpha 4)
+				constexpr double width = 3.0;
+				constexpr double alpha = 4.0;
+				auto t = x / width;
+				if(t * t > 1.0)
+					return 0.0;
+				return sinc(x) * bessel0(alpha * std::sqrt(1.0 - t * t)) / bessel0(alpha);
+			}
+		case ResampleFilter::Lanczos3:
+			return (std::abs(x) < 3.0) ? (sinc(x) * sinc(x / 3.0)) : 0.0;
+		case ResampleFilter::Lanczos2:
+			return (std::abs(x) < 2.0) ? (sinc(x) * sinc(x / 2.0)) : 0.0;
+		case ResampleFilter::Triangle:
+			return std::max(1.0 - std::abs(x), 0.0);
+		case ResampleFilter::CubicBSpline:
+			return evaluate_cubic(x, 1.0, 0.0);
+		case ResampleFilter::CatmullRom:
+			return evaluate_cubic(x, 0.0, 0.5);
+		case ResampleFilter::Mitchell:
+			return evaluate_cubic(x, 1.0 / 3.0, 1.0 / 3.0);
+		default:
+			return 0.0;
+		}
+	}
+	static_assert(pragma::math::to_integral(pragma::image::ResampleFilter::Count) == 8);
+
+	// Filter taps of every destination pixel along one axis. Taps outside of the image have already been resolved
+	// according to the edge mode, and are -1 if they don't contribute (EdgeAddressMode::Zero).
+	struct AxisWeights {
+		uint32_t maxTaps = 0;
+		// Unresolved source index of the first tap of every destination pixel
+		std::vector<int32_t> firstTaps;
+		std::vector<int32_t> indices;
+		std::vector<float> weights;
+	};
+	static AxisWeights calculate_axis_weights(uint32_t srcSize, uint32_t dstSize, pragma::image::ResampleFilter filter, pragma::image::EdgeAddressMode addressMode)
+	{
+		AxisWeights axis {};
+		auto scale = static_cast<double>(srcSize) / dstSize;
+		// When downsampling, the filter is stretched to cover all source pixels
+		auto filterScale = std::max(scale, 1.0);
+		auto radius = get_filter_support(filter) * filterScale;
+		axis.maxTaps = static_cast<uint32_t>(std::ceil(radius * 2.0)) + 1;
+		axis.firstTaps.resize(dstSize);
+		axis.indices.resize(static_cast<size_t>(dstSize) * axis.maxTaps, -1);
+		axis.weights.resize(static_cast<size_t>(dstSize) * axis.maxTaps, 0.f);
+		std::vector<double> weights(axis.maxTaps);
+		for(uint32_t o = 0; o < dstSize; ++o) {
+			auto center = (o + 0.5) * scale;
+			auto first = static_cast<int32_t>(std::ceil(center - radius - 0.5));
+			auto last = std::min(static_cast<int32_t>(std::floor(center + radius - 0.5)), first + static_cast<int32_t>(axis.maxTaps) - 1);
+			auto total = 0.0;
+			for(auto i = first; i <= last; ++i) {
+				auto w = evaluate_filter(filter, (i + 0.5 - center) / filterScale);
+				weights[i - first] = w;
+				total += w;
+			}
+			axis.firstTaps[o] = first;
+			auto *indices = axis.indices.data() + static_cast<size_t>(o) * axis.maxTaps;
+			auto *outWeights = axis.weights.data() + static_cast<size_t>(o) * axis.maxTaps;
+			for(auto i = first; i <= last; ++i) {
+				if(weights[i - first] == 0.0)
+					continue;
+				indices[i - first] = resolve_edge(i, static_cast<int32_t>(srcSize), addressMode);
+				outWeights[i - first] = static_cast<float>(weights[i - first] / total);
+			}
+		}
+		return axis;
+	}
+
+	struct ResampleParams {
+		uint32_t srcWidth;
+		uint32_t srcHeight;
+		uint32_t dstWidth;
+		uint32_t dstHeight;
+		RowFormat format;
+		AxisWeights horizontal;
+		AxisWeights vertical;
+		size_t srcRowSize;
+		size_t dstRowSize;
+		// Filter the source rows vertically first and only filter the result horizontally,
+		// otherwise every source row is filtered horizontally and the results are combined vertically
+		bool verticalFirst;
+	};
+	// Picks the filter order with fewer multiply-adds. Both orders decode the same source rows.
+	static bool should_filter_vertically_first(const ResampleParams &params)
+	{
+		auto numSrcRows = std::min(static_cast<uint64_t>(params.srcHeight), static_cast<uint64_t>(params.dstHeight) * params.vertical.maxTaps);
+		auto costHorizontalFirst = numSrcRows * params.dstWidth * params.horizontal.maxTaps + static_cast<uint64_t>(params.dstHeight) * params.dstWidth * params.vertical.maxTaps;
+		auto costVerticalFirst = static_cast<uint64_t>(params.dstHeight) * params.srcWidth * params.vertical.maxTaps + static_cast<uint64_t>(params.dstHeight) * params.dstWidth * params.horizontal.maxTaps;
+		return costVerticalFirst < costHorizontalFirst;
+	}
+	static size_t get_resample_scratch_size(const ResampleParams &params)
+	{
+		auto nc = params.format.numChannels;
+		size_t numFloats;
+		if(params.verticalFirst) {
+			// Cached decoded rows, the accumulated row and the horizontally filtered row
+			numFloats = static_cast<size_t>(params.srcWidth) * nc * (params.vertical.maxTaps + 1) + static_cast<size_t>(params.dstWidth) * nc;
+		}
+		else {
+			// Decoded source row, cached horizontally filtered rows and the accumulated row
+			numFloats = static_cast<size_t>(params.srcWidth) * nc + static_cast<size_t>(params.dstWidth) * nc * (params.vertical.maxTaps + 1);
+		}
+		return numFloats * sizeof(float) + params.vertical.maxTaps * (sizeof(int32_t) + sizeof(const float *) + sizeof(float));
+	}
+
+	// Taps with a weight of zero may have an index of -1, so they're redirected to the first pixel
+	static int32_t get_tap_index(int32_t idx) { return (idx == -1) ? 0 : idx; }
+	static void resample_row_horizontally(const AxisWeights &axis, uint32_t numChannels, const float *in, float *out, uint32_t dstWidth)
+	{
+		uint32_t x = 0;
+#ifdef UIMG_RESAMPLE_AVX2
+		if(numChannels == 4) {
+			// Two destination pixels per iteration
+			for(; x + 2 <= dstWidth; x += 2) {
+				auto *indices0 = axis.indices.data() + static_cast<size_t>(x) * axis.maxTaps;
+				auto *indices1 = indices0 + axis.maxTaps;
+				auto *weights0 = axis.weights.data() + static_cast<size_t>(x) * axis.maxTaps;
+				auto *weights1 = weights0 + axis.maxTaps;
+				auto acc = _mm256_setzero_ps();
+				for(uint32_t k = 0; k < axis.maxTaps; ++k) {
+					auto v = _mm256_loadu2_m128(in + get_tap_index(indices1[k]) * 4, in + get_tap_index(indices0[k]) * 4);
+					auto w = _mm256_setr_m128(_mm_set1_ps(weights0[k]), _mm_set1_ps(weights1[k]));
+					acc = _mm256_add_ps(acc, _mm256_mul_ps(v, w));
+				}
+				_mm256_storeu_ps(out + static_cast<size_t>(x) * 4, acc);
+			}
+		}
+		else if(numChannels == 1) {
+			// Eight destination pixels per iteration, the taps are gathered
+			auto vStride = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(static_cast<int32_t>(axis.maxTaps)));
+			auto vZero = _mm256_setzero_si256();
+			for(; x + 8 <= dstWidth; x += 8) {
+				auto *indices = axis.indices.data() + static_cast<size_t>(x) * axis.maxTaps;
+				auto *weights = axis.weights.data() + static_cast<size_t>(x) * axis.maxTaps;
+				auto acc = _mm256_setzero_ps();
+				for(uint32_t k = 0; k < axis.maxTaps; ++k) {
+					auto idx = _mm256_max_epi32(_mm256_i32gather_epi32(indices + k, vStride, 4), vZero);
+					auto w = _mm256_i32gather_ps(weights + k, vStride, 4);
+					acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_i32gather_ps(in, idx, 4), w));
+				}
+				_mm256_storeu_ps(out + x, acc);
+			}
+		}
+#endif
+		for(; x < dstWidth; ++x) {
+			auto *indices = axis.indices.data() + static_cast<size_t>(x) * axis.maxTaps;
+			auto *weights = axis.weights.data() + static_cast<size_t>(x) * axis.maxTaps;
+			auto *px = out + static_cast<size_t>(x) * numChannels;
+#if defined(UIMG_RESAMPLE_AVX2) || defined(UIMG_RESAMPLE_SSE2)
+			if(numChannels == 4) {
+				auto acc = _mm_setzero_ps();
+				for(uint32_t k = 0; k < axis.maxTaps; ++k)
+					acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(in + get_tap_index(indices[k]) * 4), _mm_set1_ps(weights[k])));
+				_mm_storeu_ps(px, acc);
+				continue;
+			}
+#endif
+			for(uint32_t c = 0; c < numChannels; ++c) {
+				float acc = 0.f;
+				for(uint32_t k = 0; k < axis.maxTaps; ++k) {
+					if(indices[k] != -1)
+						acc += in[indices[k] * numChannels + c] * weights[k];
+				}
+				px[c] = acc;
+			}
+		}
+	}
+
+	// The taps of consecutive destination rows overlap, so the rows they read are kept in a ring buffer
+	static uint32_t get_cache_slot(const AxisWeights &vertical, uint32_t y, uint32_t k)
+	{
+		auto numSlots = static_cast<int32_t>(vertical.maxTaps);
+		return static_cast<uint32_t>(((vertical.firstTaps[y] + static_cast<int32_t>(k)) % numSlots + numSlots) % numSlots);
+	}
+
+	static void resample_rows_horizontal_first(const ResampleParams &params, const uint8_t *src, uint8_t *dst, uint32_t yStart, uint32_t yEnd, void *scratch)
+	{
+		auto &tables = get_tables();
+		auto nc = params.format.numChannels;
+		auto &vertical = params.vertical;
+		auto numCachedRows = vertical.maxTaps;
+		auto dstRowSize = static_cast<size_t>(params.dstWidth) * nc;
+		auto *decoded = static_cast<float *>(scratch);
+		auto *cache = decoded + static_cast<size_t>(params.srcWidth) * nc;
+		auto *accumulated = cache + dstRowSize * numCachedRows;
+		auto *rows = reinterpret_cast<const float **>(accumulated + dstRowSize);
+		auto *weights = reinterpret_cast<float *>(rows + numCachedRows);
+		auto *cachedRows = reinterpret_cast<int32_t *>(weights + numCachedRows);
+		std::fill(cachedRows, cachedRows + numCachedRows, -1);
+
+		for(auto y = yStart; y < yEnd; ++y) {
+			auto *indices = vertical.indices.data() + static_cast<size_t>(y) * vertical.maxTaps;
+			auto *tapWeights = vertical.weights.data() + static_cast<size_t>(y) * vertical.maxTaps;
+			uint32_t numRows = 0;
+			for(uint32_t k = 0; k < vertical.maxTaps; ++k) {
+				auto sy = indices[k];
+				if(sy == -1)
+					continue;
+				auto slot = get_cache_slot(vertical, y, k);
+				auto *cached = cache + slot * dstRowSize;
+				if(cachedRows[slot] != sy) {
+					decode_row(params.format, tables, src + sy * params.srcRowSize, params.srcWidth, decoded);
+					resample_row_horizontally(params.horizontal, nc, decoded, cached, params.dstWidth);
+					cachedRows[slot] = sy;
+				}
+				rows[numRows] = cached;
+				weights[numRows] = tapWeights[k];
+				++numRows;
+			}
+			if(numRows == 0)
+				std::fill(accumulated, accumulated + dstRowSize, 0.f);
+			else
+				accumulate_rows(accumulated, rows, weights, numRows, dstRowSize);
+			encode_row(params.format, tables, accumulated, params.dstWidth, dst + y * params.dstRowSize);
+		}
+	}
+
+	static void resample_rows_vertical_first(const ResampleParams &params, const uint8_t *src, uint8_t *dst, uint32_t yStart, uint32_t yEnd, void *scratch)
+	{
+		auto &tables = get_tables();
+		auto nc = params.format.numChannels;
+		auto &vertical = params.vertical;
+		auto numCachedRows = vertical.maxTaps;
+		auto srcRowSize = static_cast<size_t>(params.srcWidth) * nc;
+		auto *cache = static_cast<float *>(scratch);
+		auto *accumulated = cache + srcRowSize * numCachedRows;
+		auto *filtered = accumulated + srcRowSize;
+		auto *rows = reinterpret_cast<const float **>(filtered + static_cast<size_t>(params.dstWidth) * nc);
+		auto *weights = reinterpret_cast<float *>(rows + numCachedRows);
+		auto *cachedRows = reinterpret_cast<int32_t *>(weights + numCachedRows);
+		std::fill(cachedRows, cachedRows + numCachedRows, -1);
+
+		for(auto y = yStart; y < yEnd; ++y) {
+			auto *indices = vertical.indices.data() + static_cast<size_t>(y) * vertical.maxTaps;
+			auto *tapWeights = vertical.weights.data() + static_cast<size_t>(y) * vertical.maxTaps;
+			uint32_t numRows = 0;
+			for(uint32_t k = 0; k < vertical.maxTaps; ++k) {
+				auto sy = indices[k];
+				if(sy == -1)
+					continue;
+				auto slot = get_cache_slot(vertical, y, k);
+				auto *cached = cache + slot * srcRowSize;
+				if(cachedRows[slot] != sy) {
+					decode_row(params.format, tables, src + sy * params.srcRowSize, params.srcWidth, cached);
+					cachedRows[slot] = sy;
+				}
+				rows[numRows] = cached;
+				weights[numRows] = tapWeights[k];
+				++numRows;
+			}
+			if(numRows == 0)
+				std::fill(accumulated, accumulated + srcRowSize, 0.f);
+			else
+				accumulate_rows(accumulated, rows, weights, numRows, srcRowSize);
+			resample_row_horizontally(params.horizontal, nc, accumulated, filtered, params.dstWidth);
+			encode_row(params.format, tables, filtered, params.dstWidth, dst + y * params.dstRowSize);
+		}
+	}
+};
+
+struct pragma::image::ResamplePlan::Data {
+	resample::ResampleParams params;
+};
+
+std::unique_ptr<pragma::image::ResamplePlan> pragma::image::ResamplePlan::Create(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, Format format, ResampleFilter filter, EdgeAddressMode addressMode, ColorSpace colorSpace)
+{
+	return Create(srcWidth, srcHeight, dstWidth, dstHeight, format, filter, filter, addressMode, colorSpace);
+}
+
+std::unique_ptr<pragma::image::ResamplePlan> pragma::image::ResamplePlan::Create(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, Format format, ResampleFilter horizontalFilter, ResampleFilter verticalFilter, EdgeAddressMode addressMode,
+  ColorSpace colorSpace)
+{
+	if(srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0 || horizontalFilter >= ResampleFilter::Count || verticalFilter >= ResampleFilter::Count)
+		return nullptr;
+	auto rowFormat = resample::get_row_format(format, colorSpace);
+	if(!rowFormat)
+		return nullptr;
+	auto plan = std::unique_ptr<ResamplePlan> {new ResamplePlan {}};
+	plan->m_data = std::make_unique<Data>();
+	plan->m_data->params.format = *rowFormat;
+	plan->Initialize(srcWidth, srcHeight, dstWidth, dstHeight, format, horizontalFilter, verticalFilter, addressMode);
+	return plan;
+}
+
+std::unique_ptr<pragma::image::ResamplePlan> pragma::image::ResamplePlan::CreateNormalMap(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, Format format, ResampleFilter filter, EdgeAddressMode addressMode, bool storeLengthInAlpha)
+{
+	if(srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0 || filter >= ResampleFilter::Count)
+		return nullptr;
+	auto rowFormat = resample::get_normal_map_row_format(format, storeLengthInAlpha);
+	if(!rowFormat)
+		return nullptr;
+	auto plan = std::unique_ptr<ResamplePlan> {new ResamplePlan {}};
+	plan->m_data = std::make_unique<Data>();
+	plan->m_data->params.format = *rowFormat;
+	plan->Initialize(srcWidth, srcHeight, dstWidth, dstHeight, format, filter, filter, addressMode);
+	return plan;
+}
+
+void pragma::image::ResamplePlan::Initialize(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, Format format, ResampleFilter horizontalFilter, ResampleFilter verticalFilter, EdgeAddressMode addressMode)
+{
+	auto &params = m_data->params;
+	params.srcWidth = srcWidth;
+	params.srcHeight = srcHeight;
+	params.dstWidth = dstWidth;
+	params.dstHeight = dstHeight;
+	params.horizontal = resample::calculate_axis_weights(srcWidth, dstWidth, horizontalFilter, addressMode);
+	params.vertical = resample::calculate_axis_weights(srcHeight, dstHeight, verticalFilter, addressMode);
+	params.srcRowSize = srcWidth * ImageBuffer::GetPixelSize(format);
+	params.dstRowSize = dstWidth * ImageBuffer::GetPixelSize(format);
+	params.verticalFirst = resample::should_filter_vertically_first(params);
+	m_dstHeight = dstHeight;
+	m_scratchSize = resample::get_resample_scratch_size(params);
+}
+
+pragma::image::ResamplePlan::ResamplePlan() {}
+pragma::image::ResamplePlan::~ResamplePlan() {}
+
+size_t pragma::image::ResamplePlan::GetScratchSize() const { return m_scratchSize; }
+
+void pragma::image::ResamplePlan::ExecuteRows(const void *src, void *dst, uint32_t yStart, uint32_t yEnd, void *scratch) const
+{
+	auto &params = m_data->params;
+	if(params.verticalFirst)
+		resample::resample_rows_vertical_first(params, static_cast<const uint8_t *>(src), static_cast<uint8_t *>(dst), yStart, yEnd, scratch);
+	else
+		resample::resample_rows_horizontal_first(params, static_cast<const uint8_t *>(src), static_cast<uint8_t *>(dst), yStart, yEnd, scratch);
+}
+
+void pragma::image::ResamplePlan::Execute(const void *src, void *dst) const
+{
+	constexpr uint32_t minRowsPerBand = 16;
+	auto numThreads = ThreadPool::Get().GetThreadCount();
+	auto rowsPerBand = std::max((m_dstHeight + numThreads * 4 - 1) / (numThreads * 4), minRowsPerBand);
+	auto numBands = (m_dstHeight + rowsPerBand - 1) / rowsPerBand;
+	parallel_for(numBands, [&](uint32_t band) {
+		auto yStart = band * rowsPerBand;
+		auto yEnd = std::min(yStart + rowsPerBand, m_dstHeight);
+		std::unique_ptr<uint8_t[]> scratch {new uint8_t[m_scratchSize]};
+		ExecuteRows(src, dst, yStart, yEnd, scratch.get());
+	});
+}
+
+bool pragma::image::can_downsample_2x2(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, Format format, Filter filter, ColorSpace colorSpace)
+{
+	if(filter != Filter::Box && filter != Filter::Triangle)
+		return false;
+	auto isValidAxis = [](uint32_t src, uint32_t dst) { return src == dst * 2 || (src == 1 && dst == 1); };
+	if(!isValidAxis(srcWidth, dstWidth) || !isValidAxis(srcHeight, dstHeight) || (srcWidth == dstWidth && srcHeight == dstHeight))
+		return false;
+	return resample::get_row_format(format, colorSpace).has_value();
+}
+
+bool pragma::image::downsample_2x2(const void *src, uint32_t srcWidth, uint32_t srcHeight, void *dst, uint32_t dstWidth, uint32_t dstHeight, Format format, Filter filter, EdgeAddressMode addressMode, ColorSpace colorSpace, ResizeScratch *scratch)
+{
+	if(!can_downsample_2x2(srcWidth, srcHeight, dstWidth, dstHeight, format, filter, colorSpace))
+		return false;
+	resample::DownsampleParams params {};
+	params.src = static_cast<const uint8_t *>(src);
+	params.dst = static_cast<uint8_t *>(dst);
+	params.srcWidth = srcWidth;
+	params.srcHeight = srcHeight;
+	params.dstWidth = dstWidth;
+	params.dstHeight = dstHeight;
+	params.format = *resample::get_row_format(format, colorSpace);
+	params.addressMode = addressMode;
+	params.horizontalFactor = srcWidth / dstWidth;
+	params.verticalFactor = srcHeight / dstHeight;
+	params.horizontalKernel = resample::get_downsample_kernel(filter, params.horizontalFactor == 2);
+	params.verticalKernel = resample::get_downsample_kernel(filter, params.verticalFactor == 2);
+	params.srcRowSize = srcWidth * ImageBuffer::GetPixelSize(format);
+	params.dstRowSize = dstWidth * ImageBuffer::GetPixelSize(format);
+
+	auto scratchSize = resample::get_downsample_scratch_size(params);
+	if(scratch) {
+		scratch->Reset();
+		resample::process_rows_2x2(params, 0, dstHeight, scratch->Allocate(scratchSize));
+		scratch->Reset();
+		return true;
+	}
+	constexpr uint32_t minRowsPerBand = 16;
+	auto numThreads = ThreadPool::Get().GetThreadCount();
+	auto rowsPerBand = std::max((dstHeight + numThreads * 4 - 1) / (numThreads * 4), minRowsPerBand);
+	auto numBands = (dstHeight + rowsPerBand - 1) / rowsPerBand;
+	parallel_for(numBands, [&](uint32_t band) {
+		auto yStart = band * rowsPerBand;
+		auto yEnd = std::min(yStart + rowsPerBand, dstHeight);
+		std::unique_ptr<uint8_t[]> bandScratch {new uint8_t[scratchSize]};
+		resample::process_rows_2x2(params, yStart, yEnd, bandScratch.get());
+	});
+	return true;
+}
+
+bool pragma::image::resample(const void *src, uint32_t srcWidth, uint32_t srcHeight, void *dst, uint32_t dstWidth, uint32_t dstHeight, Format format, ResampleFilter filter, EdgeAddressMode addressMode, ColorSpace colorSpace)
+{
+	auto plan = ResamplePlan::Create(srcWidth, srcHeight, dstWidth, dstHeight, format, filter, addressMode, colorSpace);
+	if(!plan)
+		return false;
+	plan->Execute(src, dst);
+	return true;
+}
+
+bool pragma::image::resample_normal_map(const void *src, uint32_t srcWidth, uint32_t srcHeight, void *dst, uint32_t dstWidth, uint32_t dstHeight, Format format, ResampleFilter filter, EdgeAddressMode addressMode, bool storeLengthInAlpha)
+{
+	auto plan = ResamplePlan::CreateNormalMap(srcWidth, srcHeight, dstWidth, dstHeight, format, filter, addressMode, storeLengthInAlpha);
+	if(!plan)
+		return false;
+	plan->Execute(src, dst);
+	return true;
+}
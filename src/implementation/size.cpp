@@ -18,6 +18,7 @@ import pragma.filesystem;
 
 namespace pragma::image {
 	bool read_ktx_size(fs::VFilePtr &f, uint32_t &pixelWidth, uint32_t &pixelHeight);
+	bool read_ktx2_size(fs::VFilePtr &f, uint32_t &pixelWidth, uint32_t &pixelHeight);
 	bool read_dds_size(fs::VFilePtr &f, uint32_t &pixelWidth, uint32_t &pixelHeight);
 	bool read_png_size(fs::VFilePtr &f, uint32_t &pixelWidth, uint32_t &pixelHeight);
 	bool read_vtf_size(fs::VFilePtr &f, uint32_t &pixelWidth, uint32_t &pixelHeight);
@@ -40,6 +41,20 @@ bool pragma::image::read_ktx_size(fs::VFilePtr &f, uint32_t &pixelWidth, uint32_
 	return true;
 }
 
+bool pragma::image::read_ktx2_size(fs::VFilePtr &f, uint32_t &pixelWidth, uint32_t &pixelHeight)
+{
+	// See https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html#_file_structure
+	std::array<char, 12> identifier;
+	f->Read(identifier.data(), identifier.size());
+	const std::array<char, 12> cmpIdentifier = {'\xAB', 'K', 'T', 'X', ' ', '2', '0', '\xBB', '\r', '\n', '\x1A', '\n'};
+	if(compare_header(identifier.data(), cmpIdentifier.data(), identifier.size()) == false)
+		return false;                          // Incorrect header
+	f->Seek(f->Tell() + sizeof(uint32_t) * 2); // Skip vkFormat and typeSize
+	pixelWidth = f->Read<uint32_t>();
+	pixelHeight = f->Read<uint32_t>();
+	return true;
+}
+
 bool pragma::image::read_dds_size(fs::VFilePtr &f, uint32_t &pixelWidth, uint32_t &pixelHeight)
 {
 	// See https://msdn.microsoft.com/de-de/library/windows/desktop/bb943991(v=vs.85).aspx#File_Layout1
@@ -103,6 +118,10 @@ bool pragma::image::read_image_size(const std::string &file, uint32_t &pixelWidt
 		auto f = fs::open_file(file.c_str(), fs::FileMode::Read | fs::FileMode::Binary);
 		return (f != nullptr && read_ktx_size(f, pixelWidth, pixelHeight) == true) ? true : false;
 	}
+	else if(ext == "ktx2") {
+		auto f = fs::open_file(file.c_str(), fs::FileMode::Read | fs::FileMode::Binary);
+		return (f != nullptr && read_ktx2_size(f, pixelWidth, pixelHeight) == true) ? true : false;
+	}
 	else if(ext == "dds") {
 		auto f = fs::open_file(file.c_str(), fs::FileMode::Read | fs::FileMode::Binary);
 		return (f != nullptr && read_dds_size(f, pixelWidth, pixelHeight) == true) ? true : false;
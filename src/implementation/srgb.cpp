@@ -0,0 +1,96 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module;
+
+#if defined(__AVX2__)
+#define UIMG_SRGB_AVX2
+#include <immintrin.h>
+#endif
+
+module pragma.image;
+
+import :core;
+
+namespace srgb {
+	static double srgb_to_linear(double v) { return (v <= 0.04045) ? (v / 12.92) : std::pow((v + 0.055) / 1.055, 2.4); }
+	static double linear_to_srgb(double v) { return (v <= 0.0031308) ? (v * 12.92) : (1.055 * std::pow(v, 1.0 / 2.4) - 0.055); }
+	static int32_t encode_reference(float v) { return static_cast<int32_t>(std::floor(linear_to_srgb(pragma::math::clamp(v, 0.f, 1.f)) * 255.0 + 0.5)); }
+};
+
+float pragma::image::linear_to_srgb(float v) { return static_cast<float>(srgb::linear_to_srgb(v)); }
+float pragma::image::srgb_to_linear(float v) { return static_cast<float>(srgb::srgb_to_linear(v)); }
+
+const pragma::image::SrgbTables &pragma::image::get_srgb_tables()
+{
+	static auto tables = []() {
+		SrgbTables tables {};
+		for(uint32_t i = 0; i < 256; ++i) {
+			tables.decode[i] = static_cast<float>(srgb::srgb_to_linear(i / 255.0));
+			tables.decode[256 + i] = i / 255.f;
+		}
+		tables.encodeThresholds[0] = -std::numeric_limits<float>::infinity();
+		for(uint32_t i = 1; i < 256; ++i) {
+			auto t = static_cast<float>(srgb::srgb_to_linear((i - 0.5) / 255.0));
+			while(srgb::encode_reference(t) >= static_cast<int32_t>(i))
+				t = std::nextafter(t, 0.f);
+			while(srgb::encode_reference(t) < static_cast<int32_t>(i))
+				t = std::nextafter(t, 1.f);
+			tables.encodeThresholds[i] = t;
+		}
+		tables.encodeThresholds[256] = std::numeric_limits<float>::infinity();
+		for(uint32_t i = 0; i < tables.encodeBase.size(); ++i)
+			tables.encodeBase[i] = srgb::encode_reference(i / static_cast<float>(tables.encodeBase.size()));
+		return tables;
+	}();
+	return tables;
+}
+
+float pragma::image::srgb8_to_linear(uint8_t v) { return get_srgb_tables().decode[v]; }
+
+uint8_t pragma::image::linear_to_srgb8(float v)
+{
+	auto &tables = get_srgb_tables();
+	v = pragma::math::clamp(v, 0.f, 1.f);
+	auto idx = std::min(static_cast<int32_t>(v * tables.encodeBase.size()), static_cast<int32_t>(tables.encodeBase.size() - 1));
+	auto base = tables.encodeBase[idx];
+	return static_cast<uint8_t>(base + ((v >= tables.encodeThresholds[base + 1]) ? 1 : 0));
+}
+
+void pragma::image::srgb8_to_linear(const uint8_t *in, float *out, size_t count)
+{
+	auto &tables = get_srgb_tables();
+	size_t i = 0;
+#ifdef UIMG_SRGB_AVX2
+	for(; i + 8 <= count; i += 8) {
+		auto idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + i)));
+		_mm256_storeu_ps(out + i, _mm256_i32gather_ps(tables.decode.data(), idx, 4));
+	}
+#endif
+	for(; i < count; ++i)
+		out[i] = tables.decode[in[i]];
+}
+
+void pragma::image::linear_to_srgb8(const float *in, uint8_t *out, size_t count)
+{
+	size_t i = 0;
+#ifdef UIMG_SRGB_AVX2
+	auto &tables = get_srgb_tables();
+	auto vZero = _mm256_setzero_ps();
+	auto vOne = _mm256_set1_ps(1.f);
+	auto vMaxIdx = _mm256_set1_epi32(static_cast<int32_t>(tables.encodeBase.size() - 1));
+	auto vScale = _mm256_set1_ps(static_cast<float>(tables.encodeBase.size()));
+	for(; i + 8 <= count; i += 8) {
+		auto v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i), vZero), vOne);
+		auto idx = _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(v, vScale)), vMaxIdx);
+		auto base = _mm256_i32gather_epi32(tables.encodeBase.data(), idx, 4);
+		auto threshold = _mm256_i32gather_ps(tables.encodeThresholds.data() + 1, base, 4);
+		// The comparison mask is -1 where the threshold has been reached
+		auto result = _mm256_sub_epi32(base, _mm256_castps_si256(_mm256_cmp_ps(v, threshold, _CMP_GE_OQ)));
+		auto packed = _mm_packus_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(packed, packed));
+	}
+#endif
+	for(; i < count; ++i)
+		out[i] = linear_to_srgb8(in[i]);
+}
@@ -4,6 +4,7 @@
 module pragma.image;
 
 import :compressor;
+import :texture_cache;
 import pragma.filesystem;
 
 #ifdef UIMG_ENABLE_TEXTURE_COMPRESSION
@@ -12,7 +13,7 @@ std::string pragma::image::get_absolute_path(const std::string &fileName, Textur
 	auto path = ufile::get_path_from_filename(fileName);
 	fs::create_path(path);
 	auto fileNameWithExt = fileName;
-	ufile::remove_extension_from_filename(fileNameWithExt, std::array<std::string, 2> {"dds", "ktx"});
+	ufile::remove_extension_from_filename(fileNameWithExt, std::array<std::string, 3> {"dds", "ktx", "ktx2"});
 	switch(containerFormat) {
 	case TextureInfo::ContainerFormat::DDS:
 		fileNameWithExt += ".dds";
@@ -20,6 +21,9 @@ std::string pragma::image::get_absolute_path(const std::string &fileName, Textur
 	case TextureInfo::ContainerFormat::KTX:
 		fileNameWithExt += ".ktx";
 		break;
+	case TextureInfo::ContainerFormat::KTX2:
+		fileNameWithExt += ".ktx2";
+		break;
 	}
 	return fs::get_program_write_path() + '/' + fileNameWithExt;
 }
@@ -34,8 +38,8 @@ static uint32_t calculate_mipmap_size(uint32_t v, uint32_t level)
 	return r;
 }
 
-static bool compress_texture(const std::variant<pragma::image::TextureOutputHandler, std::string> &outputHandler, const std::function<const uint8_t *(uint32_t, uint32_t, std::function<void()> &)> &pfGetImgData, const pragma::image::TextureSaveInfo &texSaveInfo,
-  const std::function<void(const std::string &)> &errorHandler = nullptr, bool absoluteFileName = false)
+static bool compress_texture_uncached(const std::variant<pragma::image::TextureOutputHandler, std::string> &outputHandler, const std::function<const uint8_t *(uint32_t, uint32_t, std::function<void()> &)> &pfGetImgData, const pragma::image::TextureSaveInfo &texSaveInfo,
+  const std::function<void(const std::string &)> &errorHandler, bool absoluteFileName)
 {
 	auto r = false;
 	{
@@ -145,6 +149,140 @@ static bool compress_texture(const std::variant<pragma::image::TextureOutputHand
 	return r;
 }
 
+namespace cached_output {
+	// Output handler payloads are stored as a sequence of surfaces, each of which is preceded by this header
+	struct SurfaceHeader {
+		int32_t size = 0;
+		int32_t width = 0;
+		int32_t height = 0;
+		int32_t depth = 0;
+		int32_t face = 0;
+		int32_t mipLevel = 0;
+		uint64_t dataSize = 0;
+	};
+
+	// Forwards everything to the output handler and records a copy of the payload in outData
+	static pragma::image::TextureOutputHandler record(const pragma::image::TextureOutputHandler &outputHandler, std::vector<uint8_t> &outData)
+	{
+		auto headerOffset = std::make_shared<size_t>(0);
+		pragma::image::TextureOutputHandler recorder {};
+		recorder.beginImage = [&outputHandler, &outData, headerOffset](int size, int width, int height, int depth, int face, int miplevel) {
+			*headerOffset = outData.size();
+			SurfaceHeader header {size, width, height, depth, face, miplevel};
+			outData.resize(outData.size() + sizeof(header));
+			std::memcpy(outData.data() + *headerOffset, &header, sizeof(header));
+			outputHandler.beginImage(size, width, height, depth, face, miplevel);
+		};
+		recorder.writeData = [&outputHandler, &outData](const void *data, int size) -> bool {
+			auto *p = static_cast<const uint8_t *>(data);
+			outData.insert(outData.end(), p, p + size);
+			return outputHandler.writeData(data, size);
+		};
+		recorder.endImage = [&outputHandler, &outData, headerOffset]() {
+			uint64_t dataSize = outData.size() - *headerOffset - sizeof(SurfaceHeader);
+			std::memcpy(outData.data() + *headerOffset + offsetof(SurfaceHeader, dataSize), &dataSize, sizeof(dataSize));
+			outputHandler.endImage();
+		};
+		return recorder;
+	}
+
+	using SurfaceList = std::vector<std::pair<SurfaceHeader, size_t>>;
+	// Returns the surfaces of the payload with their data offsets, or an empty optional if the payload is malformed
+	static std::optional<SurfaceList> parse(const std::vector<uint8_t> &data)
+	{
+		SurfaceList surfaces;
+		for(size_t offset = 0; offset < data.size();) {
+			SurfaceHeader header;
+			if(data.size() - offset < sizeof(header))
+				return {};
+			std::memcpy(&header, data.data() + offset, sizeof(header));
+			offset += sizeof(header);
+			if(data.size() - offset < header.dataSize)
+				return {};
+			surfaces.push_back({header, offset});
+			offset += header.dataSize;
+		}
+		return surfaces;
+	}
+
+	// The payload has to be parsed beforehand, so that the output handler never receives a partial texture due to a malformed entry
+	static bool replay(const std::vector<uint8_t> &data, const SurfaceList &surfaces, const pragma::image::TextureOutputHandler &outputHandler)
+	{
+		for(auto &[header, offset] : surfaces) {
+			outputHandler.beginImage(header.size, header.width, header.height, header.depth, header.face, header.mipLevel);
+			auto success = outputHandler.writeData(data.data() + offset, static_cast<int>(header.dataSize));
+			outputHandler.endImage();
+			if(!success)
+				return false;
+		}
+		return true;
+	}
+
+	static std::optional<std::vector<uint8_t>> read_file(const std::string &path)
+	{
+		std::ifstream f {path, std::ios::binary | std::ios::ate};
+		if(!f)
+			return {};
+		std::vector<uint8_t> data(static_cast<size_t>(f.tellg()));
+		f.seekg(0);
+		if(!f.read(reinterpret_cast<char *>(data.data()), data.size()))
+			return {};
+		return data;
+	}
+
+	static bool write_file(const std::string &path, const std::vector<uint8_t> &data)
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(std::filesystem::path {path}.parent_path(), ec);
+		std::ofstream f {path, std::ios::binary | std::ios::trunc};
+		return f && f.write(reinterpret_cast<const char *>(data.data()), data.size());
+	}
+};
+
+static bool compress_texture(const std::variant<pragma::image::TextureOutputHandler, std::string> &outputHandler, const std::function<const uint8_t *(uint32_t, uint32_t, std::function<void()> &)> &pfGetImgData, const pragma::image::TextureSaveInfo &texSaveInfo,
+  const std::function<void(const std::string &)> &errorHandler = nullptr, bool absoluteFileName = false)
+{
+	auto &cache = texSaveInfo.cache;
+	if(!cache)
+		return compress_texture_uncached(outputHandler, pfGetImgData, texSaveInfo, errorHandler, absoluteFileName);
+	auto fileOutput = (outputHandler.index() == 1);
+	auto key = pragma::image::TextureCache::CalculateKey(pfGetImgData, texSaveInfo, fileOutput);
+	if(!key)
+		return compress_texture_uncached(outputHandler, pfGetImgData, texSaveInfo, errorHandler, absoluteFileName);
+
+	if(fileOutput) {
+		auto &fileName = std::get<std::string>(outputHandler);
+		auto outputFilePath = absoluteFileName ? fileName : pragma::image::get_absolute_path(fileName, texSaveInfo.texInfo.containerFormat);
+		auto cachedData = cache->Load(*key);
+		if(cachedData && cached_output::write_file(outputFilePath, *cachedData)) {
+			pragma::fs::update_file_index_cache(outputFilePath, true);
+			return true;
+		}
+		if(!compress_texture_uncached(outputHandler, pfGetImgData, texSaveInfo, errorHandler, absoluteFileName))
+			return false;
+		auto data = cached_output::read_file(outputFilePath);
+		if(data)
+			cache->Store(*key, data->data(), data->size());
+		return true;
+	}
+
+	auto &texOutputHandler = std::get<pragma::image::TextureOutputHandler>(outputHandler);
+	auto cachedData = cache->Load(*key);
+	if(cachedData) {
+		// Only a malformed entry falls through to a regular compression; if the output handler rejects the replayed data,
+		// it has already received some of the surfaces and compressing the texture again would hand them over a second time
+		auto surfaces = cached_output::parse(*cachedData);
+		if(surfaces)
+			return cached_output::replay(*cachedData, *surfaces, texOutputHandler);
+	}
+	// The payload has to be recorded in full to be stored, so in this case the output isn't bounded to a few surfaces
+	std::vector<uint8_t> recordedData;
+	if(!compress_texture_uncached(cached_output::record(texOutputHandler, recordedData), pfGetImgData, texSaveInfo, errorHandler, absoluteFileName))
+		return false;
+	cache->Store(*key, recordedData.data(), recordedData.size());
+	return true;
+}
+
 bool pragma::image::compress_texture(const TextureOutputHandler &outputHandler, const std::function<const uint8_t *(uint32_t, uint32_t, std::function<void()> &)> &fGetImgData, const TextureSaveInfo &texSaveInfo, const std::function<void(const std::string &)> &errorHandler)
 {
 	return ::compress_texture(outputHandler, fGetImgData, texSaveInfo, errorHandler);
@@ -0,0 +1,399 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module pragma.image;
+
+import :texture_cache;
+
+#ifdef UIMG_ENABLE_TEXTURE_COMPRESSION
+namespace texture_cache {
+	// Has to be incremented whenever the output of any of the compressors changes, which invalidates all existing entries
+	static constexpr uint32_t VERSION = 1;
+	static constexpr std::string_view FILE_EXTENSION = ".utc";
+
+	// Streaming implementation of the XXH64 hash algorithm, which processes the input in 32-byte stripes
+	// with four independent accumulators and is limited by memory bandwidth rather than by the hash itself.
+	class Hasher {
+	  public:
+		Hasher(uint64_t seed = 0) : m_acc {seed + P1 + P2, seed + P2, seed, seed - P1} {}
+		void Update(const void *data, size_t size)
+		{
+			auto *p = static_cast<const uint8_t *>(data);
+			m_totalSize += size;
+			if(m_bufferSize > 0) {
+				auto n = std::min(size, m_buffer.size() - m_bufferSize);
+				memcpy(m_buffer.data() + m_bufferSize, p, n);
+				m_bufferSize += n;
+				p += n;
+				size -= n;
+				if(m_bufferSize < m_buffer.size())
+					return;
+				ProcessStripe(m_buffer.data());
+				m_bufferSize = 0;
+			}
+			for(; size >= STRIPE_SIZE; p += STRIPE_SIZE, size -= STRIPE_SIZE)
+				ProcessStripe(p);
+			memcpy(m_buffer.data(), p, size);
+			m_bufferSize = size;
+		}
+		template<typename T>
+		    requires(std::is_trivially_copyable_v<T>)
+		void Update(const T &value)
+		{
+			Update(&value, sizeof(value));
+		}
+		uint64_t Finalize() const
+		{
+			uint64_t h;
+			if(m_totalSize >= STRIPE_SIZE) {
+				h = std::rotl(m_acc[0], 1) + std::rotl(m_acc[1], 7) + std::rotl(m_acc[2], 12) + std::rotl(m_acc[3], 18);
+				for(auto acc : m_acc)
+					h = MergeRound(h, acc);
+			}
+			else
+				h = m_acc[2] + P5;
+			h += m_totalSize;
+
+			auto *p = m_buffer.data();
+			auto size = m_bufferSize;
+			for(; size >= 8; p += 8, size -= 8) {
+				h ^= Round(0, Read<uint64_t>(p));
+				h = std::rotl(h, 27) * P1 + P4;
+			}
+			if(size >= 4) {
+				h ^= Read<uint32_t>(p) * P1;
+				h = std::rotl(h, 23) * P2 + P3;
+				p += 4;
+				size -= 4;
+			}
+			for(; size > 0; ++p, --size) {
+				h ^= *p * P5;
+				h = std::rotl(h, 11) * P1;
+			}
+
+			h ^= h >> 33;
+			h *= P2;
+			h ^= h >> 29;
+			h *= P3;
+			h ^= h >> 32;
+			return h;
+		}
+	  private:
+		static constexpr uint64_t P1 = 0x9E3779B185EBCA87ull;
+		static constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+		static constexpr uint64_t P3 = 0x165667B19E3779F9ull;
+		static constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+		static constexpr uint64_t P5 = 0x27D4EB2F165667C5ull;
+		static constexpr size_t STRIPE_SIZE = 32;
+		template<typename T>
+		static T Read(const uint8_t *p)
+		{
+			T v;
+			memcpy(&v, p, sizeof(v));
+			return v;
+		}
+		static uint64_t Round(uint64_t acc, uint64_t input) { return std::rotl(acc + input * P2, 31) * P1; }
+		static uint64_t MergeRound(uint64_t acc, uint64_t v) { return (acc ^ Round(0, v)) * P1 + P4; }
+		void ProcessStripe(const uint8_t *p)
+		{
+			for(size_t i = 0; i < m_acc.size(); ++i)
+				m_acc[i] = Round(m_acc[i], Read<uint64_t>(p + i * 8));
+		}
+		std::array<uint64_t, 4> m_acc;
+		std::array<uint8_t, STRIPE_SIZE> m_buffer {};
+		size_t m_bufferSize = 0;
+		uint64_t m_totalSize = 0;
+	};
+
+	static std::optional<uint32_t> get_pixel_size(const pragma::image::TextureSaveInfo &texSaveInfo)
+	{
+		using pragma::image::TextureInfo;
+		if(texSaveInfo.szPerPixel > 0)
+			return texSaveInfo.szPerPixel;
+		switch(texSaveInfo.texInfo.inputFormat) {
+		case TextureInfo::InputFormat::R8G8B8A8_UInt:
+		case TextureInfo::InputFormat::B8G8R8A8_UInt:
+		case TextureInfo::InputFormat::R32_Float:
+			return 4;
+		case TextureInfo::InputFormat::R16G16B16A16_Float:
+			return 8;
+		case TextureInfo::InputFormat::R32G32B32A32_Float:
+			return 16;
+		default:
+			break;
+		}
+		return {};
+	}
+
+	static std::optional<uint64_t> parse_key(const std::string &fileName)
+	{
+		constexpr size_t numDigits = 16;
+		if(fileName.size() != numDigits + FILE_EXTENSION.size() || !fileName.ends_with(FILE_EXTENSION))
+			return {};
+		uint64_t key = 0;
+		auto res = std::from_chars(fileName.data(), fileName.data() + numDigits, key, 16);
+		if(res.ec != std::errc {} || res.ptr != fileName.data() + numDigits)
+			return {};
+		return key;
+	}
+};
+
+std::unique_ptr<pragma::image::DirectoryTextureCacheBackend> pragma::image::DirectoryTextureCacheBackend::Create(const std::string &directory)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(directory, ec);
+	if(!std::filesystem::is_directory(directory, ec))
+		return nullptr;
+	return std::unique_ptr<DirectoryTextureCacheBackend> {new DirectoryTextureCacheBackend {directory}};
+}
+
+pragma::image::DirectoryTextureCacheBackend::DirectoryTextureCacheBackend(const std::string &directory) : m_directory {directory} {}
+
+const std::string &pragma::image::DirectoryTextureCacheBackend::GetDirectory() const { return m_directory; }
+
+std::string pragma::image::DirectoryTextureCacheBackend::GetEntryPath(uint64_t key) const
+{
+	std::array<char, 17> hex {};
+	std::snprintf(hex.data(), hex.size(), "%016llx", static_cast<unsigned long long>(key));
+	return m_directory + '/' + hex.data() + std::string {texture_cache::FILE_EXTENSION};
+}
+
+std::vector<pragma::image::ITextureCacheBackend::Entry> pragma::image::DirectoryTextureCacheBackend::GetEntries()
+{
+	std::vector<Entry> entries;
+	std::error_code ec;
+	for(auto &dirEntry : std::filesystem::directory_iterator {m_directory, ec}) {
+		if(!dirEntry.is_regular_file(ec))
+			continue;
+		auto key = texture_cache::parse_key(dirEntry.path().filename().string());
+		if(!key)
+			continue;
+		Entry entry {};
+		entry.key = *key;
+		entry.size = dirEntry.file_size(ec);
+		if(ec)
+			continue;
+		entry.lastAccess = dirEntry.last_write_time(ec).time_since_epoch().count();
+		entries.push_back(entry);
+	}
+	return entries;
+}
+
+std::optional<std::vector<uint8_t>> pragma::image::DirectoryTextureCacheBackend::Read(uint64_t key)
+{
+	std::ifstream f {GetEntryPath(key), std::ios::binary | std::ios::ate};
+	if(!f)
+		return {};
+	std::vector<uint8_t> data(static_cast<size_t>(f.tellg()));
+	f.seekg(0);
+	if(!f.read(reinterpret_cast<char *>(data.data()), data.size()))
+		return {};
+	return data;
+}
+
+bool pragma::image::DirectoryTextureCacheBackend::Write(uint64_t key, const void *data, size_t size)
+{
+	auto path = GetEntryPath(key);
+	// The temporary name has to be unique across threads and processes
+	auto tmpPath = path + '.' + std::to_string(std::random_device {}()) + '.' + std::to_string(m_tmpFileIndex++) + ".tmp";
+	std::error_code ec;
+	{
+		std::ofstream f {tmpPath, std::ios::binary | std::ios::trunc};
+		if(!f || !f.write(static_cast<const char *>(data), size)) {
+			f.close();
+			std::filesystem::remove(tmpPath, ec);
+			return false;
+		}
+	}
+	std::filesystem::rename(tmpPath, path, ec);
+	if(ec) {
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+	return true;
+}
+
+void pragma::image::DirectoryTextureCacheBackend::Remove(uint64_t key)
+{
+	std::error_code ec;
+	std::filesystem::remove(GetEntryPath(key), ec);
+}
+
+void pragma::image::DirectoryTextureCacheBackend::Touch(uint64_t key)
+{
+	std::error_code ec;
+	std::filesystem::last_write_time(GetEntryPath(key), std::filesystem::file_time_type::clock::now(), ec);
+}
+
+//////////////
+
+std::shared_ptr<pragma::image::TextureCache> pragma::image::TextureCache::Create(std::unique_ptr<ITextureCacheBackend> backend, uint64_t maxSize)
+{
+	if(!backend)
+		return nullptr;
+	return std::shared_ptr<TextureCache> {new TextureCache {std::move(backend), maxSize}};
+}
+
+std::shared_ptr<pragma::image::TextureCache> pragma::image::TextureCache::Create(const std::string &directory, uint64_t maxSize) { return Create(DirectoryTextureCacheBackend::Create(directory), maxSize); }
+
+pragma::image::TextureCache::TextureCache(std::unique_ptr<ITextureCacheBackend> backend, uint64_t maxSize) : m_backend {std::move(backend)}, m_maxSize {maxSize}
+{
+	auto entries = m_backend->GetEntries();
+	std::sort(entries.begin(), entries.end(), [](const ITextureCacheBackend::Entry &a, const ITextureCacheBackend::Entry &b) { return a.lastAccess > b.lastAccess; });
+	for(auto &entry : entries) {
+		m_lru.push_back(entry.key);
+		m_entries[entry.key] = {std::prev(m_lru.end()), entry.size};
+		m_size += entry.size;
+	}
+	Evict();
+}
+
+std::optional<uint64_t> pragma::image::TextureCache::CalculateKey(const std::function<const uint8_t *(uint32_t, uint32_t, std::function<void()> &)> &fGetImgData, const TextureSaveInfo &texSaveInfo, bool fileOutput)
+{
+	auto pixelSize = texture_cache::get_pixel_size(texSaveInfo);
+	if(!pixelSize)
+		return {};
+	auto numMipmaps = std::max(texSaveInfo.numMipmaps, 1u);
+	texture_cache::Hasher hasher {};
+	for(auto l = decltype(texSaveInfo.numLayers) {0u}; l < texSaveInfo.numLayers; ++l) {
+		for(auto m = decltype(numMipmaps) {0u}; m < numMipmaps; ++m) {
+			uint32_t w, h;
+			calculate_mipmap_size(texSaveInfo.width, texSaveInfo.height, w, h, m);
+			std::function<void()> deleter = nullptr;
+			auto *data = fGetImgData(l, m, deleter);
+			if(!data) {
+				if(deleter)
+					deleter();
+				return {};
+			}
+			hasher.Update(data, static_cast<size_t>(w) * h * *pixelSize);
+			if(deleter)
+				deleter();
+		}
+	}
+
+	// Settings are hashed field by field, the structs contain padding
+	auto &texInfo = texSaveInfo.texInfo;
+	hasher.Update(texture_cache::VERSION);
+	hasher.Update(fileOutput);
+	hasher.Update(texInfo.inputFormat);
+	hasher.Update(texInfo.outputFormat);
+	hasher.Update(texInfo.containerFormat);
+	hasher.Update(texInfo.flags);
+	hasher.Update(texInfo.mipMapFilter);
+	hasher.Update(texInfo.wrapMode);
+	hasher.Update(texInfo.alphaMode);
+	hasher.Update(texInfo.IsNormalMap());
+	hasher.Update(texSaveInfo.width);
+	hasher.Update(texSaveInfo.height);
+	hasher.Update(*pixelSize);
+	hasher.Update(texSaveInfo.numLayers);
+	hasher.Update(numMipmaps);
+	hasher.Update(texSaveInfo.cubemap);
+	auto channelMask = texSaveInfo.channelMask.value_or(ChannelMask {});
+	for(uint32_t i = 0; i < 4; ++i)
+		hasher.Update(channelMask[i]);
+	// Different compressors produce different output, so the set of available compressors is part of the key as well
+	hasher.Update(texSaveInfo.compressorLibrary.has_value() ? static_cast<int32_t>(*texSaveInfo.compressorLibrary) : -1);
+	uint32_t enabledCompressors = 0;
+#ifdef UIMG_ENABLE_NVTT
+	enabledCompressors |= 1u << static_cast<uint32_t>(CompressorLibrary::Nvtt);
+#endif
+#ifdef UIMG_ENABLE_COMPRESSONATOR
+	enabledCompressors |= 1u << static_cast<uint32_t>(CompressorLibrary::Compressonator);
+#endif
+#ifdef UIMG_ENABLE_ISPC_TEXTURE_COMPRESSOR
+	enabledCompressors |= 1u << static_cast<uint32_t>(CompressorLibrary::Ispctc);
+#endif
+	hasher.Update(enabledCompressors);
+	hasher.Update(texSaveInfo.storeNormalLengthInAlpha);
+	hasher.Update(texSaveInfo.alphaCoverageCutoff.has_value());
+	hasher.Update(texSaveInfo.alphaCoverageCutoff.value_or(0.f));
+	hasher.Update(texSaveInfo.compressionSpeed);
+	return hasher.Finalize();
+}
+
+std::optional<std::vector<uint8_t>> pragma::image::TextureCache::Load(uint64_t key)
+{
+	{
+		std::scoped_lock lock {m_mutex};
+		auto it = m_entries.find(key);
+		if(it == m_entries.end())
+			return {};
+		m_lru.splice(m_lru.begin(), m_lru, it->second.lruIt);
+	}
+	auto data = m_backend->Read(key);
+	if(!data) {
+		// The entry may have been removed externally
+		Remove(key);
+		return {};
+	}
+	m_backend->Touch(key);
+	return data;
+}
+
+bool pragma::image::TextureCache::Store(uint64_t key, const void *data, size_t size)
+{
+	if(size > GetMaxSize() || !m_backend->Write(key, data, size))
+		return false;
+	std::scoped_lock lock {m_mutex};
+	auto it = m_entries.find(key);
+	if(it != m_entries.end()) {
+		m_size -= it->second.size;
+		it->second.size = size;
+		m_lru.splice(m_lru.begin(), m_lru, it->second.lruIt);
+	}
+	else {
+		m_lru.push_front(key);
+		m_entries[key] = {m_lru.begin(), size};
+	}
+	m_size += size;
+	Evict();
+	return true;
+}
+
+void pragma::image::TextureCache::Remove(uint64_t key)
+{
+	std::scoped_lock lock {m_mutex};
+	auto it = m_entries.find(key);
+	if(it != m_entries.end())
+		RemoveEntry(it);
+}
+
+void pragma::image::TextureCache::RemoveEntry(std::unordered_map<uint64_t, EntryInfo>::iterator it)
+{
+	m_backend->Remove(it->first);
+	m_size -= it->second.size;
+	m_lru.erase(it->second.lruIt);
+	m_entries.erase(it);
+}
+
+void pragma::image::TextureCache::Evict()
+{
+	while(m_size > m_maxSize && !m_lru.empty())
+		RemoveEntry(m_entries.find(m_lru.back()));
+}
+
+void pragma::image::TextureCache::SetMaxSize(uint64_t maxSize)
+{
+	std::scoped_lock lock {m_mutex};
+	m_maxSize = maxSize;
+	Evict();
+}
+uint64_t pragma::image::TextureCache::GetMaxSize() const
+{
+	std::scoped_lock lock {m_mutex};
+	return m_maxSize;
+}
+uint64_t pragma::image::TextureCache::GetSize() const
+{
+	std::scoped_lock lock {m_mutex};
+	return m_size;
+}
+uint32_t pragma::image::TextureCache::GetEntryCount() const
+{
+	std::scoped_lock lock {m_mutex};
+	return static_cast<uint32_t>(m_entries.size());
+}
+pragma::image::ITextureCacheBackend &pragma::image::TextureCache::GetBackend() { return *m_backend; }
+#endif
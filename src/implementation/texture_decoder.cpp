@@ -0,0 +1,842 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module;
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UIMG_DECODER_SSE2
+#include <emmintrin.h>
+#endif
+
+module pragma.image;
+
+import :buffer;
+import :texture_file;
+import :thread_pool;
+
+// Block decoders for BC1-BC7, ETC1, ETC2 and EAC. Every decoder writes a 4x4 block of pixels in row-major order,
+// palettes and endpoint interpolation are vectorized where SSE2 is available.
+namespace decoder {
+	using Rgba = std::array<uint8_t, 4>;
+	using RgbaBlock = std::array<Rgba, 16>;
+
+	static uint8_t extend5(uint32_t v) { return static_cast<uint8_t>((v << 3) | (v >> 2)); }
+	static uint8_t extend6(uint32_t v) { return static_cast<uint8_t>((v << 2) | (v >> 4)); }
+	static uint64_t read_u64(const uint8_t *src)
+	{
+		uint64_t v;
+		std::memcpy(&v, src, sizeof(v));
+		return v;
+	}
+
+	// Reads the bits of a 128-bit block, starting at the least significant bit
+	class BitReader {
+	  public:
+		BitReader(const uint8_t *src) : m_lo {read_u64(src)}, m_hi {read_u64(src + 8)} {}
+		uint32_t Read(uint32_t numBits)
+		{
+			auto mask = (uint64_t {1} << numBits) - 1;
+			uint64_t v;
+			if(m_pos + numBits <= 64)
+				v = m_lo >> m_pos;
+			else if(m_pos >= 64)
+				v = m_hi >> (m_pos - 64);
+			else
+				v = (m_lo >> m_pos) | (m_hi << (64 - m_pos));
+			m_pos += numBits;
+			return static_cast<uint32_t>(v & mask);
+		}
+	  private:
+		uint64_t m_lo;
+		uint64_t m_hi;
+		uint32_t m_pos = 0;
+	};
+
+	////////// BC1 - BC5
+
+	// Palette entries are packed as RGBA8
+	static void get_bc1_palette(uint16_t c0, uint16_t c1, bool fourColors, uint8_t alpha3, std::array<uint32_t, 4> &outPalette)
+	{
+		uint8_t r0 = extend5(c0 >> 11), g0 = extend6((c0 >> 5) & 63), b0 = extend5(c0 & 31);
+		uint8_t r1 = extend5(c1 >> 11), g1 = extend6((c1 >> 5) & 63), b1 = extend5(c1 & 31);
+#ifdef UIMG_DECODER_SSE2
+		auto endpoints = _mm_setr_epi16(r0, g0, b0, 255, r1, g1, b1, 255);
+		auto swapped = _mm_shuffle_epi32(endpoints, _MM_SHUFFLE(1, 0, 3, 2));
+		__m128i interpolated;
+		if(fourColors) {
+			// (2 * a + b) / 3, the reciprocal is exact for all values in range
+			interpolated = _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(endpoints, endpoints), swapped), _mm_set1_epi16(21846));
+		}
+		else
+			interpolated = _mm_srli_epi16(_mm_add_epi16(endpoints, swapped), 1);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(outPalette.data()), _mm_packus_epi16(endpoints, interpolated));
+#else
+		auto pack = [](uint32_t r, uint32_t g, uint32_t b) { return r | (g << 8) | (b << 16) | 0xFF000000u; };
+		outPalette[0] = pack(r0, g0, b0);
+		outPalette[1] = pack(r1, g1, b1);
+		if(fourColors) {
+			outPalette[2] = pack((2 * r0 + r1) / 3, (2 * g0 + g1) / 3, (2 * b0 + b1) / 3);
+			outPalette[3] = pack((r0 + 2 * r1) / 3, (g0 + 2 * g1) / 3, (b0 + 2 * b1) / 3);
+		}
+		else
+			outPalette[2] = pack((r0 + r1) / 2, (g0 + g1) / 2, (b0 + b1) / 2);
+#endif
+		if(!fourColors)
+			outPalette[3] = static_cast<uint32_t>(alpha3) << 24;
+	}
+	// BC2 and BC3 color blocks always use four colors
+	static void decode_bc1_color(const uint8_t *src, bool alwaysFourColors, uint8_t alpha3, RgbaBlock &out)
+	{
+		uint16_t c0 = src[0] | (src[1] << 8);
+		uint16_t c1 = src[2] | (src[3] << 8);
+		std::array<uint32_t, 4> palette;
+		get_bc1_palette(c0, c1, alwaysFourColors || c0 > c1, alpha3, palette);
+		uint32_t indices = src[4] | (src[5] << 8) | (src[6] << 16) | (static_cast<uint32_t>(src[7]) << 24);
+		for(uint32_t i = 0; i < 16; ++i)
+			std::memcpy(out[i].data(), &palette[(indices >> (i * 2)) & 3], sizeof(uint32_t));
+	}
+	static void get_alpha_palette(uint8_t a0, uint8_t a1, std::array<uint8_t, 8> &outPalette)
+	{
+#ifdef UIMG_DECODER_SSE2
+		__m128i sum;
+		if(a0 > a1) {
+			sum = _mm_add_epi16(_mm_mullo_epi16(_mm_set1_epi16(a0), _mm_setr_epi16(7, 0, 6, 5, 4, 3, 2, 1)), _mm_mullo_epi16(_mm_set1_epi16(a1), _mm_setr_epi16(0, 7, 1, 2, 3, 4, 5, 6)));
+			sum = _mm_mulhi_epu16(sum, _mm_set1_epi16(9363)); // / 7
+		}
+		else {
+			sum = _mm_add_epi16(_mm_mullo_epi16(_mm_set1_epi16(a0), _mm_setr_epi16(5, 0, 4, 3, 2, 1, 0, 0)), _mm_mullo_epi16(_mm_set1_epi16(a1), _mm_setr_epi16(0, 5, 1, 2, 3, 4, 0, 0)));
+			sum = _mm_mulhi_epu16(sum, _mm_set1_epi16(13108)); // / 5
+		}
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(outPalette.data()), _mm_packus_epi16(sum, sum));
+#else
+		outPalette[0] = a0;
+		outPalette[1] = a1;
+		if(a0 > a1) {
+			for(uint32_t i = 1; i < 7; ++i)
+				outPalette[i + 1] = static_cast<uint8_t>(((7 - i) * a0 + i * a1) / 7);
+		}
+		else {
+			for(uint32_t i = 1; i < 5; ++i)
+				outPalette[i + 1] = static_cast<uint8_t>(((5 - i) * a0 + i * a1) / 5);
+		}
+#endif
+		if(a0 <= a1) {
+			outPalette[6] = 0;
+			outPalette[7] = 255;
+		}
+	}
+	// BC3 alpha and BC4/BC5 channel block
+	static void decode_bc4_channel(const uint8_t *src, std::array<uint8_t, 16> &out)
+	{
+		std::array<uint8_t, 8> palette;
+		get_alpha_palette(src[0], src[1], palette);
+		auto indices = read_u64(src) >> 16;
+		for(uint32_t i = 0; i < 16; ++i)
+			out[i] = palette[(indices >> (i * 3)) & 7];
+	}
+	static void decode_bc2_alpha(const uint8_t *src, std::array<uint8_t, 16> &out)
+	{
+		auto values = read_u64(src);
+		for(uint32_t i = 0; i < 16; ++i)
+			out[i] = static_cast<uint8_t>(((values >> (i * 4)) & 15) * 17);
+	}
+
+	////////// BC6H / BC7
+
+	static constexpr std::array<uint16_t, 64> PARTITIONS2 = {0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000, 0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110,
+	  0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C, 0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660, 0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6,
+	  0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22};
+	static constexpr std::array<std::array<uint8_t, 16>, 64> PARTITIONS3 = {{
+	  {0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2},
+	  {0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1},
+	  {0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1},
+	  {0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1},
+	  {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2},
+	  {0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2},
+	  {0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1},
+	  {0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1},
+	  {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2},
+	  {0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2},
+	  {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2},
+	  {0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2},
+	  {0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2},
+	  {0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2},
+	  {0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2},
+	  {0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0},
+	  {0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2},
+	  {0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0},
+	  {0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2},
+	  {0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1},
+	  {0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2},
+	  {0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1},
+	  {0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2},
+	  {0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0},
+	  {0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0},
+	  {0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2},
+	  {0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0},
+	  {0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1},
+	  {0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2},
+	  {0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2},
+	  {0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1},
+	  {0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1},
+	  {0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2},
+	  {0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1},
+	  {0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2},
+	  {0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0},
+	  {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0},
+	  {0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0},
+	  {0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0},
+	  {0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1},
+	  {0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1},
+	  {0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2},
+	  {0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1},
+	  {0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2},
+	  {0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1},
+	  {0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1},
+	  {0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1},
+	  {0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1},
+	  {0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2},
+	  {0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1},
+	  {0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2},
+	  {0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2},
+	  {0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2},
+	  {0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2},
+	  {0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2},
+	  {0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2},
+	  {0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2},
+	  {0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2},
+	  {0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2},
+	  {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2},
+	  {0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1},
+	  {0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2},
+	  {0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2},
+	  {0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0},
+	}};
+	// Pixels whose index is stored with one bit less, the first subset is always anchored at pixel 0
+	static constexpr std::array<uint8_t, 64> ANCHORS2 = {15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2, 15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6, 6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15,
+	  15, 2, 2, 15};
+	static constexpr std::array<uint8_t, 64> ANCHORS3_SECOND
+	  = {3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3, 3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15, 8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15, 3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3};
+	static constexpr std::array<uint8_t, 64> ANCHORS3_THIRD
+	  = {15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8, 15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8, 15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8, 15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8};
+	static constexpr std::array<uint8_t, 4> WEIGHTS2 = {0, 21, 43, 64};
+	static constexpr std::array<uint8_t, 8> WEIGHTS3 = {0, 9, 18, 27, 37, 46, 55, 64};
+	static constexpr std::array<uint8_t, 16> WEIGHTS4 = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+	static const uint8_t *get_weights(uint32_t indexBits) { return (indexBits == 2) ? WEIGHTS2.data() : ((indexBits == 3) ? WEIGHTS3.data() : WEIGHTS4.data()); }
+
+	static uint32_t get_subset(uint32_t numSubsets, uint32_t partition, uint32_t pixel)
+	{
+		switch(numSubsets) {
+		case 2:
+			return (PARTITIONS2[partition] >> pixel) & 1;
+		case 3:
+			return PARTITIONS3[partition][pixel];
+		default:
+			return 0;
+		}
+	}
+	static bool is_anchor(uint32_t numSubsets, uint32_t partition, uint32_t pixel)
+	{
+		if(pixel == 0)
+			return true;
+		switch(numSubsets) {
+		case 2:
+			return pixel == ANCHORS2[partition];
+		case 3:
+			return pixel == ANCHORS3_SECOND[partition] || pixel == ANCHORS3_THIRD[partition];
+		default:
+			return false;
+		}
+	}
+
+	// Interpolates (e0 * (64 - w) + e1 * w + 32) / 64 for every weight
+	static void get_bc7_palette(const Rgba &e0, const Rgba &e1, const uint8_t *weights, uint32_t numWeights, std::array<Rgba, 16> &outPalette)
+	{
+#ifdef UIMG_DECODER_SSE2
+		auto v0 = _mm_setr_epi16(e0[0], e0[1], e0[2], e0[3], e0[0], e0[1], e0[2], e0[3]);
+		auto v1 = _mm_setr_epi16(e1[0], e1[1], e1[2], e1[3], e1[0], e1[1], e1[2], e1[3]);
+		auto v64 = _mm_set1_epi16(64);
+		auto v32 = _mm_set1_epi16(32);
+		for(uint32_t i = 0; i < numWeights; i += 4) {
+			auto w01 = _mm_setr_epi16(weights[i], weights[i], weights[i], weights[i], weights[i + 1], weights[i + 1], weights[i + 1], weights[i + 1]);
+			auto w23 = (i + 2 < numWeights) ? _mm_setr_epi16(weights[i + 2], weights[i + 2], weights[i + 2], weights[i + 2], weights[i + 3], weights[i + 3], weights[i + 3], weights[i + 3]) : _mm_setzero_si128();
+			auto r01 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(v0, _mm_sub_epi16(v64, w01)), _mm_mullo_epi16(v1, w01)), v32), 6);
+			auto r23 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(v0, _mm_sub_epi16(v64, w23)), _mm_mullo_epi16(v1, w23)), v32), 6);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(outPalette[i].data()), _mm_packus_epi16(r01, r23));
+		}
+#else
+		for(uint32_t i = 0; i < numWeights; ++i) {
+			for(uint32_t c = 0; c < 4; ++c)
+				outPalette[i][c] = static_cast<uint8_t>((e0[c] * (64 - weights[i]) + e1[c] * weights[i] + 32) >> 6);
+		}
+#endif
+	}
+
+	struct Bc7Mode {
+		uint8_t numSubsets;
+		uint8_t partitionBits;
+		uint8_t rotationBits;
+		uint8_t indexSelectionBits;
+		uint8_t colorBits;
+		uint8_t alphaBits;
+		uint8_t endpointPBits;
+		uint8_t sharedPBits;
+		uint8_t indexBits;
+		uint8_t secondaryIndexBits;
+	};
+	static constexpr std::array<Bc7Mode, 8> BC7_MODES = {{
+	  {3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+	  {2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+	  {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+	  {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+	  {1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+	  {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+	  {1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+	  {2, 6, 0, 0, 5, 5, 1, 0, 2, 0},
+	}};
+	static void decode_bc7(const uint8_t *src, RgbaBlock &out)
+	{
+		uint32_t modeIdx = 0;
+		while(modeIdx < 8 && (src[0] & (1 << modeIdx)) == 0)
+			++modeIdx;
+		if(modeIdx == 8) {
+			// Reserved mode
+			for(auto &px : out)
+				px = {0, 0, 0, 0};
+			return;
+		}
+		auto &mode = BC7_MODES[modeIdx];
+		BitReader reader {src};
+		reader.Read(modeIdx + 1);
+		auto partition = reader.Read(mode.partitionBits);
+		auto rotation = reader.Read(mode.rotationBits);
+		auto indexSelection = reader.Read(mode.indexSelectionBits);
+
+		uint32_t numEndpoints = mode.numSubsets * 2;
+		std::array<Rgba, 6> endpoints {};
+		for(uint32_t c = 0; c < 3; ++c) {
+			for(uint32_t i = 0; i < numEndpoints; ++i)
+				endpoints[i][c] = static_cast<uint8_t>(reader.Read(mode.colorBits));
+		}
+		for(uint32_t i = 0; i < numEndpoints; ++i)
+			endpoints[i][3] = static_cast<uint8_t>(mode.alphaBits ? reader.Read(mode.alphaBits) : 255);
+
+		auto colorBits = mode.colorBits;
+		auto alphaBits = mode.alphaBits;
+		if(mode.endpointPBits || mode.sharedPBits) {
+			std::array<uint32_t, 6> pBits;
+			if(mode.endpointPBits) {
+				for(uint32_t i = 0; i < numEndpoints; ++i)
+					pBits[i] = reader.Read(1);
+			}
+			else {
+				for(uint32_t s = 0; s < mode.numSubsets; ++s)
+					pBits[s * 2] = pBits[s * 2 + 1] = reader.Read(1);
+			}
+			for(uint32_t i = 0; i < numEndpoints; ++i) {
+				for(uint32_t c = 0; c < 4; ++c) {
+					if(c < 3 || alphaBits)
+						endpoints[i][c] = static_cast<uint8_t>((endpoints[i][c] << 1) | pBits[i]);
+				}
+			}
+			++colorBits;
+			if(alphaBits)
+				++alphaBits;
+		}
+		for(uint32_t i = 0; i < numEndpoints; ++i) {
+			for(uint32_t c = 0; c < 3; ++c)
+				endpoints[i][c] = static_cast<uint8_t>((endpoints[i][c] << (8 - colorBits)) | (endpoints[i][c] >> (2 * colorBits - 8)));
+			if(alphaBits)
+				endpoints[i][3] = static_cast<uint8_t>((endpoints[i][3] << (8 - alphaBits)) | (endpoints[i][3] >> (2 * alphaBits - 8)));
+		}
+
+		std::array<uint8_t, 16> indices;
+		for(uint32_t i = 0; i < 16; ++i)
+			indices[i] = static_cast<uint8_t>(reader.Read(is_anchor(mode.numSubsets, partition, i) ? mode.indexBits - 1 : mode.indexBits));
+		std::array<uint8_t, 16> secondaryIndices;
+		if(mode.secondaryIndexBits) {
+			for(uint32_t i = 0; i < 16; ++i)
+				secondaryIndices[i] = static_cast<uint8_t>(reader.Read((i == 0) ? mode.secondaryIndexBits - 1 : mode.secondaryIndexBits));
+		}
+
+		std::array<std::array<Rgba, 16>, 3> palettes;
+		uint32_t colorIndexBits = mode.indexBits;
+		if(!mode.secondaryIndexBits) {
+			for(uint32_t s = 0; s < mode.numSubsets; ++s)
+				get_bc7_palette(endpoints[s * 2], endpoints[s * 2 + 1], get_weights(colorIndexBits), 1 << colorIndexBits, palettes[s]);
+			for(uint32_t i = 0; i < 16; ++i)
+				out[i] = palettes[get_subset(mode.numSubsets, partition, i)][indices[i]];
+		}
+		else {
+			// Modes 4 and 5 interpolate color and alpha with separate indices, which may be swapped by the index selection bit
+			auto *colorIndices = &indices;
+			auto *alphaIndices = &secondaryIndices;
+			uint32_t alphaIndexBits = mode.secondaryIndexBits;
+			if(indexSelection) {
+				std::swap(colorIndices, alphaIndices);
+				std::swap(colorIndexBits, alphaIndexBits);
+			}
+			get_bc7_palette(endpoints[0], endpoints[1], get_weights(colorIndexBits), 1 << colorIndexBits, palettes[0]);
+			get_bc7_palette(endpoints[0], endpoints[1], get_weights(alphaIndexBits), 1 << alphaIndexBits, palettes[1]);
+			for(uint32_t i = 0; i < 16; ++i) {
+				out[i] = palettes[0][(*colorIndices)[i]];
+				out[i][3] = palettes[1][(*alphaIndices)[i]][3];
+			}
+		}
+		if(rotation != 0) {
+			for(auto &px : out)
+				std::swap(px[3], px[rotation - 1]);
+		}
+	}
+
+	static int32_t sign_extend(int32_t v, uint32_t bits)
+	{
+		auto shift = 32 - bits;
+		return static_cast<int32_t>(static_cast<uint32_t>(v) << shift) >> shift;
+	}
+	static int32_t unquantize_bc6h(int32_t v, uint32_t bits, bool isSigned)
+	{
+		if(!isSigned) {
+			if(bits >= 15 || v == 0)
+				return v;
+			if(v == (1 << bits) - 1)
+				return 0xFFFF;
+			return ((v << 16) + 0x8000) >> bits;
+		}
+		if(bits >= 16)
+			return v;
+		auto negative = v < 0;
+		if(negative)
+			v = -v;
+		int32_t result;
+		if(v == 0)
+			result = 0;
+		else if(v >= (1 << (bits - 1)) - 1)
+			result = 0x7FFF;
+		else
+			result = ((v << 15) + 0x4000) >> (bits - 1);
+		return negative ? -result : result;
+	}
+	static uint16_t finish_unquantize_bc6h(int32_t v, bool isSigned)
+	{
+		if(!isSigned)
+			return static_cast<uint16_t>((v * 31) >> 6);
+		if(v < 0)
+			return static_cast<uint16_t>(0x8000 | (((-v) * 31) >> 5));
+		return static_cast<uint16_t>((v * 31) >> 5);
+	}
+	// Writes half-float RGBA values, alpha is always 1
+	static void decode_bc6h(const uint8_t *src, bool isSigned, std::array<std::array<uint16_t, 4>, 16> &out)
+	{
+		BitReader reader {src};
+		uint32_t mode = reader.Read(2);
+		if(mode > 1)
+			mode |= reader.Read(3) << 2;
+		// Endpoints of the first region, followed by the endpoints of the second region
+		std::array<int32_t, 4> r {}, g {}, b {};
+		auto bits = [&reader](int32_t &v, uint32_t numBits, uint32_t shift = 0) { v |= static_cast<int32_t>(reader.Read(numBits)) << shift; };
+		auto bit = [&reader](int32_t &v, uint32_t pos) { v |= static_cast<int32_t>(reader.Read(1)) << pos; };
+		// Some modes store the high bits of the base endpoint in reverse order
+		auto reversedBits = [&reader](int32_t &v, uint32_t numBits, uint32_t shift) {
+			for(uint32_t i = 0; i < numBits; ++i)
+				v |= static_cast<int32_t>(reader.Read(1)) << (shift + numBits - 1 - i);
+		};
+		uint32_t endpointBits;
+		std::array<uint32_t, 3> deltaBits;
+		auto transformed = true;
+		auto twoRegions = true;
+		switch(mode) {
+		case 0b00:
+			bit(g[2], 4), bit(b[2], 4), bit(b[3], 4), bits(r[0], 10), bits(g[0], 10), bits(b[0], 10), bits(r[1], 5), bit(g[3], 4), bits(g[2], 4), bits(g[1], 5), bit(b[3], 0), bits(g[3], 4), bits(b[1], 5), bit(b[3], 1), bits(b[2], 4), bits(r[2], 5), bit(b[3], 2), bits(r[3], 5),
+			  bit(b[3], 3);
+			endpointBits = 10;
+			deltaBits = {5, 5, 5};
+			break;
+		case 0b01:
+			bit(g[2], 5), bit(g[3], 4), bit(g[3], 5), bits(r[0], 7), bit(b[3], 0), bit(b[3], 1), bit(b[2], 4), bits(g[0], 7), bit(b[2], 5), bit(b[3], 2), bit(g[2], 4), bits(b[0], 7), bit(b[3], 3), bit(b[3], 5), bit(b[3], 4), bits(r[1], 6), bits(g[2], 4), bits(g[1], 6),
+			  bits(g[3], 4), bits(b[1], 6), bits(b[2], 4), bits(r[2], 6), bits(r[3], 6);
+			endpointBits = 7;
+			deltaBits = {6, 6, 6};
+			break;
+		case 0b00010:
+			bits(r[0], 10), bits(g[0], 10), bits(b[0], 10), bits(r[1], 5), bit(r[0], 10), bits(g[2], 4), bits(g[1], 4), bit(g[0], 10), bit(b[3], 0), bits(g[3], 4), bits(b[1], 4), bit(b[0], 10), bit(b[3], 1), bits(b[2], 4), bits(r[2], 5), bit(b[3], 2), bits(r[3], 5), bit(b[3], 3);
+			endpointBits = 11;
+			deltaBits = {5, 4, 4};
+			break;
+		case 0b00110:
+			bits(r[0], 10), bits(g[0], 10), bits(b[0], 10), bits(r[1], 4), bit(r[0], 10), bit(g[3], 4), bits(g[2], 4), bits(g[1], 5), bit(g[0], 10), bits(g[3], 4), bits(b[1], 4), bit(b[0], 10), bit(b[3], 1), bits(b[2], 4), bits(r[2], 4), bit(b[3], 0), bit(b[3], 2), bits(r[3], 4),
+			  bit(g[2], 4), bit(b[3], 3);
+			endpointBits = 11;
+			deltaBits = {4, 5, 4};
+			break;
+		case 0b01010:
+			bits(r[0], 10), bits(g[0], 10), bits(b[0], 10), bits(r[1], 4), bit(r[0], 10), bit(b[2], 4), bits(g[2], 4), bits(g[1], 4), bit(g[0], 10), bit(b[3], 0), bits(g[3], 4), bits(b[1], 5), bit(b[0], 10), bits(b[2], 4), bits(r[2], 4), bit(b[3], 1), bit(b[3], 2), bits(r[3], 4),
+			  bit(b[3], 4), bit(b[3], 3);
+			endpointBits = 11;
+			deltaBits = {4, 4, 5};
+			break;
+		case 0b01110:
+			bits(r[0], 9), bit(b[2], 4), bits(g[0], 9), bit(g[2], 4), bits(b[0], 9), bit(b[3], 4), bits(r[1], 5), bit(g[3], 4), bits(g[2], 4), bits(g[1], 5), bit(b[3], 0), bits(g[3], 4), bits(b[1], 5), bit(b[3], 1), bits(b[2], 4), bits(r[2], 5), bit(b[3], 2), bits(r[3], 5), bit(b[3], 3);
+			endpointBits = 9;
+			deltaBits = {5, 5, 5};
+			break;
+		case 0b10010:
+			bits(r[0], 8), bit(g[3], 4), bit(b[2], 4), bits(g[0], 8), bit(b[3], 2), bit(g[2], 4), bits(b[0], 8), bit(b[3], 3), bit(b[3], 4), bits(r[1], 6), bits(g[2], 4), bits(g[1], 5), bit(b[3], 0), bits(g[3], 4), bits(b[1], 5), bit(b[3], 1), bits(b[2], 4), bits(r[2], 6), bits(r[3], 6);
+			endpointBits = 8;
+			deltaBits = {6, 5, 5};
+			break;
+		case 0b10110:
+			bits(r[0], 8), bit(b[3], 0), bit(b[2], 4), bits(g[0], 8), bit(g[2], 5), bit(g[2], 4), bits(b[0], 8), bit(g[3], 5), bit(b[3], 4), bits(r[1], 5), bit(g[3], 4), bits(g[2], 4), bits(g[1], 6), bits(g[3], 4), bits(b[1], 5), bit(b[3], 1), bits(b[2], 4), bits(r[2], 5), bit(b[3], 2), bits(r[3], 5),
+			  bit(b[3], 3);
+			endpointBits = 8;
+			deltaBits = {5, 6, 5};
+			break;
+		case 0b11010:
+			bits(r[0], 8), bit(b[3], 1), bit(b[2], 4), bits(g[0], 8), bit(b[2], 5), bit(g[2], 4), bits(b[0], 8), bit(b[3], 5), bit(b[3], 4), bits(r[1], 5), bit(g[3], 4), bits(g[2], 4), bits(g[1], 5), bit(b[3], 0), bits(g[3], 4), bits(b[1], 6), bits(b[2], 4), bits(r[2], 5), bit(b[3], 2), bits(r[3], 5),
+			  bit(b[3], 3);
+			endpointBits = 8;
+			deltaBits = {5, 5, 6};
+			break;
+		case 0b11110:
+			bits(r[0], 6), bit(g[3], 4), bit(b[3], 0), bit(b[3], 1), bit(b[2], 4), bits(g[0], 6), bit(g[2], 5), bit(b[2], 5), bit(b[3], 2), bit(g[2], 4), bits(b[0], 6), bit(g[3], 5), bit(b[3], 3), bit(b[3], 5), bit(b[3], 4), bits(r[1], 6), bits(g[2], 4), bits(g[1], 6), bits(g[3], 4),
+			  bits(b[1], 6), bits(b[2], 4), bits(r[2], 6), bits(r[3], 6);
+			endpointBits = 6;
+			deltaBits = {6, 6, 6};
+			transformed = false;
+			break;
+		case 0b00011:
+			bits(r[0], 10), bits(g[0], 10), bits(b[0], 10), bits(r[1], 10), bits(g[1], 10), bits(b[1], 10);
+			endpointBits = 10;
+			deltaBits = {10, 10, 10};
+			transformed = false;
+			twoRegions = false;
+			break;
+		case 0b00111:
+			bits(r[0], 10), bits(g[0], 10), bits(b[0], 10), bits(r[1], 9), bit(r[0], 10), bits(g[1], 9), bit(g[0], 10), bits(b[1], 9), bit(b[0], 10);
+			endpointBits = 11;
+			deltaBits = {9, 9, 9};
+			twoRegions = false;
+			break;
+		case 0b01011:
+			bits(r[0], 10), bits(g[0], 10), bits(b[0], 10), bits(r[1], 8), reversedBits(r[0], 2, 10), bits(g[1], 8), reversedBits(g[0], 2, 10), bits(b[1], 8), reversedBits(b[0], 2, 10);
+			endpointBits = 12;
+			deltaBits = {8, 8, 8};
+			twoRegions = false;
+			break;
+		case 0b01111:
+			bits(r[0], 10), bits(g[0], 10), bits(b[0], 10), bits(r[1], 4), reversedBits(r[0], 6, 10), bits(g[1], 4), reversedBits(g[0], 6, 10), bits(b[1], 4), reversedBits(b[0], 6, 10);
+			endpointBits = 16;
+			deltaBits = {4, 4, 4};
+			twoRegions = false;
+			break;
+		default:
+			// Reserved mode
+			for(auto &px : out)
+				px = {0, 0, 0, 0};
+			return;
+		}
+		uint32_t partition = twoRegions ? reader.Read(5) : 0;
+
+		uint32_t numEndpoints = twoRegions ? 4 : 2;
+		std::array<std::array<int32_t, 4> *, 3> channels = {&r, &g, &b};
+		for(uint32_t c = 0; c < 3; ++c) {
+			auto &e = *channels[c];
+			if(isSigned)
+				e[0] = sign_extend(e[0], endpointBits);
+			for(uint32_t i = 1; i < numEndpoints; ++i) {
+				if(transformed) {
+					e[i] = (e[0] + sign_extend(e[i], deltaBits[c])) & ((1 << endpointBits) - 1);
+					if(isSigned)
+						e[i] = sign_extend(e[i], endpointBits);
+				}
+				else if(isSigned)
+					e[i] = sign_extend(e[i], endpointBits);
+			}
+			for(uint32_t i = 0; i < numEndpoints; ++i)
+				e[i] = unquantize_bc6h(e[i], endpointBits, isSigned);
+		}
+
+		auto indexBits = twoRegions ? 3u : 4u;
+		auto *weights = get_weights(indexBits);
+		for(uint32_t i = 0; i < 16; ++i) {
+			auto region = twoRegions ? get_subset(2, partition, i) : 0;
+			auto anchor = (i == 0) || (twoRegions && i == ANCHORS2[partition]);
+			auto index = reader.Read(anchor ? indexBits - 1 : indexBits);
+			auto w = weights[index];
+			for(uint32_t c = 0; c < 3; ++c) {
+				auto &e = *channels[c];
+				auto v = (e[region * 2] * (64 - w) + e[region * 2 + 1] * w + 32) >> 6;
+				out[i][c] = finish_unquantize_bc6h(v, isSigned);
+			}
+			out[i][3] = 0x3C00;
+		}
+	}
+
+	////////// ETC1 / ETC2 / EAC
+
+	static constexpr std::array<std::array<int32_t, 2>, 8> ETC1_MODIFIERS {{{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}}};
+	static constexpr std::array<int32_t, 8> ETC2_DISTANCES = {3, 6, 11, 16, 23, 32, 41, 64};
+	static constexpr std::array<std::array<int32_t, 8>, 16> EAC_MODIFIERS {{
+	  {-3, -6, -9, -15, 2, 5, 8, 14},
+	  {-3, -7, -10, -13, 2, 6, 9, 12},
+	  {-2, -5, -8, -13, 1, 4, 7, 12},
+	  {-2, -4, -6, -13, 1, 3, 5, 12},
+	  {-3, -6, -8, -12, 2, 5, 7, 11},
+	  {-3, -7, -9, -11, 2, 6, 8, 10},
+	  {-4, -7, -8, -11, 3, 6, 7, 10},
+	  {-3, -5, -8, -11, 2, 4, 7, 10},
+	  {-2, -6, -8, -10, 1, 5, 7, 9},
+	  {-2, -5, -8, -10, 1, 4, 7, 9},
+	  {-2, -4, -8, -10, 1, 3, 7, 9},
+	  {-2, -5, -7, -10, 1, 4, 6, 9},
+	  {-3, -4, -7, -10, 2, 3, 6, 9},
+	  {-1, -2, -3, -10, 0, 1, 2, 9},
+	  {-4, -6, -8, -9, 3, 5, 7, 8},
+	  {-3, -5, -7, -9, 2, 4, 6, 8},
+	}};
+	static uint64_t read_big_endian(const uint8_t *src)
+	{
+		uint64_t v = 0;
+		for(uint32_t i = 0; i < 8; ++i)
+			v = (v << 8) | src[i];
+		return v;
+	}
+	static uint8_t extend4(uint32_t v) { return static_cast<uint8_t>((v << 4) | v); }
+	static uint8_t extend7(uint32_t v) { return static_cast<uint8_t>((v << 1) | (v >> 6)); }
+	static uint8_t clamp255(int32_t v) { return static_cast<uint8_t>(std::clamp(v, 0, 255)); }
+	static Rgba offset_color(const Rgba &c, int32_t d) { return {clamp255(c[0] + d), clamp255(c[1] + d), clamp255(c[2] + d), 255}; }
+
+	// Pixel indices are stored in column-major order. etc2 enables the T, H and planar modes, punchThrough selects the
+	// ETC2 RGB8A1 interpretation of the differential bit.
+	static void decode_etc_rgb(const uint8_t *src, bool etc2, bool punchThrough, RgbaBlock &out)
+	{
+		auto block = read_big_endian(src);
+		auto diffBit = (block >> 33) & 1;
+		auto flip = (block >> 32) & 1;
+		// In RGB8A1 blocks the differential bit is the opaque bit instead and the differential mode is always used
+		auto differential = punchThrough || diffBit;
+		auto opaque = !punchThrough || diffBit;
+		auto getPaletteIndex = [block](uint32_t i) { return static_cast<uint32_t>((((block >> (16 + i)) & 1) << 1) | ((block >> i) & 1)); };
+		auto writePixel = [&out](uint32_t i, const Rgba &color) { out[(i & 3) * 4 + (i >> 2)] = color; };
+
+		std::array<Rgba, 2> baseColors;
+		if(differential) {
+			int32_t r = static_cast<int32_t>((block >> 59) & 31), g = static_cast<int32_t>((block >> 51) & 31), b = static_cast<int32_t>((block >> 43) & 31);
+			int32_t dr = sign_extend(static_cast<int32_t>((block >> 56) & 7), 3), dg = sign_extend(static_cast<int32_t>((block >> 48) & 7), 3), db = sign_extend(static_cast<int32_t>((block >> 40) & 7), 3);
+			if(etc2 && (r + dr < 0 || r + dr > 31 || g + dg < 0 || g + dg > 31)) {
+				// T or H mode
+				std::array<Rgba, 4> paint;
+				auto tMode = (r + dr < 0 || r + dr > 31);
+				if(tMode) {
+					Rgba c0 = {extend4((((block >> 59) & 3) << 2) | ((block >> 56) & 3)), extend4((block >> 52) & 15), extend4((block >> 48) & 15), 255};
+					Rgba c1 = {extend4((block >> 44) & 15), extend4((block >> 40) & 15), extend4((block >> 36) & 15), 255};
+					auto d = ETC2_DISTANCES[(((block >> 34) & 3) << 1) | ((block >> 32) & 1)];
+					paint = {c0, offset_color(c1, d), c1, offset_color(c1, -d)};
+				}
+				else {
+					uint32_t r0 = (block >> 59) & 15, g0 = (((block >> 56) & 7) << 1) | ((block >> 52) & 1), b0 = (((block >> 51) & 1) << 3) | ((block >> 47) & 7);
+					uint32_t r1 = (block >> 43) & 15, g1 = (block >> 39) & 15, b1 = (block >> 35) & 15;
+					auto v0 = (r0 << 8) | (g0 << 4) | b0;
+					auto v1 = (r1 << 8) | (g1 << 4) | b1;
+					auto d = ETC2_DISTANCES[(((block >> 34) & 1) << 2) | (((block >> 32) & 1) << 1) | ((v0 >= v1) ? 1 : 0)];
+					Rgba c0 = {extend4(r0), extend4(g0), extend4(b0), 255};
+					Rgba c1 = {extend4(r1), extend4(g1), extend4(b1), 255};
+					paint = {offset_color(c0, d), offset_color(c0, -d), offset_color(c1, d), offset_color(c1, -d)};
+				}
+				for(uint32_t i = 0; i < 16; ++i) {
+					auto idx = getPaletteIndex(i);
+					writePixel(i, (!opaque && idx == 2) ? Rgba {0, 0, 0, 0} : paint[idx]);
+				}
+				return;
+			}
+			if(etc2 && (b + db < 0 || b + db > 31)) {
+				// Planar mode
+				auto ro = extend6((block >> 57) & 63), go = extend7((((block >> 56) & 1) << 6) | ((block >> 49) & 63));
+				auto bo = extend6((((block >> 48) & 1) << 5) | (((block >> 43) & 3) << 3) | ((block >> 39) & 7));
+				auto rh = extend6((((block >> 34) & 31) << 1) | ((block >> 32) & 1)), gh = extend7((block >> 25) & 127), bh = extend6((block >> 19) & 63);
+				auto rv = extend6((block >> 13) & 63), gv = extend7((block >> 6) & 127), bv = extend6(block & 63);
+				for(uint32_t y = 0; y < 4; ++y) {
+					for(uint32_t x = 0; x < 4; ++x) {
+						auto interpolate = [x, y](int32_t o, int32_t h, int32_t v) { return clamp255((static_cast<int32_t>(x) * (h - o) + static_cast<int32_t>(y) * (v - o) + 4 * o + 2) >> 2); };
+						out[y * 4 + x] = {interpolate(ro, rh, rv), interpolate(go, gh, gv), interpolate(bo, bh, bv), 255};
+					}
+				}
+				return;
+			}
+			baseColors[0] = {extend5(r), extend5(g), extend5(b), 255};
+			baseColors[1] = {extend5(r + dr), extend5(g + dg), extend5(b + db), 255};
+		}
+		else {
+			baseColors[0] = {extend4((block >> 60) & 15), extend4((block >> 52) & 15), extend4((block >> 44) & 15), 255};
+			baseColors[1] = {extend4((block >> 56) & 15), extend4((block >> 48) & 15), extend4((block >> 40) & 15), 255};
+		}
+		std::array<uint32_t, 2> tables = {static_cast<uint32_t>((block >> 37) & 7), static_cast<uint32_t>((block >> 34) & 7)};
+		for(uint32_t i = 0; i < 16; ++i) {
+			auto x = i >> 2;
+			auto y = i & 3;
+			auto subblock = flip ? (y >= 2) : (x >= 2);
+			auto idx = getPaletteIndex(i);
+			if(!opaque && idx == 2) {
+				writePixel(i, {0, 0, 0, 0});
+				continue;
+			}
+			auto modifier = ETC1_MODIFIERS[tables[subblock]][idx & 1];
+			if(idx & 2)
+				modifier = -modifier;
+			else if(!opaque && idx == 0)
+				modifier = 0;
+			writePixel(i, offset_color(baseColors[subblock], modifier));
+		}
+	}
+	// Writes 8-bit values, 11-bit blocks are rescaled
+	static void decode_eac(const uint8_t *src, bool elevenBit, std::array<uint8_t, 16> &out)
+	{
+		auto block = read_big_endian(src);
+		int32_t base = static_cast<int32_t>(block >> 56);
+		int32_t multiplier = static_cast<int32_t>((block >> 52) & 15);
+		auto &modifiers = EAC_MODIFIERS[(block >> 48) & 15];
+		for(uint32_t i = 0; i < 16; ++i) {
+			auto modifier = modifiers[(block >> (45 - i * 3)) & 7];
+			uint8_t v;
+			if(elevenBit) {
+				auto v11 = std::clamp(base * 8 + 4 + modifier * ((multiplier == 0) ? 1 : multiplier * 8), 0, 2047);
+				v = static_cast<uint8_t>((v11 * 255 + 1023) / 2047);
+			}
+			else
+				v = clamp255(base + modifier * multiplier);
+			out[(i & 3) * 4 + (i >> 2)] = v;
+		}
+	}
+
+	// Decodes the block at src into numChannels values per pixel (or four half values for BC6H)
+	static void decode_block(pragma::image::TextureFileFormat format, const uint8_t *src, uint8_t *dst, uint32_t dstPixelSize)
+	{
+		using pragma::image::TextureFileFormat;
+		RgbaBlock rgba;
+		std::array<uint8_t, 16> channel;
+		auto writeRgba = [&rgba, dst]() { std::memcpy(dst, rgba.data(), sizeof(rgba)); };
+		auto writeChannel = [&channel, dst, dstPixelSize](uint32_t offset) {
+			for(uint32_t i = 0; i < 16; ++i)
+				dst[i * dstPixelSize + offset] = channel[i];
+		};
+		switch(format) {
+		case TextureFileFormat::BC1:
+			decode_bc1_color(src, false, 255, rgba);
+			writeRgba();
+			break;
+		case TextureFileFormat::BC1a:
+			decode_bc1_color(src, false, 0, rgba);
+			writeRgba();
+			break;
+		case TextureFileFormat::BC2:
+			decode_bc1_color(src + 8, true, 255, rgba);
+			writeRgba();
+			decode_bc2_alpha(src, channel);
+			writeChannel(3);
+			break;
+		case TextureFileFormat::BC3:
+			decode_bc1_color(src + 8, true, 255, rgba);
+			writeRgba();
+			decode_bc4_channel(src, channel);
+			writeChannel(3);
+			break;
+		case TextureFileFormat::BC4:
+			decode_bc4_channel(src, channel);
+			writeChannel(0);
+			break;
+		case TextureFileFormat::BC5:
+			decode_bc4_channel(src, channel);
+			writeChannel(0);
+			decode_bc4_channel(src + 8, channel);
+			writeChannel(1);
+			break;
+		case TextureFileFormat::BC6H:
+		case TextureFileFormat::BC6H_Signed:
+			{
+				std::array<std::array<uint16_t, 4>, 16> halfs;
+				decode_bc6h(src, format == TextureFileFormat::BC6H_Signed, halfs);
+				std::memcpy(dst, halfs.data(), sizeof(halfs));
+				break;
+			}
+		case TextureFileFormat::BC7:
+			decode_bc7(src, rgba);
+			writeRgba();
+			break;
+		case TextureFileFormat::ETC1:
+			decode_etc_rgb(src, false, false, rgba);
+			writeRgba();
+			break;
+		case TextureFileFormat::ETC2_RGB:
+			decode_etc_rgb(src, true, false, rgba);
+			writeRgba();
+			break;
+		case TextureFileFormat::ETC2_RGB_A1:
+			decode_etc_rgb(src, true, true, rgba);
+			writeRgba();
+			break;
+		case TextureFileFormat::ETC2_RGBA:
+			decode_etc_rgb(src + 8, true, false, rgba);
+			writeRgba();
+			decode_eac(src, false, channel);
+			writeChannel(3);
+			break;
+		case TextureFileFormat::EAC_R11:
+			decode_eac(src, true, channel);
+			writeChannel(0);
+			break;
+		case TextureFileFormat::EAC_RG11:
+			decode_eac(src, true, channel);
+			writeChannel(0);
+			decode_eac(src + 8, true, channel);
+			writeChannel(1);
+			break;
+		default:
+			break;
+		}
+	}
+};
+
+std::shared_ptr<pragma::image::ImageBuffer> pragma::image::decode_surface(TextureFileFormat format, std::span<const uint8_t> data, uint32_t width, uint32_t height, uint32_t rowPitch)
+{
+	auto decodedFormat = get_decoded_format(format);
+	if(!decodedFormat || width == 0 || height == 0)
+		return nullptr;
+	auto [bw, bh] = get_block_extent(format);
+	auto blocksX = (width + bw - 1) / bw;
+	auto blocksY = (height + bh - 1) / bh;
+	auto blockSize = get_block_size(format);
+	auto minRowPitch = blocksX * blockSize;
+	if(rowPitch == 0 || is_compressed_format(format))
+		rowPitch = minRowPitch;
+	if(rowPitch < minRowPitch || data.size() < static_cast<size_t>(rowPitch) * (blocksY - 1) + minRowPitch)
+		return nullptr;
+	auto img = ImageBuffer::Create(width, height, *decodedFormat);
+	auto *dst = static_cast<uint8_t *>(img->GetData());
+	auto pixelSize = static_cast<uint32_t>(ImageBuffer::GetPixelSize(*decodedFormat));
+	auto rowSize = static_cast<size_t>(width) * pixelSize;
+	if(!is_compressed_format(format)) {
+		if(rowPitch == rowSize)
+			std::memcpy(dst, data.data(), rowSize * height);
+		else {
+			for(uint32_t y = 0; y < height; ++y)
+				std::memcpy(dst + y * rowSize, data.data() + static_cast<size_t>(y) * rowPitch, rowSize);
+		}
+		if(format == TextureFileFormat::BGRA8) {
+			for(size_t i = 0; i < static_cast<size_t>(width) * height; ++i)
+				std::swap(dst[i * 4], dst[i * 4 + 2]);
+		}
+		return img;
+	}
+	pragma::image::parallel_for(blocksY, [&](uint32_t by) {
+		// Blocks are decoded into a 4x4 buffer first, partial blocks at the edges are cropped when copying
+		std::array<uint8_t, 16 * 8> block;
+		auto rows = std::min(4u, height - by * 4);
+		for(uint32_t bx = 0; bx < blocksX; ++bx) {
+			decoder::decode_block(format, data.data() + (static_cast<size_t>(by) * blocksX + bx) * blockSize, block.data(), pixelSize);
+			auto cols = std::min(4u, width - bx * 4);
+			for(uint32_t y = 0; y < rows; ++y)
+				std::memcpy(dst + (static_cast<size_t>(by) * 4 + y) * rowSize + static_cast<size_t>(bx) * 4 * pixelSize, block.data() + y * 4 * pixelSize, cols * pixelSize);
+		}
+	});
+	return img;
+}
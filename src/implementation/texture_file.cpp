@@ -0,0 +1,842 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module;
+
+#include <zlib.h>
+#ifdef UIMG_ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+module pragma.image;
+
+import :buffer;
+import :texture_file;
+import :thread_pool;
+import pragma.filesystem;
+
+bool pragma::image::is_compressed_format(TextureFileFormat format) { return pragma::math::to_integral(format) >= pragma::math::to_integral(TextureFileFormat::CompressedFirst) && pragma::math::to_integral(format) <= pragma::math::to_integral(TextureFileFormat::CompressedLast); }
+
+uint32_t pragma::image::get_block_size(TextureFileFormat format)
+{
+	switch(format) {
+	case TextureFileFormat::R8:
+		return 1;
+	case TextureFileFormat::RG8:
+		return 2;
+	case TextureFileFormat::RGB8:
+		return 3;
+	case TextureFileFormat::RGBA8:
+	case TextureFileFormat::BGRA8:
+	case TextureFileFormat::R32F:
+		return 4;
+	case TextureFileFormat::RGBA16F:
+		return 8;
+	case TextureFileFormat::RGBA32F:
+		return 16;
+	case TextureFileFormat::BC1:
+	case TextureFileFormat::BC1a:
+	case TextureFileFormat::BC4:
+	case TextureFileFormat::ETC1:
+	case TextureFileFormat::EAC_R11:
+	case TextureFileFormat::ETC2_RGB:
+	case TextureFileFormat::ETC2_RGB_A1:
+		return 8;
+	case TextureFileFormat::BC2:
+	case TextureFileFormat::BC3:
+	case TextureFileFormat::BC5:
+	case TextureFileFormat::BC6H:
+	case TextureFileFormat::BC6H_Signed:
+	case TextureFileFormat::BC7:
+	case TextureFileFormat::EAC_RG11:
+	case TextureFileFormat::ETC2_RGBA:
+	case TextureFileFormat::ASTC_4x4:
+	case TextureFileFormat::ASTC_5x4:
+	case TextureFileFormat::ASTC_5x5:
+	case TextureFileFormat::ASTC_6x5:
+	case TextureFileFormat::ASTC_6x6:
+	case TextureFileFormat::ASTC_8x5:
+	case TextureFileFormat::ASTC_8x6:
+	case TextureFileFormat::ASTC_8x8:
+		return 16;
+	default:
+		break;
+	}
+	static_assert(pragma::math::to_integral(TextureFileFormat::Count) == 32);
+	return 0;
+}
+
+std::pair<uint32_t, uint32_t> pragma::image::get_block_extent(TextureFileFormat format)
+{
+	switch(format) {
+	case TextureFileFormat::ASTC_5x4:
+		return {5, 4};
+	case TextureFileFormat::ASTC_5x5:
+		return {5, 5};
+	case TextureFileFormat::ASTC_6x5:
+		return {6, 5};
+	case TextureFileFormat::ASTC_6x6:
+		return {6, 6};
+	case TextureFileFormat::ASTC_8x5:
+		return {8, 5};
+	case TextureFileFormat::ASTC_8x6:
+		return {8, 6};
+	case TextureFileFormat::ASTC_8x8:
+		return {8, 8};
+	default:
+		break;
+	}
+	return is_compressed_format(format) ? std::pair<uint32_t, uint32_t> {4, 4} : std::pair<uint32_t, uint32_t> {1, 1};
+}
+
+std::optional<pragma::image::Format> pragma::image::get_decoded_format(TextureFileFormat format)
+{
+	switch(format) {
+	case TextureFileFormat::R8:
+	case TextureFileFormat::BC4:
+	case TextureFileFormat::EAC_R11:
+		return Format::R8;
+	case TextureFileFormat::RG8:
+	case TextureFileFormat::BC5:
+	case TextureFileFormat::EAC_RG11:
+		return Format::RG8;
+	case TextureFileFormat::RGB8:
+		return Format::RGB8;
+	case TextureFileFormat::RGBA8:
+	case TextureFileFormat::BGRA8:
+	case TextureFileFormat::BC1:
+	case TextureFileFormat::BC1a:
+	case TextureFileFormat::BC2:
+	case TextureFileFormat::BC3:
+	case TextureFileFormat::BC7:
+	case TextureFileFormat::ETC1:
+	case TextureFileFormat::ETC2_RGB:
+	case TextureFileFormat::ETC2_RGB_A1:
+	case TextureFileFormat::ETC2_RGBA:
+		return Format::RGBA8;
+	case TextureFileFormat::RGBA16F:
+	case TextureFileFormat::BC6H:
+	case TextureFileFormat::BC6H_Signed:
+		return Format::RGBA16;
+	case TextureFileFormat::R32F:
+		return Format::R32;
+	case TextureFileFormat::RGBA32F:
+		return Format::RGBA32;
+	default:
+		break;
+	}
+	return {};
+}
+
+uint32_t pragma::image::get_vk_format(TextureFileFormat format, bool srgb)
+{
+	auto select = [srgb](uint32_t unormFormat, uint32_t srgbFormat) { return srgb ? srgbFormat : unormFormat; };
+	switch(format) {
+	case TextureFileFormat::R8:
+		return select(9 /* VK_FORMAT_R8_UNORM */, 15);
+	case TextureFileFormat::RG8:
+		return select(16 /* VK_FORMAT_R8G8_UNORM */, 22);
+	case TextureFileFormat::RGB8:
+		return select(23 /* VK_FORMAT_R8G8B8_UNORM */, 29);
+	case TextureFileFormat::RGBA8:
+		return select(37 /* VK_FORMAT_R8G8B8A8_UNORM */, 43);
+	case TextureFileFormat::BGRA8:
+		return select(44 /* VK_FORMAT_B8G8R8A8_UNORM */, 50);
+	case TextureFileFormat::RGBA16F:
+		return 97; // VK_FORMAT_R16G16B16A16_SFLOAT
+	case TextureFileFormat::R32F:
+		return 100; // VK_FORMAT_R32_SFLOAT
+	case TextureFileFormat::RGBA32F:
+		return 109; // VK_FORMAT_R32G32B32A32_SFLOAT
+	case TextureFileFormat::BC1:
+		return select(131 /* VK_FORMAT_BC1_RGB_UNORM_BLOCK */, 132);
+	case TextureFileFormat::BC1a:
+		return select(133 /* VK_FORMAT_BC1_RGBA_UNORM_BLOCK */, 134);
+	case TextureFileFormat::BC2:
+		return select(135 /* VK_FORMAT_BC2_UNORM_BLOCK */, 136);
+	case TextureFileFormat::BC3:
+		return select(137 /* VK_FORMAT_BC3_UNORM_BLOCK */, 138);
+	case TextureFileFormat::BC4:
+		return 139; // VK_FORMAT_BC4_UNORM_BLOCK
+	case TextureFileFormat::BC5:
+		return 141; // VK_FORMAT_BC5_UNORM_BLOCK
+	case TextureFileFormat::BC6H:
+		return 143; // VK_FORMAT_BC6H_UFLOAT_BLOCK
+	case TextureFileFormat::BC6H_Signed:
+		return 144; // VK_FORMAT_BC6H_SFLOAT_BLOCK
+	case TextureFileFormat::BC7:
+		return select(145 /* VK_FORMAT_BC7_UNORM_BLOCK */, 146);
+	case TextureFileFormat::ETC1:
+	case TextureFileFormat::ETC2_RGB:
+		return select(147 /* VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK */, 148);
+	case TextureFileFormat::ETC2_RGB_A1:
+		return select(149 /* VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK */, 150);
+	case TextureFileFormat::ETC2_RGBA:
+		return select(151 /* VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK */, 152);
+	case TextureFileFormat::EAC_R11:
+		return 153; // VK_FORMAT_EAC_R11_UNORM_BLOCK
+	case TextureFileFormat::EAC_RG11:
+		return 155; // VK_FORMAT_EAC_R11G11_UNORM_BLOCK
+	case TextureFileFormat::ASTC_4x4:
+	case TextureFileFormat::ASTC_5x4:
+	case TextureFileFormat::ASTC_5x5:
+	case TextureFileFormat::ASTC_6x5:
+	case TextureFileFormat::ASTC_6x6:
+	case TextureFileFormat::ASTC_8x5:
+	case TextureFileFormat::ASTC_8x6:
+	case TextureFileFormat::ASTC_8x8:
+		// VK_FORMAT_ASTC_4x4_UNORM_BLOCK to VK_FORMAT_ASTC_8x8_SRGB_BLOCK, each block size is followed by its sRGB variant
+		return 157 + (pragma::math::to_integral(format) - pragma::math::to_integral(TextureFileFormat::ASTC_4x4)) * 2 + (srgb ? 1 : 0);
+	default:
+		break;
+	}
+	static_assert(pragma::math::to_integral(TextureFileFormat::Count) == 32);
+	return 0;
+}
+
+const pragma::image::TextureFileSurface &pragma::image::TextureFileInfo::GetSurface(uint32_t layer, uint32_t mipmap) const { return surfaces[layer * numMipmaps + mipmap]; }
+
+namespace texture_file {
+	template<typename T>
+	static T read_value(std::span<const uint8_t> data, size_t offset)
+	{
+		T value;
+		std::memcpy(&value, data.data() + offset, sizeof(T));
+		return value;
+	}
+	static constexpr uint32_t make_four_cc(char a, char b, char c, char d) { return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24); }
+	// rowAlignment is the alignment of rows of uncompressed data in bytes
+	static void add_surface(pragma::image::TextureFileInfo &info, uint32_t layer, uint32_t mipmap, size_t offset, uint32_t rowAlignment = 1)
+	{
+		using namespace pragma::image;
+		auto [bw, bh] = get_block_extent(info.format);
+		TextureFileSurface surface {};
+		surface.layer = layer;
+		surface.mipmap = mipmap;
+		surface.width = std::max(info.width >> mipmap, 1u);
+		surface.height = std::max(info.height >> mipmap, 1u);
+		surface.offset = offset;
+		surface.rowPitch = (surface.width + bw - 1) / bw * get_block_size(info.format);
+		if(!is_compressed_format(info.format))
+			surface.rowPitch = (surface.rowPitch + rowAlignment - 1) / rowAlignment * rowAlignment;
+		surface.size = static_cast<size_t>(surface.rowPitch) * ((surface.height + bh - 1) / bh);
+		info.surfaces.push_back(surface);
+	}
+	// Validates the extent, mipmap and layer counts of a header and sets the layer count. This has to happen before any surfaces are added,
+	// since these values are untrusted and determine the number of surfaces as well as the shift amounts and row pitches of the mipmaps.
+	static bool validate_header(pragma::image::TextureFileInfo &info, uint32_t numArrayLayers, uint32_t numFaces, size_t dataSize)
+	{
+		constexpr uint32_t maxMipmaps = 32;
+		if(info.numMipmaps > maxMipmaps || info.numMipmaps > pragma::image::calculate_mipmap_count(info.width, info.height))
+			return false;
+		auto [bw, bh] = pragma::image::get_block_extent(info.format);
+		// Leaves room for rows that are padded to four bytes
+		if((static_cast<uint64_t>(info.width) + bw - 1) / bw * pragma::image::get_block_size(info.format) > std::numeric_limits<uint32_t>::max() - 3 || static_cast<uint64_t>(info.height) + bh - 1 > std::numeric_limits<uint32_t>::max())
+			return false;
+		auto numLayers = static_cast<uint64_t>(numArrayLayers) * numFaces;
+		if(numLayers > std::numeric_limits<uint32_t>::max())
+			return false;
+		// Every surface occupies at least one byte of the file unless it is supercompressed
+		if(info.supercompression == pragma::image::TextureFileSupercompression::None && numLayers * info.numMipmaps > dataSize)
+			return false;
+		info.numLayers = static_cast<uint32_t>(numLayers);
+		return true;
+	}
+	// Surfaces are added by mipmap first in the KTX layout, this restores the layer-major order
+	static void sort_surfaces(pragma::image::TextureFileInfo &info)
+	{
+		std::sort(info.surfaces.begin(), info.surfaces.end(), [](const pragma::image::TextureFileSurface &a, const pragma::image::TextureFileSurface &b) { return (a.layer != b.layer) ? (a.layer < b.layer) : (a.mipmap < b.mipmap); });
+	}
+
+	// See https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dx-graphics-dds-pguide
+	namespace dds {
+		constexpr uint32_t HEADER_OFFSET = 4;
+		constexpr uint32_t HEADER_SIZE = 124;
+		constexpr uint32_t HEADER_DX10_SIZE = 20;
+		constexpr uint32_t DDPF_FOURCC = 0x4;
+		constexpr uint32_t DDPF_RGB = 0x40;
+		constexpr uint32_t DDPF_LUMINANCE = 0x20000;
+		constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+		constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+		constexpr uint32_t RESOURCE_MISC_TEXTURECUBE = 0x4;
+		constexpr uint32_t RESOURCE_DIMENSION_TEXTURE3D = 4;
+
+		static bool get_dxgi_format(uint32_t dxgiFormat, pragma::image::TextureFileFormat &outFormat, bool &outSrgb)
+		{
+			using pragma::image::TextureFileFormat;
+			outSrgb = false;
+			switch(dxgiFormat) {
+			case 2: // DXGI_FORMAT_R32G32B32A32_FLOAT
+				outFormat = TextureFileFormat::RGBA32F;
+				break;
+			case 10: // DXGI_FORMAT_R16G16B16A16_FLOAT
+				outFormat = TextureFileFormat::RGBA16F;
+				break;
+			case 29: // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+				outSrgb = true;
+				[[fallthrough]];
+			case 28: // DXGI_FORMAT_R8G8B8A8_UNORM
+				outFormat = TextureFileFormat::RGBA8;
+				break;
+			case 41: // DXGI_FORMAT_R32_FLOAT
+				outFormat = TextureFileFormat::R32F;
+				break;
+			case 49: // DXGI_FORMAT_R8G8_UNORM
+				outFormat = TextureFileFormat::RG8;
+				break;
+			case 61: // DXGI_FORMAT_R8_UNORM
+				outFormat = TextureFileFormat::R8;
+				break;
+			case 72: // DXGI_FORMAT_BC1_UNORM_SRGB
+				outSrgb = true;
+				[[fallthrough]];
+			case 71: // DXGI_FORMAT_BC1_UNORM
+				outFormat = TextureFileFormat::BC1a;
+				break;
+			case 75: // DXGI_FORMAT_BC2_UNORM_SRGB
+				outSrgb = true;
+				[[fallthrough]];
+			case 74: // DXGI_FORMAT_BC2_UNORM
+				outFormat = TextureFileFormat::BC2;
+				break;
+			case 78: // DXGI_FORMAT_BC3_UNORM_SRGB
+				outSrgb = true;
+				[[fallthrough]];
+			case 77: // DXGI_FORMAT_BC3_UNORM
+				outFormat = TextureFileFormat::BC3;
+				break;
+			case 80: // DXGI_FORMAT_BC4_UNORM
+				outFormat = TextureFileFormat::BC4;
+				break;
+			case 83: // DXGI_FORMAT_BC5_UNORM
+				outFormat = TextureFileFormat::BC5;
+				break;
+			case 91: // DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
+				outSrgb = true;
+				[[fallthrough]];
+			case 87: // DXGI_FORMAT_B8G8R8A8_UNORM
+				outFormat = TextureFileFormat::BGRA8;
+				break;
+			case 95: // DXGI_FORMAT_BC6H_UF16
+				outFormat = TextureFileFormat::BC6H;
+				break;
+			case 96: // DXGI_FORMAT_BC6H_SF16
+				outFormat = TextureFileFormat::BC6H_Signed;
+				break;
+			case 99: // DXGI_FORMAT_BC7_UNORM_SRGB
+				outSrgb = true;
+				[[fallthrough]];
+			case 98: // DXGI_FORMAT_BC7_UNORM
+				outFormat = TextureFileFormat::BC7;
+				break;
+			default:
+				{
+					// DXGI_FORMAT_ASTC_4X4_UNORM to DXGI_FORMAT_ASTC_8X8_UNORM_SRGB, the formats of each block size are four values apart
+					constexpr uint32_t astcFirst = 134;
+					constexpr uint32_t astcLast = 163;
+					if(dxgiFormat < astcFirst || dxgiFormat > astcLast)
+						return false;
+					auto idx = dxgiFormat - astcFirst;
+					if((idx % 4) > 1)
+						return false;
+					outSrgb = (idx % 4) == 1;
+					outFormat = static_cast<TextureFileFormat>(pragma::math::to_integral(TextureFileFormat::ASTC_4x4) + idx / 4);
+					break;
+				}
+			}
+			return true;
+		}
+
+		static bool get_format(std::span<const uint8_t> data, pragma::image::TextureFileFormat &outFormat, bool &outSrgb)
+		{
+			using pragma::image::TextureFileFormat;
+			constexpr uint32_t pixelFormatOffset = HEADER_OFFSET + 72;
+			auto flags = read_value<uint32_t>(data, pixelFormatOffset + 4);
+			auto fourCC = read_value<uint32_t>(data, pixelFormatOffset + 8);
+			auto bitCount = read_value<uint32_t>(data, pixelFormatOffset + 12);
+			auto redMask = read_value<uint32_t>(data, pixelFormatOffset + 16);
+			outSrgb = false;
+			if(flags & DDPF_FOURCC) {
+				switch(fourCC) {
+				case make_four_cc('D', 'X', '1', '0'):
+					return get_dxgi_format(read_value<uint32_t>(data, HEADER_OFFSET + HEADER_SIZE), outFormat, outSrgb);
+				case make_four_cc('D', 'X', 'T', '1'):
+					outFormat = TextureFileFormat::BC1a;
+					return true;
+				case make_four_cc('D', 'X', 'T', '2'):
+				case make_four_cc('D', 'X', 'T', '3'):
+					outFormat = TextureFileFormat::BC2;
+					return true;
+				case make_four_cc('D', 'X', 'T', '4'):
+				case make_four_cc('D', 'X', 'T', '5'):
+					outFormat = TextureFileFormat::BC3;
+					return true;
+				case make_four_cc('A', 'T', 'I', '1'):
+				case make_four_cc('B', 'C', '4', 'U'):
+					outFormat = TextureFileFormat::BC4;
+					return true;
+				case make_four_cc('A', 'T', 'I', '2'):
+				case make_four_cc('B', 'C', '5', 'U'):
+					outFormat = TextureFileFormat::BC5;
+					return true;
+				case make_four_cc('E', 'T', 'C', '1'):
+					outFormat = TextureFileFormat::ETC1;
+					return true;
+				case 113: // D3DFMT_A16B16G16R16F
+					outFormat = TextureFileFormat::RGBA16F;
+					return true;
+				case 114: // D3DFMT_R32F
+					outFormat = TextureFileFormat::R32F;
+					return true;
+				case 116: // D3DFMT_A32B32G32R32F
+					outFormat = TextureFileFormat::RGBA32F;
+					return true;
+				default:
+					return false;
+				}
+			}
+			if((flags & DDPF_RGB) && bitCount == 32) {
+				outFormat = (redMask == 0xFF) ? TextureFileFormat::RGBA8 : TextureFileFormat::BGRA8;
+				return redMask == 0xFF || redMask == 0xFF0000;
+			}
+			if((flags & DDPF_RGB) && bitCount == 24 && redMask == 0xFF) {
+				outFormat = TextureFileFormat::RGB8;
+				return true;
+			}
+			if((flags & DDPF_LUMINANCE) && bitCount == 8) {
+				outFormat = TextureFileFormat::R8;
+				return true;
+			}
+			return false;
+		}
+
+		static std::optional<pragma::image::TextureFileInfo> parse(std::span<const uint8_t> data)
+		{
+			using namespace pragma::image;
+			if(data.size() < HEADER_OFFSET + HEADER_SIZE || read_value<uint32_t>(data, 0) != make_four_cc('D', 'D', 'S', ' '))
+				return {};
+			TextureFileInfo info {};
+			info.containerFormat = TextureInfo::ContainerFormat::DDS;
+			info.height = read_value<uint32_t>(data, HEADER_OFFSET + 8);
+			info.width = read_value<uint32_t>(data, HEADER_OFFSET + 12);
+			info.numMipmaps = std::max(read_value<uint32_t>(data, HEADER_OFFSET + 24), 1u);
+			auto caps2 = read_value<uint32_t>(data, HEADER_OFFSET + 108);
+			auto isDx10 = (read_value<uint32_t>(data, HEADER_OFFSET + 76) & DDPF_FOURCC) && read_value<uint32_t>(data, HEADER_OFFSET + 80) == make_four_cc('D', 'X', '1', '0');
+			size_t offset = HEADER_OFFSET + HEADER_SIZE;
+			uint32_t numArrayLayers = 1;
+			if(isDx10) {
+				if(data.size() < offset + HEADER_DX10_SIZE)
+					return {};
+				auto dimension = read_value<uint32_t>(data, offset + 4);
+				auto miscFlag = read_value<uint32_t>(data, offset + 8);
+				numArrayLayers = std::max(read_value<uint32_t>(data, offset + 12), 1u);
+				if(dimension == RESOURCE_DIMENSION_TEXTURE3D)
+					return {};
+				info.cubemap = (miscFlag & RESOURCE_MISC_TEXTURECUBE) != 0;
+				offset += HEADER_DX10_SIZE;
+			}
+			else {
+				if(caps2 & DDSCAPS2_VOLUME)
+					return {};
+				info.cubemap = (caps2 & DDSCAPS2_CUBEMAP) != 0;
+			}
+			if(!get_format(data, info.format, info.srgb) || info.width == 0 || info.height == 0)
+				return {};
+			if(!validate_header(info, numArrayLayers, info.cubemap ? 6 : 1, data.size()))
+				return {};
+			info.surfaces.reserve(static_cast<size_t>(info.numLayers) * info.numMipmaps);
+			for(uint32_t l = 0; l < info.numLayers; ++l) {
+				for(uint32_t m = 0; m < info.numMipmaps; ++m) {
+					add_surface(info, l, m, offset);
+					offset += info.surfaces.back().size;
+				}
+			}
+			if(offset > data.size())
+				return {};
+			return info;
+		}
+	};
+
+	// See https://registry.khronos.org/KTX/specs/1.0/ktxspec.v1.html
+	namespace ktx {
+		constexpr std::array<uint8_t, 12> IDENTIFIER = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+		constexpr uint32_t HEADER_SIZE = 64;
+		constexpr uint32_t ENDIANNESS = 0x04030201;
+
+		static bool get_format(uint32_t glType, uint32_t glFormat, uint32_t glInternalFormat, pragma::image::TextureFileFormat &outFormat, bool &outSrgb)
+		{
+			using pragma::image::TextureFileFormat;
+			outSrgb = false;
+			if(glType != 0) {
+				// Uncompressed
+				outSrgb = (glInternalFormat == 0x8C41 /* GL_SRGB8 */ || glInternalFormat == 0x8C43 /* GL_SRGB8_ALPHA8 */);
+				constexpr uint32_t GL_UNSIGNED_BYTE = 0x1401;
+				constexpr uint32_t GL_HALF_FLOAT = 0x140B;
+				constexpr uint32_t GL_FLOAT = 0x1406;
+				switch(glFormat) {
+				case 0x1903: // GL_RED
+					outFormat = (glType == GL_FLOAT) ? TextureFileFormat::R32F : TextureFileFormat::R8;
+					return glType == GL_FLOAT || glType == GL_UNSIGNED_BYTE;
+				case 0x8227: // GL_RG
+					outFormat = TextureFileFormat::RG8;
+					return glType == GL_UNSIGNED_BYTE;
+				case 0x1907: // GL_RGB
+					outFormat = TextureFileFormat::RGB8;
+					return glType == GL_UNSIGNED_BYTE;
+				case 0x1908: // GL_RGBA
+					switch(glType) {
+					case GL_UNSIGNED_BYTE:
+						outFormat = TextureFileFormat::RGBA8;
+						return true;
+					case GL_HALF_FLOAT:
+						outFormat = TextureFileFormat::RGBA16F;
+						return true;
+					case GL_FLOAT:
+						outFormat = TextureFileFormat::RGBA32F;
+						return true;
+					default:
+						return false;
+					}
+				case 0x80E1: // GL_BGRA
+					outFormat = TextureFileFormat::BGRA8;
+					return glType == GL_UNSIGNED_BYTE;
+				default:
+					return false;
+				}
+			}
+			switch(glInternalFormat) {
+			case 0x8C4C: // GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+				outSrgb = true;
+				[[fallthrough]];
+			case 0x83F0: // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+				outFormat = TextureFileFormat::BC1;
+				return true;
+			case 0x8C4D: // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+				outSrgb = true;
+				[[fallthrough]];
+			case 0x83F1: // GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+				outFormat = TextureFileFormat::BC1a;
+				return true;
+			case 0x8C4E: // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT
+				outSrgb = true;
+				[[fallthrough]];
+			case 0x83F2: // GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+				outFormat = TextureFileFormat::BC2;
+				return true;
+			case 0x8C4F: // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+				outSrgb = true;
+				[[fallthrough]];
+			case 0x83F3: // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+				outFormat = TextureFileFormat::BC3;
+				return true;
+			case 0x8DBB: // GL_COMPRESSED_RED_RGTC1
+				outFormat = TextureFileFormat::BC4;
+				return true;
+			case 0x8DBD: // GL_COMPRESSED_RG_RGTC2
+				outFormat = TextureFileFormat::BC5;
+				return true;
+			case 0x8E8F: // GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT
+				outFormat = TextureFileFormat::BC6H;
+				return true;
+			case 0x8E8E: // GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT
+				outFormat = TextureFileFormat::BC6H_Signed;
+				return true;
+			case 0x8E8D: // GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+				outSrgb = true;
+				[[fallthrough]];
+			case 0x8E8C: // GL_COMPRESSED_RGBA_BPTC_UNORM
+				outFormat = TextureFileFormat::BC7;
+				return true;
+			case 0x8D64: // GL_ETC1_RGB8_OES
+				outFormat = TextureFileFormat::ETC1;
+				return true;
+			case 0x9270: // GL_COMPRESSED_R11_EAC
+				outFormat = TextureFileFormat::EAC_R11;
+				return true;
+			case 0x9272: // GL_COMPRESSED_RG11_EAC
+				outFormat = TextureFileFormat::EAC_RG11;
+				return true;
+			case 0x9275: // GL_COMPRESSED_SRGB8_ETC2
+				outSrgb = true;
+				[[fallthrough]];
+			case 0x9274: // GL_COMPRESSED_RGB8_ETC2
+				outFormat = TextureFileFormat::ETC2_RGB;
+				return true;
+			case 0x9277: // GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2
+				outSrgb = true;
+				[[fallthrough]];
+			case 0x9276: // GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2
+				outFormat = TextureFileFormat::ETC2_RGB_A1;
+				return true;
+			case 0x9279: // GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC
+				outSrgb = true;
+				[[fallthrough]];
+			case 0x9278: // GL_COMPRESSED_RGBA8_ETC2_EAC
+				outFormat = TextureFileFormat::ETC2_RGBA;
+				return true;
+			default:
+				break;
+			}
+			// GL_COMPRESSED_RGBA_ASTC_4x4_KHR to GL_COMPRESSED_RGBA_ASTC_8x8_KHR and their sRGB variants
+			constexpr uint32_t astcFirst = 0x93B0;
+			constexpr uint32_t astcSrgbFirst = 0x93D0;
+			constexpr uint32_t numAstcFormats = 8;
+			if(glInternalFormat >= astcFirst && glInternalFormat < astcFirst + numAstcFormats) {
+				outFormat = static_cast<TextureFileFormat>(pragma::math::to_integral(TextureFileFormat::ASTC_4x4) + (glInternalFormat - astcFirst));
+				return true;
+			}
+			if(glInternalFormat >= astcSrgbFirst && glInternalFormat < astcSrgbFirst + numAstcFormats) {
+				outSrgb = true;
+				outFormat = static_cast<TextureFileFormat>(pragma::math::to_integral(TextureFileFormat::ASTC_4x4) + (glInternalFormat - astcSrgbFirst));
+				return true;
+			}
+			return false;
+		}
+
+		static std::optional<pragma::image::TextureFileInfo> parse(std::span<const uint8_t> data)
+		{
+			using namespace pragma::image;
+			if(data.size() < HEADER_SIZE || std::memcmp(data.data(), IDENTIFIER.data(), IDENTIFIER.size()) != 0)
+				return {};
+			// Files with a foreign byte order are not supported
+			if(read_value<uint32_t>(data, 12) != ENDIANNESS)
+				return {};
+			TextureFileInfo info {};
+			info.containerFormat = TextureInfo::ContainerFormat::KTX;
+			auto glType = read_value<uint32_t>(data, 16);
+			auto glFormat = read_value<uint32_t>(data, 24);
+			auto glInternalFormat = read_value<uint32_t>(data, 28);
+			info.width = read_value<uint32_t>(data, 36);
+			info.height = std::max(read_value<uint32_t>(data, 40), 1u);
+			auto depth = read_value<uint32_t>(data, 44);
+			auto numArrayElements = read_value<uint32_t>(data, 48);
+			auto numFaces = read_value<uint32_t>(data, 52);
+			info.numMipmaps = std::max(read_value<uint32_t>(data, 56), 1u);
+			auto bytesOfKeyValueData = read_value<uint32_t>(data, 60);
+			// Only the faces of non-array cubemaps are padded individually
+			auto padFaces = (numArrayElements == 0 && numFaces == 6);
+			if(depth > 1 || (numFaces != 1 && numFaces != 6) || info.width == 0 || !get_format(glType, glFormat, glInternalFormat, info.format, info.srgb))
+				return {};
+			info.cubemap = (numFaces == 6);
+			if(!validate_header(info, std::max(numArrayElements, 1u), numFaces, data.size()))
+				return {};
+			info.surfaces.reserve(static_cast<size_t>(info.numLayers) * info.numMipmaps);
+			size_t offset = static_cast<size_t>(HEADER_SIZE) + bytesOfKeyValueData;
+			// Rows of uncompressed data are aligned to GL_UNPACK_ALIGNMENT, which is 4
+			constexpr uint32_t rowAlignment = 4;
+			for(uint32_t m = 0; m < info.numMipmaps; ++m) {
+				// Every level is preceded by its size
+				offset += sizeof(uint32_t);
+				for(uint32_t l = 0; l < info.numLayers; ++l) {
+					add_surface(info, l, m, offset, rowAlignment);
+					offset += info.surfaces.back().size;
+					if(padFaces)
+						offset = (offset + 3) & ~static_cast<size_t>(3);
+				}
+				offset = (offset + 3) & ~static_cast<size_t>(3);
+				if(offset > data.size())
+					return {};
+			}
+			sort_surfaces(info);
+			return info;
+		}
+	};
+
+	// See https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+	namespace ktx2 {
+		constexpr std::array<uint8_t, 12> IDENTIFIER = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+		constexpr uint32_t HEADER_SIZE = 80;
+		constexpr uint32_t LEVEL_INDEX_ENTRY_SIZE = 24;
+
+		static bool get_format(uint32_t vkFormat, pragma::image::TextureFileFormat &outFormat, bool &outSrgb)
+		{
+			using namespace pragma::image;
+			for(auto i = pragma::math::to_integral(TextureFileFormat::R8); i < pragma::math::to_integral(TextureFileFormat::Count); ++i) {
+				auto format = static_cast<TextureFileFormat>(i);
+				// ETC1 shares its Vulkan format with ETC2
+				if(format == TextureFileFormat::ETC1)
+					continue;
+				auto unormFormat = get_vk_format(format, false);
+				auto srgbFormat = get_vk_format(format, true);
+				if(vkFormat != unormFormat && vkFormat != srgbFormat)
+					continue;
+				outFormat = format;
+				outSrgb = (vkFormat != unormFormat);
+				return true;
+			}
+			return false;
+		}
+
+		static std::optional<pragma::image::TextureFileInfo> parse(std::span<const uint8_t> data)
+		{
+			using namespace pragma::image;
+			if(data.size() < HEADER_SIZE || std::memcmp(data.data(), IDENTIFIER.data(), IDENTIFIER.size()) != 0)
+				return {};
+			TextureFileInfo info {};
+			info.containerFormat = TextureInfo::ContainerFormat::KTX2;
+			auto vkFormat = read_value<uint32_t>(data, 12);
+			info.width = read_value<uint32_t>(data, 20);
+			info.height = std::max(read_value<uint32_t>(data, 24), 1u);
+			auto depth = read_value<uint32_t>(data, 28);
+			auto numArrayElements = std::max(read_value<uint32_t>(data, 32), 1u);
+			auto numFaces = read_value<uint32_t>(data, 36);
+			info.numMipmaps = std::max(read_value<uint32_t>(data, 40), 1u);
+			auto scheme = read_value<uint32_t>(data, 44);
+			if(depth > 1 || (numFaces != 1 && numFaces != 6) || info.width == 0 || !get_format(vkFormat, info.format, info.srgb))
+				return {};
+			// BasisLZ is not supported
+			info.supercompression = static_cast<TextureFileSupercompression>(scheme);
+			if(scheme > std::numeric_limits<uint8_t>::max() || (info.supercompression != TextureFileSupercompression::None && info.supercompression != TextureFileSupercompression::Zstd && info.supercompression != TextureFileSupercompression::Zlib))
+				return {};
+			if(data.size() < HEADER_SIZE + static_cast<size_t>(info.numMipmaps) * LEVEL_INDEX_ENTRY_SIZE)
+				return {};
+			info.cubemap = (numFaces == 6);
+			if(!validate_header(info, numArrayElements, numFaces, data.size()))
+				return {};
+			info.surfaces.reserve(static_cast<size_t>(info.numLayers) * info.numMipmaps);
+			// Supercompressed levels are decompressed into a single buffer, starting with the base level
+			size_t uncompressedOffset = 0;
+			for(uint32_t m = 0; m < info.numMipmaps; ++m) {
+				auto levelIndexOffset = HEADER_SIZE + static_cast<size_t>(m) * LEVEL_INDEX_ENTRY_SIZE;
+				TextureFileLevel level {};
+				level.offset = read_value<uint64_t>(data, levelIndexOffset);
+				level.size = read_value<uint64_t>(data, levelIndexOffset + 8);
+				level.uncompressedSize = read_value<uint64_t>(data, levelIndexOffset + 16);
+				// The layers and faces of a level are stored contiguously without padding
+				auto offset = (info.supercompression == TextureFileSupercompression::None) ? level.offset : uncompressedOffset;
+				auto levelStart = offset;
+				for(uint32_t l = 0; l < info.numLayers; ++l) {
+					add_surface(info, l, m, offset);
+					offset += info.surfaces.back().size;
+				}
+				if(offset - levelStart != level.uncompressedSize)
+					return {};
+				if(info.supercompression != TextureFileSupercompression::None) {
+					info.levels.push_back(level);
+					uncompressedOffset += level.uncompressedSize;
+				}
+			}
+			sort_surfaces(info);
+			return info;
+		}
+
+		static bool decompress(pragma::image::TextureFileSupercompression scheme, std::span<const uint8_t> src, std::span<uint8_t> dst)
+		{
+			using pragma::image::TextureFileSupercompression;
+			switch(scheme) {
+			case TextureFileSupercompression::Zstd:
+				{
+#ifdef UIMG_ENABLE_ZSTD
+					auto size = ZSTD_decompress(dst.data(), dst.size(), src.data(), src.size());
+					return !ZSTD_isError(size) && size == dst.size();
+#else
+					return false;
+#endif
+				}
+			case TextureFileSupercompression::Zlib:
+				{
+					auto size = static_cast<uLongf>(dst.size());
+					return uncompress(dst.data(), &size, src.data(), static_cast<uLong>(src.size())) == Z_OK && size == dst.size();
+				}
+			default:
+				break;
+			}
+			return false;
+		}
+	};
+};
+
+std::optional<pragma::image::TextureFileInfo> pragma::image::parse_texture_file(std::span<const uint8_t> data)
+{
+	auto info = texture_file::dds::parse(data);
+	if(!info)
+		info = texture_file::ktx::parse(data);
+	if(!info)
+		info = texture_file::ktx2::parse(data);
+	if(!info)
+		return {};
+	// The offsets are read from the file, so the ranges are checked without adding them up
+	auto isInRange = [&data](size_t offset, size_t size) { return offset <= data.size() && size <= data.size() - offset; };
+	for(auto &level : info->levels) {
+		if(!isInRange(level.offset, level.size))
+			return {};
+	}
+	if(info->supercompression == TextureFileSupercompression::None) {
+		for(auto &surface : info->surfaces) {
+			if(!isInRange(surface.offset, surface.size))
+				return {};
+		}
+	}
+	return info;
+}
+
+std::optional<std::vector<uint8_t>> pragma::image::decompress_texture_file(std::span<const uint8_t> data, const TextureFileInfo &info, size_t maxSize)
+{
+	if(info.supercompression == TextureFileSupercompression::None)
+		return {};
+	std::vector<size_t> offsets;
+	offsets.reserve(info.levels.size());
+	size_t size = 0;
+	for(auto &level : info.levels) {
+		if(level.offset > data.size() || level.size > data.size() - level.offset || level.uncompressedSize > maxSize - size)
+			return {};
+#ifdef UIMG_ENABLE_ZSTD
+		// Zstandard frames usually state their size, which allows rejecting corrupt files before anything is allocated
+		if(info.supercompression == TextureFileSupercompression::Zstd) {
+			auto contentSize = ZSTD_getFrameContentSize(data.data() + level.offset, level.size);
+			if(contentSize == ZSTD_CONTENTSIZE_ERROR || (contentSize != ZSTD_CONTENTSIZE_UNKNOWN && contentSize != level.uncompressedSize))
+				return {};
+		}
+#endif
+		offsets.push_back(size);
+		size += level.uncompressedSize;
+	}
+	std::vector<uint8_t> uncompressedData;
+	uncompressedData.resize(size);
+	std::atomic<bool> success = true;
+	pragma::image::parallel_for(static_cast<uint32_t>(info.levels.size()), [&](uint32_t i) {
+		auto &level = info.levels[i];
+		if(!texture_file::ktx2::decompress(info.supercompression, data.subspan(level.offset, level.size), std::span<uint8_t> {uncompressedData.data() + offsets[i], level.uncompressedSize}))
+			success = false;
+	});
+	if(!success)
+		return {};
+	return uncompressedData;
+}
+
+std::optional<pragma::image::TextureFileData> pragma::image::load_texture(ufile::IFile &f)
+{
+	std::vector<uint8_t> data;
+	data.resize(f.GetSize());
+	if(f.Read(data.data(), data.size()) != data.size())
+		return {};
+	auto info = parse_texture_file(data);
+	if(!info)
+		return {};
+	if(info->supercompression != TextureFileSupercompression::None) {
+		auto uncompressedData = decompress_texture_file(data, *info);
+		if(!uncompressedData)
+			return {};
+		data = std::move(*uncompressedData);
+	}
+	TextureFileData texData {};
+	texData.images.resize(info->numLayers);
+	for(auto &images : texData.images)
+		images.resize(info->numMipmaps);
+	for(auto &surface : info->surfaces) {
+		auto img = decode_surface(info->format, std::span<const uint8_t> {data.data() + surface.offset, surface.size}, surface.width, surface.height, surface.rowPitch);
+		if(!img)
+			return {};
+		texData.images[surface.layer][surface.mipmap] = std::move(img);
+	}
+	texData.info = std::move(*info);
+	return texData;
+}
+std::optional<pragma::image::TextureFileData> pragma::image::load_texture(const std::string &fileName)
+{
+	auto fp = fs::open_file(fileName.c_str(), fs::FileMode::Read | fs::FileMode::Binary);
+	if(fp == nullptr)
+		return {};
+	fs::File f {fp};
+	return load_texture(f);
+}
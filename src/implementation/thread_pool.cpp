@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+module pragma.image;
+
+import :thread_pool;
+
+pragma::image::ThreadPool &pragma::image::ThreadPool::Get()
+{
+	static ThreadPool pool {};
+	return pool;
+}
+
+pragma::image::ThreadPool::ThreadPool(uint32_t numThreads)
+{
+	if(numThreads == 0)
+		numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	m_threads.reserve(numThreads);
+	for(auto i = decltype(numThreads) {0u}; i < numThreads; ++i)
+		m_threads.push_back(std::thread {[this]() { RunWorker(); }});
+}
+
+pragma::image::ThreadPool::~ThreadPool()
+{
+	{
+		std::scoped_lock lock {m_taskMutex};
+		m_running = false;
+	}
+	m_taskCondition.notify_all();
+	for(auto &t : m_threads)
+		t.join();
+}
+
+uint32_t pragma::image::ThreadPool::GetThreadCount() const { return static_cast<uint32_t>(m_threads.size()); }
+
+void pragma::image::ThreadPool::RunWorker()
+{
+	for(;;) {
+		std::function<void()> task;
+		{
+			std::unique_lock lock {m_taskMutex};
+			m_taskCondition.wait(lock, [this]() { return !m_running || !m_tasks.empty(); });
+			if(m_tasks.empty())
+				return; // Pool is shutting down and there's nothing left to do
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+		}
+		task();
+	}
+}
+
+void pragma::image::ThreadPool::Submit(std::function<void()> task)
+{
+	{
+		std::scoped_lock lock {m_taskMutex};
+		m_tasks.push(std::move(task));
+	}
+	m_taskCondition.notify_one();
+}
+
+void pragma::image::ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)> &fn)
+{
+	if(count == 0)
+		return;
+	if(count == 1 || m_threads.empty()) {
+		for(auto i = decltype(count) {0u}; i < count; ++i)
+			fn(i);
+		return;
+	}
+	struct State {
+		const std::function<void(uint32_t)> *fn = nullptr;
+		uint32_t count = 0;
+		std::atomic<uint32_t> next = 0;
+		std::atomic<uint32_t> numCompleted = 0;
+		std::mutex mutex;
+		std::condition_variable condition;
+	};
+	auto state = std::make_shared<State>();
+	state->fn = &fn;
+	state->count = count;
+	// Helpers that are picked up after all indices have been claimed return immediately,
+	// so it is safe for them to outlive this call (they only hold on to the shared state).
+	auto runItems = [](State &state) {
+		for(;;) {
+			auto i = state.next.fetch_add(1);
+			if(i >= state.count)
+				return;
+			(*state.fn)(i);
+			if(state.numCompleted.fetch_add(1) + 1 == state.count) {
+				std::scoped_lock lock {state.mutex};
+				state.condition.notify_all();
+			}
+		}
+	};
+	auto numHelpers = std::min(count - 1, GetThreadCount());
+	for(auto i = decltype(numHelpers) {0u}; i < numHelpers; ++i)
+		Submit([state, runItems]() { runItems(*state); });
+	runItems(*state);
+
+	std::unique_lock lock {state->mutex};
+	state->condition.wait(lock, [&state]() { return state->numCompleted.load() == state->count; });
+}
+
+void pragma::image::parallel_for(uint32_t count, const std::function<void(uint32_t)> &fn) { ThreadPool::Get().ParallelFor(count, fn); }
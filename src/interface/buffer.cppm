@@ -10,6 +10,11 @@ export {
 	namespace pragma::image {
 		DLLUIMG float calc_luminance(const Vector3 &color);
 
+		class MipmapChain;
+		class ResizeScratch;
+		class ResizePlan;
+		class ResamplePlan;
+
 		class DLLUIMG ImageBuffer : public std::enable_shared_from_this<ImageBuffer> {
 		  public:
 			static constexpr uint8_t FULLY_TRANSPARENT = 0u;
@@ -136,7 +141,17 @@ export {
 
 			void Read(Offset offset, Size size, void *outData);
 			void Write(Offset offset, Size size, const void *inData);
-			void Resize(Size width, Size height, EdgeAddressMode addressMode = EdgeAddressMode::Clamp, Filter filter = Filter::Default, ColorSpace colorSpace = ColorSpace::Auto);
+			void Resize(Size width, Size height, EdgeAddressMode addressMode = EdgeAddressMode::Clamp, Filter filter = Filter::Default, ColorSpace colorSpace = ColorSpace::Auto, ResizeBackend backend = ResizeBackend::Auto);
+			// Resizes this image to the dimensions of dst and writes the result into dst's existing storage. Both images must have the same format.
+			// If a scratch arena is specified, all temporary memory is taken from it and the resize runs on the calling thread,
+			// otherwise the temporary memory is allocated and the resize is distributed across the thread pool.
+			bool ResizeInto(ImageBuffer &dst, EdgeAddressMode addressMode = EdgeAddressMode::Clamp, Filter filter = Filter::Default, ColorSpace colorSpace = ColorSpace::Auto, ResizeScratch *scratch = nullptr,
+			  ResizeBackend backend = ResizeBackend::Auto) const;
+			// Generates the mipmaps for this image, each level is downsampled from the previous one.
+			// If numLevels is 0, the full chain down to 1x1 is generated.
+			MipmapChain GenerateMipmaps(Filter filter = Filter::Default, ColorSpace colorSpace = ColorSpace::Auto, EdgeAddressMode addressMode = EdgeAddressMode::Clamp, uint32_t numLevels = 0) const;
+			// Same as above, but uses the native resampler (see resample)
+			MipmapChain GenerateMipmaps(ResampleFilter filter, ColorSpace colorSpace = ColorSpace::Auto, EdgeAddressMode addressMode = EdgeAddressMode::Clamp, uint32_t numLevels = 0) const;
 
 			size_t GetRowStride() const;
 			size_t GetPixelStride() const;
@@ -178,6 +193,165 @@ export {
 			std::pair<uint64_t, uint64_t> m_offsetRelToParent = {};
 		};
 
+		// Mipmap levels stored consecutively in a single allocation, starting with the full-resolution image.
+		// Level dimensions match calculate_mipmap_size.
+		class DLLUIMG MipmapChain {
+		  public:
+			Format GetFormat() const;
+			uint32_t GetLevelCount() const;
+			uint32_t GetWidth(uint32_t level) const;
+			uint32_t GetHeight(uint32_t level) const;
+			size_t GetLevelOffset(uint32_t level) const;
+			size_t GetLevelSize(uint32_t level) const;
+			void *GetLevelData(uint32_t level);
+			const void *GetLevelData(uint32_t level) const;
+			// The returned buffer references the level data directly and keeps the chain's memory alive
+			std::shared_ptr<ImageBuffer> GetLevel(uint32_t level) const;
+			const void *GetData() const;
+			void *GetData();
+			size_t GetSize() const;
+		  private:
+			friend ImageBuffer;
+			// Allocates the memory for all levels and copies the base level
+			void Initialize(const ImageBuffer &baseLevel, uint32_t numLevels);
+			struct Level {
+				uint32_t width = 0;
+				uint32_t height = 0;
+				size_t offset = 0;
+				size_t size = 0;
+			};
+			std::shared_ptr<uint8_t[]> m_data = nullptr;
+			std::vector<Level> m_levels;
+			Format m_format = Format::None;
+		};
+
+		// Reusable temporary memory for resize operations. The arena grows to the largest amount of memory a single resize
+		// has required and keeps it, so a loop of resizes with the same dimensions stops allocating after the first iteration.
+		// An arena must not be used by multiple resizes at the same time.
+		class DLLUIMG ResizeScratch {
+		  public:
+			ResizeScratch() = default;
+			ResizeScratch(const ResizeScratch &) = delete;
+			ResizeScratch &operator=(const ResizeScratch &) = delete;
+			void Reserve(size_t size);
+			size_t GetCapacity() const;
+			// Frees all memory
+			void Release();
+
+			// Invalidates all previous allocations. If the last use did not fit into the arena, it is reallocated to the required size.
+			void Reset();
+			void *Allocate(size_t size, size_t alignment = 64);
+		  private:
+			std::unique_ptr<uint8_t[]> m_data = nullptr;
+			size_t m_capacity = 0;
+			size_t m_offset = 0;
+			// Total size required since the last reset, including alignment padding
+			size_t m_required = 0;
+			// Allocations that did not fit into the arena
+			std::vector<std::unique_ptr<uint8_t[]>> m_overflow;
+		};
+
+		// Precalculated filter coefficients for resizing images of a specific size and format to a specific size.
+		// A plan can be executed any number of times, including concurrently from multiple threads.
+		// Exact 2:1 reductions with a box or triangle filter are handled by downsample_2x2 instead (except for 16-bit images with ResizeBackend::Stb),
+		// other resizes either by stb_image_resize or the native ResamplePlan depending on the ResizeBackend.
+		class DLLUIMG ResizePlan {
+		  public:
+			// Number of plans kept by Get
+			static constexpr size_t CACHE_SIZE = 32;
+			static std::unique_ptr<ResizePlan> Create(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, Format format, EdgeAddressMode addressMode = EdgeAddressMode::Clamp, Filter filter = Filter::Default,
+			  ColorSpace colorSpace = ColorSpace::Auto, ResizeBackend backend = ResizeBackend::Auto);
+			// Returns a plan from a process-wide cache of recently used plans, or creates it if it isn't cached.
+			// This is what ImageBuffer::Resize, ResizeInto and GenerateMipmaps use.
+			static std::shared_ptr<const ResizePlan> Get(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, Format format, EdgeAddressMode addressMode = EdgeAddressMode::Clamp, Filter filter = Filter::Default,
+			  ColorSpace colorSpace = ColorSpace::Auto, ResizeBackend backend = ResizeBackend::Auto);
+			ResizePlan(const ResizePlan &) = delete;
+			ResizePlan &operator=(const ResizePlan &) = delete;
+			~ResizePlan();
+
+			uint32_t GetSourceWidth() const;
+			uint32_t GetSourceHeight() const;
+			uint32_t GetDestinationWidth() const;
+			uint32_t GetDestinationHeight() const;
+			Format GetFormat() const;
+
+			// Returns false if the dimensions or formats of the images don't match the plan
+			bool Execute(const ImageBuffer &src, ImageBuffer &dst, ResizeScratch *scratch = nullptr) const;
+			// See ImageBuffer::ResizeInto for the behavior with and without a scratch arena
+			void Execute(const void *src, void *dst, ResizeScratch *scratch = nullptr) const;
+		  private:
+			class Resizer;
+			ResizePlan();
+			std::unique_ptr<Resizer> m_resizer;
+			std::unique_ptr<ResamplePlan> m_resamplePlan;
+			uint32_t m_srcWidth = 0;
+			uint32_t m_srcHeight = 0;
+			uint32_t m_dstWidth = 0;
+			uint32_t m_dstHeight = 0;
+			Format m_format = Format::None;
+			EdgeAddressMode m_addressMode = EdgeAddressMode::Clamp;
+			Filter m_filter = Filter::Default;
+			ColorSpace m_colorSpace = ColorSpace::Auto;
+			ResizeBackend m_backend = ResizeBackend::Auto;
+		};
+
+		// Exact 2:1 reductions with a 2x2 box filter (Filter::Box) or a 4x4 tent filter (Filter::Triangle).
+		// Each dimension of the source image must be exactly twice the destination dimension, or 1.
+		// LDR values are averaged in linear space unless the color space is ColorSpace::Linear, 16-bit values are treated as half-precision floats.
+		// ResizePlan uses these automatically where possible.
+		DLLUIMG bool can_downsample_2x2(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, Format format, Filter filter, ColorSpace colorSpace = ColorSpace::Auto);
+		DLLUIMG bool downsample_2x2(const void *src, uint32_t srcWidth, uint32_t srcHeight, void *dst, uint32_t dstWidth, uint32_t dstHeight, Format format, Filter filter = Filter::Box, EdgeAddressMode addressMode = EdgeAddressMode::Clamp,
+		  ColorSpace colorSpace = ColorSpace::Auto, ResizeScratch *scratch = nullptr);
+
+		// Precalculated filter weights of the library's own separable resampler. Depending on the aspect of the resize, rows are either
+		// filtered horizontally first or vertically first, whichever needs fewer operations.
+		// A plan can be executed any number of times, including concurrently from multiple threads.
+		class DLLUIMG ResamplePlan {
+		  public:
+			static std::unique_ptr<ResamplePlan> Create(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, Format format, ResampleFilter filter, EdgeAddressMode addressMode = EdgeAddressMode::Clamp,
+			  ColorSpace colorSpace = ColorSpace::Auto);
+			// Uses separate filters for both axes, e.g. to pick a different kernel for an axis that is enlarged while the other one is reduced
+			static std::unique_ptr<ResamplePlan> Create(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, Format format, ResampleFilter horizontalFilter, ResampleFilter verticalFilter,
+			  EdgeAddressMode addressMode = EdgeAddressMode::Clamp, ColorSpace colorSpace = ColorSpace::Auto);
+			// See resample_normal_map
+			static std::unique_ptr<ResamplePlan> CreateNormalMap(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, Format format, ResampleFilter filter, EdgeAddressMode addressMode = EdgeAddressMode::Clamp,
+			  bool storeLengthInAlpha = false);
+			ResamplePlan(const ResamplePlan &) = delete;
+			ResamplePlan &operator=(const ResamplePlan &) = delete;
+			~ResamplePlan();
+
+			// Size of the scratch memory required by ExecuteRows (per concurrent call)
+			size_t GetScratchSize() const;
+			// Writes the destination rows [yStart, yEnd)
+			void ExecuteRows(const void *src, void *dst, uint32_t yStart, uint32_t yEnd, void *scratch) const;
+			// Resamples the entire image in parallel bands of rows
+			void Execute(const void *src, void *dst) const;
+		  private:
+			struct Data;
+			ResamplePlan();
+			void Initialize(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, Format format, ResampleFilter horizontalFilter, ResampleFilter verticalFilter, EdgeAddressMode addressMode);
+			std::unique_ptr<Data> m_data;
+			uint32_t m_dstHeight = 0;
+			size_t m_scratchSize = 0;
+		};
+
+		// Separable resampling with the library's own filters, mainly intended for mipmap generation.
+		// Values are filtered in linear space like with downsample_2x2.
+		DLLUIMG bool resample(const void *src, uint32_t srcWidth, uint32_t srcHeight, void *dst, uint32_t dstWidth, uint32_t dstHeight, Format format, ResampleFilter filter, EdgeAddressMode addressMode = EdgeAddressMode::Clamp,
+		  ColorSpace colorSpace = ColorSpace::Auto);
+		// Resamples a tangent space normal map and renormalizes the filtered vectors. LDR vectors are expected to be stored as unsigned normalized values,
+		// HDR and float vectors as signed values. The z component of two-channel normal maps is reconstructed before filtering.
+		// If storeLengthInAlpha is set, the alpha channel of four-channel formats receives the length of the filtered vector before it was renormalized,
+		// which can be used to derive Toksvig-style roughness.
+		DLLUIMG bool resample_normal_map(const void *src, uint32_t srcWidth, uint32_t srcHeight, void *dst, uint32_t dstWidth, uint32_t dstHeight, Format format, ResampleFilter filter,
+		  EdgeAddressMode addressMode = EdgeAddressMode::Clamp, bool storeLengthInAlpha = false);
+
+		// Fraction of pixels of a four-channel image for which alpha * alphaScale exceeds alphaCutoff
+		DLLUIMG float calculate_alpha_coverage(const void *data, uint32_t width, uint32_t height, Format format, float alphaCutoff, float alphaScale = 1.f);
+		// Scales the alpha values of a four-channel image so that the alpha coverage at alphaCutoff matches the specified coverage as closely as possible.
+		// Used to keep alpha-tested textures from thinning out in lower mipmap levels.
+		DLLUIMG bool scale_alpha_to_coverage(void *data, uint32_t width, uint32_t height, Format format, float coverage, float alphaCutoff);
+
 		struct DLLUIMG ImageLayerSet {
 			std::unordered_map<std::string, std::shared_ptr<ImageBuffer>> images;
 		};
@@ -0,0 +1,23 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+export module pragma.image:compressors.etc2;
+
+export import std.compat;
+
+export namespace pragma::image {
+	// Native ETC2 and EAC block encoders. Each call encodes one surface (or a stripe of block rows of a surface) on the calling thread,
+	// the caller is responsible for distributing stripes across threads.
+	// Blocks are written in row-major order, so dst has to hold ceil(width / 4) * ceil(height / 4) blocks. Partial blocks at the right and
+	// bottom edges are padded by repeating the last row and column.
+	namespace etc2 {
+		// ETC2 RGB8 (8 bytes per block), from RGBA8 data. The alpha channel is ignored.
+		DLLUIMG void compress_blocks_rgb(const uint8_t *rgba8, uint32_t width, uint32_t height, uint32_t stride, uint8_t *dst);
+		// ETC2 RGBA8 (16 bytes per block, EAC alpha followed by ETC2 RGB), from RGBA8 data
+		DLLUIMG void compress_blocks_rgba(const uint8_t *rgba8, uint32_t width, uint32_t height, uint32_t stride, uint8_t *dst);
+		// EAC R11 unsigned (8 bytes per block), from R8 data
+		DLLUIMG void compress_blocks_r11(const uint8_t *r8, uint32_t width, uint32_t height, uint32_t stride, uint8_t *dst);
+		// EAC RG11 unsigned (16 bytes per block, red followed by green), from RG8 data
+		DLLUIMG void compress_blocks_rg11(const uint8_t *rg8, uint32_t width, uint32_t height, uint32_t stride, uint8_t *dst);
+	};
+};
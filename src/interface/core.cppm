@@ -16,12 +16,26 @@ export {
 		DLLUIMG void calculate_mipmap_size(uint32_t w, uint32_t h, uint32_t &outWMipmap, uint32_t &outHMipmap, uint32_t level);
 		DLLUIMG uint32_t calculate_mipmap_count(uint32_t w, uint32_t h);
 
-		enum class ImageFormat : uint8_t { PNG = 0, BMP, TGA, JPG, HDR, Count };
+		enum class ImageFormat : uint8_t { PNG = 0, BMP, TGA, JPG, HDR, EXR, Count };
 		enum class PixelFormat : uint8_t { LDR = 0, HDR, Float };
 		DLLUIMG std::string get_file_extension(ImageFormat format);
 		DLLUIMG std::shared_ptr<ImageBuffer> load_image(ufile::IFile &f, PixelFormat pixelFormat = PixelFormat::LDR, bool flipVertically = false);
 		DLLUIMG std::shared_ptr<ImageBuffer> load_image(const std::string &fileName, PixelFormat pixelFormat = PixelFormat::LDR, bool flipVertically = false);
-		DLLUIMG bool save_image(ufile::IFile &f, ImageBuffer &imgBuffer, ImageFormat format, float quality = 1.f, bool flipVertically = false);
+		// Specifies how the values of R16, RG16, RGB16 and RGBA16 buffers are interpreted.
+		// Buffers created by ImageBuffer::Convert contain half-float values, buffers loaded with PixelFormat::HDR contain 16-bit unorm values.
+		enum class Value16Encoding : uint8_t { Half = 0, Unorm };
+		// value16Encoding is only used if a 16-bit buffer is saved as PNG
+		DLLUIMG bool save_image(ufile::IFile &f, ImageBuffer &imgBuffer, ImageFormat format, float quality = 1.f, bool flipVertically = false, Value16Encoding value16Encoding = Value16Encoding::Half);
+		DLLUIMG bool save_image(const std::string &fileName, ImageBuffer &imgBuffer, ImageFormat format, float quality = 1.f, bool flipVertically = false, Value16Encoding value16Encoding = Value16Encoding::Half);
+
+		enum class ExrCompression : uint8_t { None = 0, Rle, Zip };
+		// Writes a scanline OpenEXR file. Half and float buffers are written without conversion, LDR buffers are stored as half.
+		DLLUIMG bool save_exr(ufile::IFile &f, const ImageBuffer &imgBuffer, ExrCompression compression = ExrCompression::Zip, bool flipVertically = false);
+		// Writes a baseline JPEG with one restart interval per row of MCUs, which are encoded in parallel.
+		// Quality is in the range [0,1], chroma is subsampled (4:2:0) at 0.9 and below. One- and two-channel buffers are written as grayscale.
+		DLLUIMG bool save_jpeg(ufile::IFile &f, const ImageBuffer &imgBuffer, float quality = 0.9f, bool flipVertically = false);
+		// Writes a 16-bit PNG file from a 16-bit buffer. Half values are clamped to [0,1], unorm values are written as-is.
+		DLLUIMG bool save_png16(ufile::IFile &f, const ImageBuffer &imgBuffer, Value16Encoding encoding = Value16Encoding::Half, int32_t compressionLevel = 6, bool flipVertically = false);
 #ifdef UIMG_ENABLE_SVG
 		struct DLLUIMG SvgImageInfo {
 			std::string styleSheet {};
@@ -37,11 +51,18 @@ export {
 			Compressonator,
 			Ispctc,
 		};
+		class TextureCache;
+		// The callbacks are never invoked concurrently, but may be invoked from a worker thread of the ThreadPool
 		struct DLLUIMG TextureOutputHandler {
 			std::function<void(int size, int width, int height, int depth, int face, int miplevel)> beginImage = nullptr;
 			std::function<bool(const void *data, int size)> writeData = nullptr;
 			std::function<void()> endImage = nullptr;
 		};
+		// Speed/quality trade-off of the block encoders, from fastest to highest quality.
+		// Currently only used by the Ispctc compressor, which selects the BC6H, BC7 and ASTC encoder profiles with it and, for KTX2 output,
+		// the Zstandard level. BC7 doesn't distinguish between Slow and VerySlow, BC6H uses its fastest profile for UltraFast and ASTC only
+		// has a fast (up to Basic) and a slow profile.
+		enum class CompressionSpeed : uint8_t { UltraFast = 0, VeryFast, Fast, Basic, Slow, VerySlow, Count };
 		struct DLLUIMG TextureSaveInfo {
 			TextureInfo texInfo {};
 
@@ -58,6 +79,23 @@ export {
 			std::optional<ChannelMask> channelMask {};
 
 			std::optional<CompressorLibrary> compressorLibrary {};
+
+			// Only used for generated mipmaps of normal maps with an alpha channel: Stores the length of the averaged normal
+			// in the alpha channel of each level, e.g. for Toksvig specular anti-aliasing.
+			// Only supported by the Ispctc compressor, the other compressors generate the mipmaps themselves and ignore this option.
+			bool storeNormalLengthInAlpha = false;
+
+			// Only used for generated mipmaps of textures with an alpha channel: If set, the alpha values of each level are scaled so that
+			// the fraction of texels above this alpha-test cutoff matches the base level.
+			// Only supported by the Ispctc compressor, the other compressors ignore this option.
+			std::optional<float> alphaCoverageCutoff {};
+
+			CompressionSpeed compressionSpeed = CompressionSpeed::Slow;
+
+			// If set, the compressed output is looked up in and added to this cache (see TextureCache).
+			// Calculating the key requires the image data of all layers and mipmaps, so on a cache miss the image data callback
+			// is invoked twice for every surface (once for the key and once for the compression).
+			std::shared_ptr<TextureCache> cache = nullptr;
 		};
 		DLLUIMG bool compress_texture(const TextureOutputHandler &outputHandler, const std::function<const uint8_t *(uint32_t, uint32_t, std::function<void()> &)> &fGetImgData, const TextureSaveInfo &texSaveInfo, const std::function<void(const std::string &)> &errorHandler = nullptr);
 		DLLUIMG bool compress_texture(std::vector<std::vector<std::vector<uint8_t>>> &outputData, const std::function<const uint8_t *(uint32_t, uint32_t, std::function<void()> &)> &fGetImgData, const TextureSaveInfo &texSaveInfo,
@@ -74,5 +112,26 @@ export {
 		DLLUIMG void bake_margin(ImageBuffer &imgBuffer, std::vector<uint8_t> &mask, const int margin);
 		DLLUIMG Vector3 linear_to_srgb(const Vector3 &color);
 		DLLUIMG Vector3 srgb_to_linear(const Vector3 &srgbIn);
+
+		// Exact sRGB transfer functions (IEC 61966-2-1)
+		DLLUIMG float linear_to_srgb(float v);
+		DLLUIMG float srgb_to_linear(float v);
+
+		// Lookup tables for converting between 8-bit sRGB values and linear floats, shared by all conversions in this library
+		struct DLLUIMG SrgbTables {
+			// sRGB decode table followed by a linear (v / 255) decode table, so a single gather can handle both color and alpha values
+			std::array<float, 512> decode;
+			// For every 1/4096 step of linear values, the sRGB value its lower bound encodes to. Since the thresholds between consecutive
+			// sRGB values are further apart than one step, the exact result is either that value or the next one.
+			std::array<int32_t, 4096> encodeBase;
+			// Smallest linear value that encodes to each sRGB value
+			std::array<float, 257> encodeThresholds;
+		};
+		DLLUIMG const SrgbTables &get_srgb_tables();
+		DLLUIMG float srgb8_to_linear(uint8_t v);
+		// Same result as rounding linear_to_srgb(v) * 255
+		DLLUIMG uint8_t linear_to_srgb8(float v);
+		DLLUIMG void srgb8_to_linear(const uint8_t *in, float *out, size_t count);
+		DLLUIMG void linear_to_srgb8(const float *in, uint8_t *out, size_t count);
 	};
 }
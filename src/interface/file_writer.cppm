@@ -0,0 +1,57 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+export module pragma.image:file_writer;
+
+export import pragma.util;
+
+export namespace pragma::image {
+	// Write-only file that coalesces small writes into large blocks before they are passed on.
+	// Encoders tend to emit many tiny writes (one per PNG chunk, one per flushed bit buffer, etc.), which
+	// is expensive on network-mounted storage.
+	class DLLUIMG BufferedFileWriter : public ufile::IFile {
+	  public:
+		static constexpr size_t DEFAULT_BUFFER_SIZE = 1024 * 1024;
+		static constexpr size_t BLOCK_ALIGNMENT = 4096;
+
+		// Opens a local file (absolute system path) for writing with O_DIRECT, bypassing the page cache.
+		// Blocks are written with pwrite. Returns nullptr if the platform or file system does not support this,
+		// in which case the file should be opened regularly.
+		static std::unique_ptr<BufferedFileWriter> OpenDirect(const std::string &path, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+
+		// The buffer size is rounded up to a multiple of BLOCK_ALIGNMENT for direct files only
+		BufferedFileWriter(ufile::IFile &f, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+		BufferedFileWriter(const BufferedFileWriter &) = delete;
+		BufferedFileWriter &operator=(const BufferedFileWriter &) = delete;
+		virtual ~BufferedFileWriter() override;
+
+		virtual size_t Read(void *data, size_t size) override;
+		virtual size_t Write(const void *data, size_t size) override;
+		virtual size_t Tell() override;
+		// Direct files can only be written sequentially, seeking anywhere other than the current position will fail
+		virtual void Seek(size_t offset, Whence whence = Whence::Set) override;
+		virtual int32_t ReadChar() override;
+		virtual size_t GetSize() override;
+
+		// Writes all buffered data. Returns false if any write has failed so far.
+		bool Flush();
+		// Flushes and, for direct files, truncates the padding of the last block and closes the file
+		bool Close();
+		bool HasFailed() const;
+	  private:
+		BufferedFileWriter(int fd, size_t bufferSize);
+		void InitBuffer(size_t bufferSize);
+		bool WriteBlock(const uint8_t *data, size_t size);
+		ufile::IFile *m_file = nullptr;
+		int m_fd = -1;
+		std::unique_ptr<uint8_t[]> m_storage = nullptr;
+		uint8_t *m_buffer = nullptr;
+		size_t m_bufferSize = 0;
+		size_t m_numBuffered = 0;
+		// Offset at which the buffered data will be written
+		size_t m_offset = 0;
+		size_t m_size = 0;
+		bool m_failed = false;
+		bool m_closed = false;
+	};
+};
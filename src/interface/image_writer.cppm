@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+export module pragma.image:image_writer;
+
+export import :buffer;
+export import :core;
+
+export namespace pragma::image {
+	// Encodes and writes images on background threads.
+	class DLLUIMG ImageWriter {
+	  public:
+		struct DLLUIMG Config {
+			// The stb_image_write based encoders (8-bit PNG, BMP, TGA and HDR) share global state and only run on one worker at a time,
+			// the other formats are encoded concurrently
+			uint32_t numThreads = 1;
+			// Maximum number of jobs that may be queued or in progress at the same time
+			uint32_t maxQueueDepth = 8;
+			// Maximum combined size (in bytes) of all image buffers that are queued or in progress.
+			// A single job that exceeds this limit is still accepted if the writer is idle.
+			size_t maxQueuedMemory = 512 * 1024 * 1024;
+			// If enabled, job file names are treated as absolute system paths and written with O_DIRECT where supported
+			// (see BufferedFileWriter::OpenDirect), otherwise they are written through the virtual file system.
+			bool directIo = false;
+		};
+		struct DLLUIMG Job {
+			// The writer takes ownership of the buffer, it may be converted in-place during encoding
+			// and must not be modified by the caller until the job has completed.
+			std::shared_ptr<ImageBuffer> imageBuffer = nullptr;
+			std::string fileName;
+			ImageFormat format = ImageFormat::PNG;
+			float quality = 1.f;
+			bool flipVertically = false;
+			// Called from the worker thread once the image has been written
+			std::function<void(bool)> onComplete = nullptr;
+			// See save_image
+			Value16Encoding value16Encoding = Value16Encoding::Half;
+		};
+
+		ImageWriter();
+		ImageWriter(const Config &config);
+		ImageWriter(const ImageWriter &) = delete;
+		ImageWriter &operator=(const ImageWriter &) = delete;
+		// Waits for all pending jobs to complete
+		~ImageWriter();
+
+		// Blocks until there is room for the job in the queue
+		bool Enqueue(Job job);
+		// Returns false without blocking if the queue is full, in which case the job is left untouched
+		bool TryEnqueue(Job &job);
+		// Blocks until all queued jobs have been written
+		void Flush();
+
+		uint32_t GetPendingJobCount() const;
+		size_t GetPendingMemory() const;
+		const Config &GetConfig() const;
+	  private:
+		bool CanAccept(size_t size) const;
+		void PushJob(Job &&job, size_t size);
+		void RunWorker();
+		Config m_config;
+		std::vector<std::thread> m_threads;
+		std::queue<Job> m_jobs;
+		mutable std::mutex m_mutex;
+		std::condition_variable m_jobAvailable;
+		std::condition_variable m_jobCompleted;
+		uint32_t m_numPendingJobs = 0;
+		size_t m_pendingMemory = 0;
+		bool m_running = true;
+	};
+};
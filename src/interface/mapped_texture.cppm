@@ -0,0 +1,36 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+export module pragma.image:mapped_texture;
+
+export import :texture_file;
+
+export namespace pragma::image {
+	// Read-only memory mapping of a DDS, KTX or KTX2 file. The header is parsed once when the file is opened, surfaces are accessed
+	// through views into the mapping without being copied, so only the pages of the surfaces that are actually read are loaded
+	// from disk (or taken from the page cache).
+	class DLLUIMG MappedTextureFile {
+	  public:
+		// Expects an absolute system path. Fails for supercompressed KTX2 files, which have to be loaded with load_texture instead.
+		static std::unique_ptr<MappedTextureFile> Open(const std::string &path);
+
+		MappedTextureFile(const MappedTextureFile &) = delete;
+		MappedTextureFile &operator=(const MappedTextureFile &) = delete;
+		~MappedTextureFile();
+
+		const TextureFileInfo &GetInfo() const;
+		std::span<const uint8_t> GetData() const;
+		const TextureFileSurface &GetSurface(uint32_t layer, uint32_t mipmap) const;
+		std::span<const uint8_t> GetSurfaceData(uint32_t layer, uint32_t mipmap) const;
+		std::span<const uint8_t> GetSurfaceData(const TextureFileSurface &surface) const;
+		// Asks the operating system to read the surfaces of the specified mipmaps of all layers in the background, e.g. the
+		// mip tail before the larger levels are requested. Returns false if the hint was not accepted, which doesn't affect
+		// the validity of the data.
+		bool Prefetch(uint32_t firstMipmap, uint32_t numMipmaps = std::numeric_limits<uint32_t>::max()) const;
+	  private:
+		MappedTextureFile(const uint8_t *data, size_t size, TextureFileInfo &&info);
+		const uint8_t *m_data = nullptr;
+		size_t m_size = 0;
+		TextureFileInfo m_info;
+	};
+};
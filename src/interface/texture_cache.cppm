@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+export module pragma.image:texture_cache;
+
+export import :core;
+
+#ifdef UIMG_ENABLE_TEXTURE_COMPRESSION
+
+export namespace pragma::image {
+	// Storage for the entries of a TextureCache, which are addressed by their 64-bit content hash.
+	// Implementations have to be thread-safe.
+	class DLLUIMG ITextureCacheBackend {
+	  public:
+		struct DLLUIMG Entry {
+			uint64_t key = 0;
+			uint64_t size = 0;
+			// Entries with older access times are evicted first
+			int64_t lastAccess = 0;
+		};
+		virtual ~ITextureCacheBackend() = default;
+		virtual std::vector<Entry> GetEntries() = 0;
+		virtual std::optional<std::vector<uint8_t>> Read(uint64_t key) = 0;
+		virtual bool Write(uint64_t key, const void *data, size_t size) = 0;
+		virtual void Remove(uint64_t key) = 0;
+		// Marks the entry as recently used, so that the access order is preserved across sessions
+		virtual void Touch(uint64_t key) {}
+	};
+
+	// Stores every entry as a file in a local directory (absolute system path). Entries are written to a temporary file
+	// and renamed afterwards, so other processes sharing the directory never see partially written entries.
+	class DLLUIMG DirectoryTextureCacheBackend : public ITextureCacheBackend {
+	  public:
+		static std::unique_ptr<DirectoryTextureCacheBackend> Create(const std::string &directory);
+
+		virtual std::vector<Entry> GetEntries() override;
+		virtual std::optional<std::vector<uint8_t>> Read(uint64_t key) override;
+		virtual bool Write(uint64_t key, const void *data, size_t size) override;
+		virtual void Remove(uint64_t key) override;
+		virtual void Touch(uint64_t key) override;
+		const std::string &GetDirectory() const;
+	  private:
+		DirectoryTextureCacheBackend(const std::string &directory);
+		std::string GetEntryPath(uint64_t key) const;
+		std::string m_directory;
+		std::atomic<uint32_t> m_tmpFileIndex = 0;
+	};
+
+	// Content-addressed cache for compressed textures (see TextureSaveInfo::cache). Entries are keyed by a hash of the input pixels,
+	// all settings that affect the output and the compressor version. Once the combined size of all entries exceeds the limit,
+	// the least recently used entries are evicted.
+	class DLLUIMG TextureCache {
+	  public:
+		static std::shared_ptr<TextureCache> Create(std::unique_ptr<ITextureCacheBackend> backend, uint64_t maxSize);
+		static std::shared_ptr<TextureCache> Create(const std::string &directory, uint64_t maxSize);
+		// Retrieves and hashes the image data of all layers and mipmaps. Returns an empty optional if the image data could not be retrieved or its size is unknown
+		static std::optional<uint64_t> CalculateKey(const std::function<const uint8_t *(uint32_t, uint32_t, std::function<void()> &)> &fGetImgData, const TextureSaveInfo &texSaveInfo, bool fileOutput);
+
+		TextureCache(const TextureCache &) = delete;
+		TextureCache &operator=(const TextureCache &) = delete;
+
+		std::optional<std::vector<uint8_t>> Load(uint64_t key);
+		bool Store(uint64_t key, const void *data, size_t size);
+		void Remove(uint64_t key);
+
+		void SetMaxSize(uint64_t maxSize);
+		uint64_t GetMaxSize() const;
+		uint64_t GetSize() const;
+		uint32_t GetEntryCount() const;
+		ITextureCacheBackend &GetBackend();
+	  private:
+		struct EntryInfo {
+			std::list<uint64_t>::iterator lruIt;
+			uint64_t size = 0;
+		};
+		TextureCache(std::unique_ptr<ITextureCacheBackend> backend, uint64_t maxSize);
+		void RemoveEntry(std::unordered_map<uint64_t, EntryInfo>::iterator it);
+		void Evict();
+		std::unique_ptr<ITextureCacheBackend> m_backend;
+		// Most recently used entries are at the front
+		std::list<uint64_t> m_lru;
+		std::unordered_map<uint64_t, EntryInfo> m_entries;
+		uint64_t m_size = 0;
+		uint64_t m_maxSize = 0;
+		mutable std::mutex m_mutex;
+	};
+};
+
+#endif
@@ -0,0 +1,144 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+export module pragma.image:texture_file;
+
+export import :core;
+
+export namespace pragma::image {
+	// Pixel layout of the surfaces stored in a DDS or KTX file
+	enum class TextureFileFormat : uint8_t {
+		Unknown = 0,
+
+		R8,
+		RG8,
+		RGB8,
+		RGBA8,
+		BGRA8,
+		RGBA16F,
+		R32F,
+		RGBA32F,
+
+		// BC1 with a fully opaque palette (OpenGL DXT1 RGB)
+		BC1,
+		// BC1 with a transparent black palette entry for three-color blocks
+		BC1a,
+		BC2,
+		BC3,
+		BC4,
+		BC5,
+		BC6H,
+		BC6H_Signed,
+		BC7,
+		ETC1,
+		EAC_R11,
+		EAC_RG11,
+		ETC2_RGB,
+		ETC2_RGB_A1,
+		ETC2_RGBA,
+		ASTC_4x4,
+		ASTC_5x4,
+		ASTC_5x5,
+		ASTC_6x5,
+		ASTC_6x6,
+		ASTC_8x5,
+		ASTC_8x6,
+		ASTC_8x8,
+
+		Count,
+
+		CompressedFirst = BC1,
+		CompressedLast = ASTC_8x8,
+	};
+	DLLUIMG bool is_compressed_format(TextureFileFormat format);
+	// Size of a block in bytes, or of a pixel for uncompressed formats
+	DLLUIMG uint32_t get_block_size(TextureFileFormat format);
+	// Footprint of a block in pixels, always 1x1 for uncompressed formats
+	DLLUIMG std::pair<uint32_t, uint32_t> get_block_extent(TextureFileFormat format);
+	// Format of the image buffers produced by decode_surface, or an empty optional if the format can't be decoded.
+	// BC4 and R11 are decoded to R8, BC5 and RG11 to RG8, BC6H to RGBA16 (half) and all other block formats to RGBA8.
+	DLLUIMG std::optional<Format> get_decoded_format(TextureFileFormat format);
+	// Vulkan format (VkFormat) of the surfaces, or 0 (VK_FORMAT_UNDEFINED) if there is no equivalent. ETC1 is mapped to ETC2, which is a superset.
+	DLLUIMG uint32_t get_vk_format(TextureFileFormat format, bool srgb);
+
+	// Supercompression schemes of KTX2 files, the values match the identifiers used by the specification
+	enum class TextureFileSupercompression : uint8_t { None = 0, Zstd = 2, Zlib = 3 };
+
+	struct DLLUIMG TextureFileSurface {
+		uint32_t layer = 0;
+		uint32_t mipmap = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		// Byte range of the surface within the file
+		size_t offset = 0;
+		size_t size = 0;
+		// Size of a row of blocks (or pixels) in bytes
+		uint32_t rowPitch = 0;
+	};
+	// Byte range of a supercompressed mipmap level (all layers) within the file
+	struct DLLUIMG TextureFileLevel {
+		size_t offset = 0;
+		size_t size = 0;
+		size_t uncompressedSize = 0;
+	};
+	struct DLLUIMG TextureFileInfo {
+		TextureInfo::ContainerFormat containerFormat = TextureInfo::ContainerFormat::DDS;
+		TextureFileFormat format = TextureFileFormat::Unknown;
+		bool srgb = false;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		// Includes the faces of cubemaps, e.g. a cubemap array with two elements has twelve layers
+		uint32_t numLayers = 0;
+		uint32_t numMipmaps = 0;
+		bool cubemap = false;
+		// Ordered by layer, then mipmap
+		std::vector<TextureFileSurface> surfaces;
+		// Only used by supercompressed KTX2 files, in which case the surface offsets refer to the data returned by decompress_texture_file
+		TextureFileSupercompression supercompression = TextureFileSupercompression::None;
+		std::vector<TextureFileLevel> levels;
+
+		const TextureFileSurface &GetSurface(uint32_t layer, uint32_t mipmap) const;
+	};
+	// Parses the header of a DDS, KTX or KTX2 file and determines the location of all surfaces.
+	// Returns an empty optional if the format is not supported, the texture is a volume texture or the data is truncated.
+	DLLUIMG std::optional<TextureFileInfo> parse_texture_file(std::span<const uint8_t> data);
+	// Decompresses the levels of a supercompressed KTX2 file in parallel. The levels are stored one after another, starting with the base level.
+	// Returns an empty optional if the file isn't supercompressed, the scheme is not supported, the data is corrupt
+	// or the levels would take up more than maxSize bytes once decompressed.
+	DLLUIMG std::optional<std::vector<uint8_t>> decompress_texture_file(std::span<const uint8_t> data, const TextureFileInfo &info, size_t maxSize = std::numeric_limits<uint32_t>::max());
+
+	// Decodes a single surface. Block-compressed surfaces are decoded one row of blocks at a time, rows are distributed across the
+	// worker threads. ASTC surfaces are not supported.
+	// The rows of uncompressed surfaces may be padded (see TextureFileSurface::rowPitch), a row pitch of 0 means the rows are tightly packed.
+	DLLUIMG std::shared_ptr<ImageBuffer> decode_surface(TextureFileFormat format, std::span<const uint8_t> data, uint32_t width, uint32_t height, uint32_t rowPitch = 0);
+
+	struct DLLUIMG TextureFileData {
+		TextureFileInfo info {};
+		// Indexed by layer, then mipmap
+		std::vector<std::vector<std::shared_ptr<ImageBuffer>>> images;
+	};
+	// Loads and decodes all layers and mipmaps of a DDS, KTX or KTX2 file
+	DLLUIMG std::optional<TextureFileData> load_texture(ufile::IFile &f);
+	DLLUIMG std::optional<TextureFileData> load_texture(const std::string &fileName);
+
+	struct DLLUIMG Ktx2WriteInfo {
+		TextureFileFormat format = TextureFileFormat::Unknown;
+		bool srgb = false;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		// Includes the faces of cubemaps
+		uint32_t numLayers = 1;
+		uint32_t numMipmaps = 1;
+		bool cubemap = false;
+		TextureFileSupercompression supercompression = TextureFileSupercompression::Zstd;
+		// Zstandard (1 to 22) or zlib (1 to 9) compression level, the library default is used if not set
+		std::optional<int32_t> compressionLevel {};
+		// Returns the blocks (or pixels) of a surface, tightly packed as described by TextureFileSurface. May be called from multiple threads at once.
+		std::function<std::span<const uint8_t>(uint32_t layer, uint32_t mipmap)> getSurfaceData = nullptr;
+	};
+	// Writes a KTX2 file. The mipmap levels are supercompressed independently of each other and in parallel.
+	// Fails if Zstandard is requested, but the library was built without zstd support.
+	DLLUIMG bool write_ktx2(ufile::IFile &f, const Ktx2WriteInfo &info);
+	// Expects an absolute system path
+	DLLUIMG bool write_ktx2(const std::string &path, const Ktx2WriteInfo &info);
+};
@@ -34,6 +34,14 @@ export {
 				ETC2_RGBA,
 				ETC2_RGB_A1,
 				ETC2_RGBM,
+				ASTC_4x4,
+				ASTC_5x4,
+				ASTC_5x5,
+				ASTC_6x5,
+				ASTC_6x6,
+				ASTC_8x5,
+				ASTC_8x6,
+				ASTC_8x8,
 
 				Count,
 
@@ -49,6 +57,9 @@ export {
 				BCFirst = BC1,
 				BCLast = BC7,
 
+				ASTCFirst = ASTC_4x4,
+				ASTCLast = ASTC_8x8,
+
 				ColorMap = DXT1,
 				ColorMap1BitAlpha = DXT1a,
 				ColorMapSharpAlpha = DXT3,
@@ -60,6 +71,8 @@ export {
 			enum class ContainerFormat : uint8_t {
 				DDS = 0u,
 				KTX,
+				// Mipmap levels are supercompressed with Zstandard (or zlib if zstd support is disabled)
+				KTX2,
 
 				Count
 			};
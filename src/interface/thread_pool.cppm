@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: (c) 2025 Silverlan <opensource@pragma-engine.com>
+// SPDX-License-Identifier: MIT
+
+export module pragma.image:thread_pool;
+
+export import std.compat;
+
+export namespace pragma::image {
+	// Shared worker pool used by the parallel code paths of this library (encoders, resizing, compression).
+	class DLLUIMG ThreadPool {
+	  public:
+		// Process-wide pool with one worker per hardware thread
+		static ThreadPool &Get();
+
+		ThreadPool(uint32_t numThreads = 0);
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool &operator=(const ThreadPool &) = delete;
+		~ThreadPool();
+
+		uint32_t GetThreadCount() const;
+		void Submit(std::function<void()> task);
+		// Calls fn(i) for every i in [0, count) and blocks until all calls have finished.
+		// The calling thread takes part in the work, so this may also be used from within a worker.
+		void ParallelFor(uint32_t count, const std::function<void(uint32_t)> &fn);
+	  private:
+		void RunWorker();
+		std::vector<std::thread> m_threads;
+		std::queue<std::function<void()>> m_tasks;
+		std::mutex m_taskMutex;
+		std::condition_variable m_taskCondition;
+		bool m_running = true;
+	};
+
+	DLLUIMG void parallel_for(uint32_t count, const std::function<void(uint32_t)> &fn);
+};
@@ -86,6 +86,30 @@ export namespace pragma::image {
 
 		Count
 	};
+	// Filters of the native resampler (see resample)
+	enum class ResampleFilter : uint8_t {
+		Box = 0,
+		Kaiser,
+		Lanczos3,
+		Lanczos2,
+		Triangle,
+		CubicBSpline,
+		CatmullRom,
+		Mitchell,
+
+		Count
+	};
+	// Implementation used by ImageBuffer::Resize and ResizePlan.
+	// Auto uses the native resampler for HDR and float images and stb_image_resize for LDR images.
+	// The native resampler reads 16-bit values as half floats (like the rest of the library), whereas stb_image_resize reads them as unorm16,
+	// so 16-bit buffers holding unorm data (e.g. loaded with PixelFormat::HDR) have to be resized with Stb explicitly.
+	enum class ResizeBackend : uint8_t {
+		Auto = 0,
+		Stb,
+		Native,
+
+		Count
+	};
 	enum class ColorSpace : uint8_t {
 		Auto = 0,
 		Linear,
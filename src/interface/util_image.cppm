@@ -4,5 +4,11 @@
 export module pragma.image;
 export import :buffer;
 export import :core;
+export import :file_writer;
+export import :image_writer;
+export import :mapped_texture;
+export import :texture_cache;
+export import :texture_file;
 export import :texture_info;
+export import :thread_pool;
 export import :types;